@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "bench.h"
+
+static _Atomic uint64_t _bench_allocation_cnt = 0;
+static bool _header_printed = false;
+
+#if defined(__GLIBC__)
+/*
+ * Count heap allocations by interposing the allocator entry points,
+ * this also catches allocations made by gmp, nettle and secp256k1.
+ */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+void *
+malloc(size_t size)
+{
+  atomic_fetch_add_explicit(&_bench_allocation_cnt, 1, memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+  atomic_fetch_add_explicit(&_bench_allocation_cnt, 1, memory_order_relaxed);
+  return __libc_calloc(nmemb, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+  atomic_fetch_add_explicit(&_bench_allocation_cnt, 1, memory_order_relaxed);
+  return __libc_realloc(ptr, size);
+}
+
+void
+free(void *ptr)
+{
+  __libc_free(ptr);
+}
+#endif
+
+uint64_t
+bench_allocations(void)
+{
+  return atomic_load_explicit(&_bench_allocation_cnt, memory_order_relaxed);
+}
+
+static inline uint64_t
+_now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int
+_compare_double(const void *a, const void *b)
+{
+  double da = *(const double *)a, db = *(const double *)b;
+  return (da > db) - (da < db);
+}
+
+static void
+_bench_usage(const char *name)
+{
+  fprintf(stderr, "usage: %s <args>\n", name);
+  fputs("\n", stderr);
+  fputs("  -w, --warmup <ms>        Time spent running an operation before measuring, default 100ms.\n", stderr);
+  fputs("  -t, --min-time <ms>      Minimum total measured time for an operation, default 500ms.\n", stderr);
+  fputs("  -r, --repetitions <cnt>  Number of measured repetitions, default is 5.\n", stderr);
+  fputs("  -f, --filter <name>      Only run benchmarks which name contains <name>.\n", stderr);
+  fputs("\n", stderr);
+}
+
+int
+bench_init(bench_options_t *options, int argc, char **argv)
+{
+  int c;
+
+  options->warmup_ms = 100;
+  options->min_time_ms = 500;
+  options->repetitions = 5;
+  options->filter = NULL;
+
+  while (1)
+    {
+      int option_index = 0;
+      static struct option long_options[] = {
+        {"help",  no_argument, 0, 'h' },
+        {"warmup",  required_argument, 0, 'w' },
+        {"min-time",  required_argument, 0, 't' },
+        {"repetitions",  required_argument, 0, 'r' },
+        {"filter",  required_argument, 0, 'f' },
+        {0, 0, 0, 0}
+      };
+
+      c = getopt_long(argc, argv, "hw:t:r:f:", long_options, &option_index);
+      if (c == -1)
+        break;
+
+      switch (c) {
+      case 'h':
+        _bench_usage(argv[0]);
+        return -1;
+
+      case 'w':
+        options->warmup_ms = atoi(optarg);
+        break;
+
+      case 't':
+        options->min_time_ms = atoi(optarg);
+        break;
+
+      case 'r':
+        options->repetitions = atoi(optarg);
+        break;
+
+      case 'f':
+        options->filter = optarg;
+        break;
+      }
+    }
+
+  if (options->repetitions == 0)
+    options->repetitions = 1;
+  else if (options->repetitions > BENCH_MAX_REPETITIONS)
+    options->repetitions = BENCH_MAX_REPETITIONS;
+
+  return 0;
+}
+
+int
+bench_run(const bench_options_t *options, const char *name,
+          bench_fn_t fn, void *arg, bench_result_t *result)
+{
+  bench_result_t res = { .name = name };
+  double samples[options->repetitions];
+  uint64_t start, elapsed, warmup_cnt = 0, allocs;
+  uint64_t iterations;
+
+  if (options->filter && strstr(name, options->filter) == NULL)
+    return 0;
+
+  // warmup, also used to estimate the cost of one operation
+  start = _now_ns();
+  do {
+    if (fn(arg) != 0) {
+      fprintf(stdout, "%-36s failed\n", name);
+      return -1;
+    }
+    warmup_cnt++;
+    elapsed = _now_ns() - start;
+  } while (elapsed < options->warmup_ms * 1000000ull);
+
+  iterations = (options->min_time_ms * 1000000ull) / options->repetitions / (elapsed / warmup_cnt + 1);
+  if (iterations == 0)
+    iterations = 1;
+
+  allocs = bench_allocations();
+  for (uint32_t r = 0; r < options->repetitions; r++) {
+    start = _now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+      if (fn(arg) != 0) {
+        fprintf(stdout, "%-36s failed\n", name);
+        return -1;
+      }
+    }
+    samples[r] = (double)(_now_ns() - start) / iterations;
+  }
+  allocs = bench_allocations() - allocs;
+
+  res.sample_cnt = options->repetitions;
+  memcpy(res.samples, samples, sizeof(samples));
+
+  qsort(samples, options->repetitions, sizeof(double), _compare_double);
+  res.iterations = iterations * options->repetitions;
+  res.ns_per_op = samples[options->repetitions / 2];
+  res.ns_per_op_min = samples[0];
+  res.ns_per_op_max = samples[options->repetitions - 1];
+  res.ops_per_sec = 1000000000.0 / res.ns_per_op;
+  res.allocs_per_op = (double)allocs / res.iterations;
+
+  if (!_header_printed) {
+    fprintf(stdout, "%-36s %14s %14s %14s %14s %10s\n",
+            "benchmark", "ops/sec", "ns/op", "min ns/op", "max ns/op", "allocs/op");
+    _header_printed = true;
+  }
+
+  fprintf(stdout, "%-36s %14.1f %14.1f %14.1f %14.1f %10.2f\n",
+          name, res.ops_per_sec, res.ns_per_op,
+          res.ns_per_op_min, res.ns_per_op_max, res.allocs_per_op);
+  fflush(stdout);
+
+  if (result)
+    *result = res;
+
+  return 0;
+}
@@ -0,0 +1,42 @@
+#ifndef __bench_h
+#define __bench_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BENCH_MAX_REPETITIONS 64
+
+/** operation under benchmark, called once per iteration */
+typedef int (*bench_fn_t)(void *arg);
+
+typedef struct bench_options_t {
+  uint32_t warmup_ms;
+  uint32_t min_time_ms;
+  uint32_t repetitions;
+  const char *filter;
+} bench_options_t;
+
+typedef struct bench_result_t {
+  const char *name;
+  uint64_t iterations;
+  double ns_per_op;
+  double ns_per_op_min;
+  double ns_per_op_max;
+  double ops_per_sec;
+  double allocs_per_op;
+  uint32_t sample_cnt;
+  double samples[BENCH_MAX_REPETITIONS];
+} bench_result_t;
+
+/** parse common benchmark arguments, returns -1 if usage was requested */
+int bench_init(bench_options_t *options, int argc, char **argv);
+
+/** run a benchmark, report it to stdout and fill in result if not NULL */
+int bench_run(const bench_options_t *options, const char *name,
+              bench_fn_t fn, void *arg, bench_result_t *result);
+
+/** number of heap allocations made by the process so far */
+uint64_t bench_allocations(void);
+
+#endif
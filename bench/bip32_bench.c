@@ -0,0 +1,189 @@
+#include <stdlib.h>
+
+#include "bench.h"
+#include "../src/bip32.h"
+#include "../src/bip44.h"
+#include "../src/address.h"
+
+// bip39 seed of 'legal winner thank year wave sausage worth useful legal winner thank yellow' (TREZOR)
+static uint8_t seed[64] = {
+  0x87, 0x83, 0x86, 0xef, 0xb7, 0x88, 0x45, 0xb3, 0x35, 0x5b, 0xd1, 0x5e, 0xa4, 0xd3, 0x9e, 0xf9,
+  0x7d, 0x17, 0x9c, 0xb7, 0x12, 0xb7, 0x7d, 0x5c, 0x12, 0xb6, 0xbe, 0x41, 0x5f, 0xff, 0xef, 0xfe,
+  0x5f, 0x37, 0x7b, 0xa0, 0x2b, 0xf3, 0xf8, 0x54, 0x4a, 0xb8, 0x00, 0xb9, 0x55, 0xe5, 0x1f, 0xbf,
+  0xf0, 0x98, 0x28, 0xf6, 0x82, 0x05, 0x2a, 0x20, 0xfa, 0xa6, 0xad, 0xdb, 0xbd, 0xdf, 0xb0, 0x96
+};
+
+static bip32_key_t master_key;
+static bip32_key_t public_key;
+static const bip44_coin_t *bitcoin;
+static char encoded_key[256];
+
+static int
+_masterkey(void *arg)
+{
+  bip32_key_t key;
+  return bip32_key_init_from_entropy(&key, seed, sizeof(seed));
+}
+
+static int
+_derive_hardened(void *arg)
+{
+  bip32_key_t child;
+  return bip32_key_derive_child_key(&master_key, 0x80000000, &child);
+}
+
+static int
+_derive_normal(void *arg)
+{
+  bip32_key_t child;
+  return bip32_key_derive_child_key(&master_key, 0, &child);
+}
+
+static int
+_derive_path(void *arg)
+{
+  bip32_key_t child;
+  return bip32_key_derive_child_by_path(&master_key, "m/44'/0'/0'/0/0", &child);
+}
+
+static int
+_public_key(void *arg)
+{
+  bip32_key_t key;
+  return bip32_key_init_public_from_private_key(&key, &master_key);
+}
+
+static int
+_serialize_public_key(void *arg)
+{
+  uint8_t serialized[33];
+  return bip32_key_secp256k1_serialize_public_key(&public_key, true, serialized);
+}
+
+static int
+_p2pkh_address(void *arg)
+{
+  uint8_t address[64];
+  size_t size = sizeof(address);
+  return bip32_key_p2pkh_address_from_key(&public_key, address, &size);
+}
+
+static int
+_address(void *arg)
+{
+  char address[ADDRESS_MAX_SIZE];
+  size_t size = sizeof(address);
+  return address_from_key(&public_key, bitcoin, *(address_type_t *)arg, address, &size);
+}
+
+static const address_format_t address_set[] = {
+  { ADDRESS_P2PKH, ADDRESS_ENCODING_ADDRESS },
+  { ADDRESS_P2SH_P2WPKH, ADDRESS_ENCODING_ADDRESS },
+  { ADDRESS_P2WPKH, ADDRESS_ENCODING_ADDRESS },
+};
+
+static int
+_address_each(void *arg)
+{
+  char address[ADDRESS_MAX_SIZE];
+  int res = 0;
+  for (size_t f = 0; f < sizeof(address_set) / sizeof(address_set[0]); f++) {
+    size_t size = sizeof(address);
+    res |= address_from_key(&public_key, bitcoin, address_set[f].type, address, &size);
+  }
+  return res;
+}
+
+static int
+_address_set(void *arg)
+{
+  char addresses[sizeof(address_set) / sizeof(address_set[0]) * ADDRESS_MAX_SIZE];
+  return address_set_from_key(&public_key, bitcoin, address_set,
+                              sizeof(address_set) / sizeof(address_set[0]), addresses, ADDRESS_MAX_SIZE);
+}
+
+static int
+_scripthash(void *arg)
+{
+  char scripthash[ADDRESS_SCRIPTHASH_SIZE];
+  return address_scripthash_from_key(&public_key, bitcoin, ADDRESS_P2WPKH, scripthash);
+}
+
+static int
+_scripthash_range(void *arg)
+{
+  static const address_format_t format = { ADDRESS_P2WPKH, ADDRESS_ENCODING_SCRIPTHASH };
+  static char scripthashes[64 * ADDRESS_SCRIPTHASH_SIZE];
+  return address_set_range_from_key(&master_key, bitcoin, &format, 1, 0, 64,
+                                    scripthashes, ADDRESS_SCRIPTHASH_SIZE);
+}
+
+static int
+_derive_range(void *arg)
+{
+  bip32_key_t children[64];
+  return bip32_key_derive_child_range(&master_key, 0, 64, children);
+}
+
+static int
+_derive_normal_64(void *arg)
+{
+  bip32_key_t child;
+  int res = 0;
+  for (uint32_t i = 0; i < 64; i++)
+    res |= bip32_key_derive_child_key(&master_key, i, &child);
+  return res;
+}
+
+static int
+_base58check_encode(void *arg)
+{
+  uint8_t buf[256];
+  size_t size = sizeof(buf);
+  return bip32_key_serialize(&master_key, true, buf, &size);
+}
+
+static int
+_base58check_decode(void *arg)
+{
+  bip32_key_t key;
+  return bip32_key_deserialize(&key, encoded_key);
+}
+
+int
+main(int argc, char **argv)
+{
+  bench_options_t options;
+  size_t size = sizeof(encoded_key);
+  int res = 0;
+
+  if (bench_init(&options, argc, argv) != 0)
+    return EXIT_FAILURE;
+
+  bip32_key_init_from_entropy(&master_key, seed, sizeof(seed));
+  bip32_key_init_public_from_private_key(&public_key, &master_key);
+  bip32_key_serialize(&master_key, true, (uint8_t *)encoded_key, &size);
+  bitcoin = bip44_coin_by_symbol("BTC");
+
+  res |= bench_run(&options, "bip32.masterkey", _masterkey, NULL, NULL);
+  res |= bench_run(&options, "bip32.derive.hardened", _derive_hardened, NULL, NULL);
+  res |= bench_run(&options, "bip32.derive.normal", _derive_normal, NULL, NULL);
+  res |= bench_run(&options, "bip32.derive.path (m/44'/0'/0'/0/0)", _derive_path, NULL, NULL);
+  res |= bench_run(&options, "bip32.pubkey.create", _public_key, NULL, NULL);
+  res |= bench_run(&options, "bip32.pubkey.serialize", _serialize_public_key, NULL, NULL);
+  res |= bench_run(&options, "bip32.address.p2pkh", _p2pkh_address, NULL, NULL);
+  res |= bench_run(&options, "address.p2pkh", _address, &(address_type_t){ ADDRESS_P2PKH }, NULL);
+  res |= bench_run(&options, "address.p2sh-p2wpkh", _address, &(address_type_t){ ADDRESS_P2SH_P2WPKH }, NULL);
+  res |= bench_run(&options, "address.p2wpkh", _address, &(address_type_t){ ADDRESS_P2WPKH }, NULL);
+  res |= bench_run(&options, "address.p2tr", _address, &(address_type_t){ ADDRESS_P2TR }, NULL);
+  res |= bench_run(&options, "address.p2pkh+p2sh-p2wpkh+p2wpkh (each)", _address_each, NULL, NULL);
+  res |= bench_run(&options, "address.p2pkh+p2sh-p2wpkh+p2wpkh (set)", _address_set, NULL, NULL);
+  res |= bench_run(&options, "address.p2wpkh:scripthash", _scripthash, NULL, NULL);
+  res |= bench_run(&options, "address.range.p2wpkh:scripthash (64)", _scripthash_range, NULL, NULL);
+  res |= bench_run(&options, "bip32.derive.normal x64", _derive_normal_64, NULL, NULL);
+  res |= bench_run(&options, "bip32.derive.range (64)", _derive_range, NULL, NULL);
+  res |= bench_run(&options, "bip32.base58check.encode (xprv)", _base58check_encode, NULL, NULL);
+  res |= bench_run(&options, "bip32.base58check.decode (xprv)", _base58check_decode, NULL, NULL);
+
+  return res == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
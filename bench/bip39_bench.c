@@ -0,0 +1,53 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "../src/bip39.h"
+
+static const char *mnemonics = "legal winner thank year wave sausage worth useful legal winner thank yellow";
+static uint8_t entropy[16] = {
+  0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f
+};
+
+static int
+_to_mnemonics(void *arg)
+{
+  bip39_t ctx;
+  char **words;
+  size_t word_cnt;
+
+  (void)arg;
+  bip39_init(&ctx);
+  if (bip39_to_mnemonics(&ctx, entropy, sizeof(entropy) * 8, &words, &word_cnt) != 0)
+    return -1;
+
+  free(words);
+  return 0;
+}
+
+static int
+_to_seed(void *arg)
+{
+  bip39_t ctx;
+  uint8_t seed[64];
+
+  (void)arg;
+  bip39_init(&ctx);
+  return bip39_to_seed(&ctx, (const uint8_t *)mnemonics, strlen(mnemonics), 2048,
+                       (const uint8_t *)"TREZOR", seed);
+}
+
+int
+main(int argc, char **argv)
+{
+  bench_options_t options;
+  int res = 0;
+
+  if (bench_init(&options, argc, argv) != 0)
+    return EXIT_FAILURE;
+
+  res |= bench_run(&options, "bip39.mnemonics (128bit)", _to_mnemonics, NULL, NULL);
+  res |= bench_run(&options, "bip39.seed (pbkdf2, 2048 rounds)", _to_seed, NULL, NULL);
+
+  return res == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,76 @@
+#include <stdlib.h>
+
+#include "bench.h"
+#include "../src/bip85.h"
+
+static bip32_key_t master_key;
+static bip85_t bip85_bip39;
+static bip85_t bip85_xprv;
+static bip85_drng_t drng;
+
+static int
+_entropy(void *arg)
+{
+  uint8_t entropy[64];
+  return bip85_entropy_from_key(&master_key, "39'/0'/12'/0'", entropy);
+}
+
+static int
+_application_bip39(void *arg)
+{
+  char **words;
+  size_t word_cnt;
+
+  if (bip85_application_bip39(&master_key, 0, 12, 0, &words, &word_cnt) != 0)
+    return -1;
+
+  free(words);
+  return 0;
+}
+
+static int
+_bip39_from_index(void *arg)
+{
+  const char *words[BIP85_BIP39_MAX_WORDS];
+  size_t word_cnt;
+
+  return bip85_bip39_from_index(&bip85_bip39, 0, words, &word_cnt);
+}
+
+static int
+_xprv_from_index(void *arg)
+{
+  bip32_key_t child;
+  return bip85_xprv_from_index(&bip85_xprv, 0, &child);
+}
+
+static int
+_drng_read(void *arg)
+{
+  static uint8_t block[64 * 1024];
+  return bip85_drng_read(&drng, block, sizeof(block));
+}
+
+int
+main(int argc, char **argv)
+{
+  bench_options_t options;
+  int res = 0;
+
+  if (bench_init(&options, argc, argv) != 0)
+    return EXIT_FAILURE;
+
+  bip32_key_deserialize(&master_key, "xprv9s21ZrQH143K2LBWUUQRFXhucrQqBpKdRRxNVq2zBqsx8HVqFk2uYo8kmbaLLHRdqtQpUm98uKfu3vca1LqdGhUtyoFnCNkfmXRyPXLjbKb");
+
+  bip85_bip39_init(&bip85_bip39, &master_key, 0, 12);
+  bip85_xprv_init(&bip85_xprv, &master_key);
+  bip85_drng_init(&drng, &master_key, 0);
+
+  res |= bench_run(&options, "bip85.entropy (39'/0'/12'/0')", _entropy, NULL, NULL);
+  res |= bench_run(&options, "bip85.bip39 (12 words)", _application_bip39, NULL, NULL);
+  res |= bench_run(&options, "bip85.bip39 (12 words, cached node)", _bip39_from_index, NULL, NULL);
+  res |= bench_run(&options, "bip85.xprv (cached node)", _xprv_from_index, NULL, NULL);
+  res |= bench_run(&options, "bip85.drng (64 KiB)", _drng_read, NULL, NULL);
+
+  return res == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
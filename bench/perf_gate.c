@@ -0,0 +1,416 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "../src/bip32.h"
+#include "../src/bip39.h"
+
+// exit code used by meson to mark a test as skipped
+#define EXIT_SKIP 77
+
+#define MAX_OPERATIONS 32
+
+typedef struct perf_baseline_t {
+  char name[64];
+  uint32_t sample_cnt;
+  double samples[BENCH_MAX_REPETITIONS];
+} perf_baseline_t;
+
+// bip39 seed of 'legal winner thank year wave sausage worth useful legal winner thank yellow' (TREZOR)
+static uint8_t seed[64] = {
+  0x87, 0x83, 0x86, 0xef, 0xb7, 0x88, 0x45, 0xb3, 0x35, 0x5b, 0xd1, 0x5e, 0xa4, 0xd3, 0x9e, 0xf9,
+  0x7d, 0x17, 0x9c, 0xb7, 0x12, 0xb7, 0x7d, 0x5c, 0x12, 0xb6, 0xbe, 0x41, 0x5f, 0xff, 0xef, 0xfe,
+  0x5f, 0x37, 0x7b, 0xa0, 0x2b, 0xf3, 0xf8, 0x54, 0x4a, 0xb8, 0x00, 0xb9, 0x55, 0xe5, 0x1f, 0xbf,
+  0xf0, 0x98, 0x28, 0xf6, 0x82, 0x05, 0x2a, 0x20, 0xfa, 0xa6, 0xad, 0xdb, 0xbd, 0xdf, 0xb0, 0x96
+};
+
+static const char *mnemonics = "legal winner thank year wave sausage worth useful legal winner thank yellow";
+
+static bip32_key_t master_key;
+static bip32_key_t public_key;
+static char encoded_key[256];
+
+static int
+_derive_hardened(void *arg)
+{
+  bip32_key_t child;
+
+  (void)arg;
+  return bip32_key_derive_child_key(&master_key, 0x80000000, &child);
+}
+
+static int
+_derive_normal(void *arg)
+{
+  bip32_key_t child;
+
+  (void)arg;
+  return bip32_key_derive_child_key(&master_key, 0, &child);
+}
+
+static int
+_address_p2pkh(void *arg)
+{
+  uint8_t address[64];
+  size_t size = sizeof(address);
+
+  (void)arg;
+  return bip32_key_p2pkh_address_from_key(&public_key, address, &size);
+}
+
+static int
+_pbkdf2_seed(void *arg)
+{
+  bip39_t ctx;
+  uint8_t seed[64];
+
+  (void)arg;
+  bip39_init(&ctx);
+  return bip39_to_seed(&ctx, (const uint8_t *)mnemonics, strlen(mnemonics), 2048,
+                       (const uint8_t *)"TREZOR", seed);
+}
+
+static int
+_base58_encode(void *arg)
+{
+  uint8_t buf[256];
+  size_t size = sizeof(buf);
+
+  (void)arg;
+  return bip32_key_serialize(&master_key, true, buf, &size);
+}
+
+static int
+_base58_decode(void *arg)
+{
+  bip32_key_t key;
+
+  (void)arg;
+  return bip32_key_deserialize(&key, encoded_key);
+}
+
+static struct {
+  const char *name;
+  bench_fn_t fn;
+} operations[] = {
+  { "derive.hardened", _derive_hardened },
+  { "derive.normal", _derive_normal },
+  { "address.p2pkh", _address_p2pkh },
+  { "pbkdf2.bip39_seed", _pbkdf2_seed },
+  { "base58.encode", _base58_encode },
+  { "base58.decode", _base58_decode },
+  { NULL, NULL }
+};
+
+static int
+_write_baseline(const char *filename, const bench_result_t *results, size_t result_cnt)
+{
+  FILE *out = fopen(filename, "w");
+  if (out == NULL) {
+    perror("perf_gate: failed to open baseline for writing");
+    return -1;
+  }
+
+  fputs("{\n  \"operations\": [\n", out);
+  for (size_t i = 0; i < result_cnt; i++) {
+    fprintf(out, "    { \"name\": \"%s\", \"ns_per_op\": %.1f, \"samples\": [", results[i].name, results[i].ns_per_op);
+    for (uint32_t s = 0; s < results[i].sample_cnt; s++)
+      fprintf(out, "%s%.1f", s == 0 ? " " : ", ", results[i].samples[s]);
+    fprintf(out, " ] }%s\n", i != result_cnt - 1 ? "," : "");
+  }
+  fputs("  ]\n}\n", out);
+
+  fclose(out);
+  return 0;
+}
+
+static int
+_read_baseline(const char *filename, perf_baseline_t *baseline, size_t *baseline_cnt)
+{
+  char *data, *p;
+  long size;
+  size_t cnt = 0;
+  FILE *in = fopen(filename, "r");
+
+  if (in == NULL)
+    return -1;
+
+  fseek(in, 0, SEEK_END);
+  size = ftell(in);
+  fseek(in, 0, SEEK_SET);
+  if (size < 0) {
+    fclose(in);
+    return -2;
+  }
+
+  data = malloc(size + 1);
+  if (data == NULL) {
+    fclose(in);
+    return -3;
+  }
+
+  if (fread(data, 1, size, in) != (size_t)size) {
+    fclose(in);
+    free(data);
+    return -2;
+  }
+  data[size] = '\0';
+  fclose(in);
+
+  // the baseline is written by _write_baseline, only that layout is understood
+  p = data;
+  while (cnt < *baseline_cnt && (p = strstr(p, "\"name\"")) != NULL) {
+    char *name, *end;
+
+    name = strchr(p + 6, '"');
+    end = name ? strchr(name + 1, '"') : NULL;
+    if (end == NULL || (size_t)(end - name - 1) >= sizeof(baseline[cnt].name))
+      break;
+
+    memset(&baseline[cnt], 0, sizeof(perf_baseline_t));
+    memcpy(baseline[cnt].name, name + 1, end - name - 1);
+
+    p = strstr(end, "\"samples\"");
+    if (p == NULL || (p = strchr(p, '[')) == NULL)
+      break;
+    p++;
+
+    while (baseline[cnt].sample_cnt < BENCH_MAX_REPETITIONS) {
+      char *next;
+      double value = strtod(p, &next);
+      if (next == p)
+        break;
+      baseline[cnt].samples[baseline[cnt].sample_cnt++] = value;
+      p = next;
+      while (*p == ' ' || *p == ',')
+        p++;
+    }
+
+    cnt++;
+  }
+
+  free(data);
+  *baseline_cnt = cnt;
+  return cnt == 0 ? -3 : 0;
+}
+
+static int
+_compare_double(const void *a, const void *b)
+{
+  double da = *(const double *)a, db = *(const double *)b;
+  return (da > db) - (da < db);
+}
+
+static double
+_median(const double *samples, uint32_t cnt)
+{
+  double sorted[BENCH_MAX_REPETITIONS];
+  memcpy(sorted, samples, cnt * sizeof(double));
+  qsort(sorted, cnt, sizeof(double), _compare_double);
+  return (cnt % 2) ? sorted[cnt / 2] : (sorted[cnt / 2 - 1] + sorted[cnt / 2]) / 2.0;
+}
+
+/*
+ * One sided Mann-Whitney U test using the normal approximation with tie
+ * correction, returns the p-value for the hypothesis that the current
+ * samples are slower than the baseline samples.
+ */
+static double
+_mann_whitney_p_slower(const double *baseline, uint32_t n1, const double *current, uint32_t n2)
+{
+  uint32_t n = n1 + n2;
+  double values[2 * BENCH_MAX_REPETITIONS];
+  double rank_sum = 0.0, tie_sum = 0.0;
+
+  memcpy(values, baseline, n1 * sizeof(double));
+  memcpy(values + n1, current, n2 * sizeof(double));
+  qsort(values, n, sizeof(double), _compare_double);
+
+  // average ranks of tied values, and rank sum of the current samples
+  for (uint32_t i = 0; i < n; ) {
+    uint32_t j = i;
+    while (j + 1 < n && values[j + 1] == values[i])
+      j++;
+
+    double rank = (i + j + 2) / 2.0;
+    double t = j - i + 1;
+    tie_sum += t * t * t - t;
+
+    for (uint32_t c = 0; c < n2; c++)
+      if (current[c] == values[i])
+        rank_sum += rank;
+
+    i = j + 1;
+  }
+
+  double u = rank_sum - n2 * (n2 + 1) / 2.0;
+  double mean = n1 * n2 / 2.0;
+  double variance = (n1 * n2 / 12.0) * ((n + 1) - tie_sum / ((double)n * (n - 1)));
+  if (variance <= 0.0)
+    return u > mean ? 0.0 : 1.0;
+
+  double z = (u - mean - 0.5) / sqrt(variance);
+  return 0.5 * erfc(z / sqrt(2.0));
+}
+
+static void
+_perf_gate_usage(const char *name)
+{
+  fprintf(stderr, "usage: %s --baseline <file> <args>\n", name);
+  fputs("\n", stderr);
+  fputs("Measures derive, address, PBKDF2 and base58 operations and compares them against a\n", stderr);
+  fputs("recorded baseline. If the baseline file does not exist it is recorded and the run is\n", stderr);
+  fputs("reported as skipped.\n", stderr);
+  fputs("\n", stderr);
+  fputs("  -b, --baseline <file>    Baseline JSON file to compare against or record to.\n", stderr);
+  fputs("  -R, --record             Record a new baseline even if one exists.\n", stderr);
+  fputs("  -T, --threshold <pct>    Allowed slowdown of the median in percent, default is 10.\n", stderr);
+  fputs("  -a, --alpha <p>          Significance level of the Mann-Whitney U test, default is 0.01.\n", stderr);
+  fputs("  -r, --repetitions <cnt>  Number of measured repetitions per operation, default is 15.\n", stderr);
+  fputs("  -t, --min-time <ms>      Minimum total measured time per operation, default 1500ms.\n", stderr);
+  fputs("\n", stderr);
+  fputs("examples:\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Run the gate for a build using a baseline recorded from another build:\n", stderr);
+  fputs("\n", stderr);
+  fputs("      meson configure build -Dperf_baseline=$HOME/btct_perf_baseline.json\n", stderr);
+  fputs("      meson test -C build --suite perf\n", stderr);
+  fputs("\n", stderr);
+}
+
+int
+main(int argc, char **argv)
+{
+  int c;
+  bench_options_t options = { .warmup_ms = 200, .min_time_ms = 1500, .repetitions = 15 };
+  bench_result_t results[MAX_OPERATIONS];
+  perf_baseline_t baseline[MAX_OPERATIONS];
+  size_t result_cnt = 0, baseline_cnt = MAX_OPERATIONS;
+  const char *baseline_file = NULL;
+  bool record = false;
+  double threshold = 10.0;
+  double alpha = 0.01;
+  size_t size = sizeof(encoded_key);
+  int regressions = 0;
+
+  while (1)
+    {
+      int option_index = 0;
+      static struct option long_options[] = {
+        {"help",  no_argument, 0, 'h' },
+        {"baseline",  required_argument, 0, 'b' },
+        {"record",  no_argument, 0, 'R' },
+        {"threshold",  required_argument, 0, 'T' },
+        {"alpha",  required_argument, 0, 'a' },
+        {"repetitions",  required_argument, 0, 'r' },
+        {"min-time",  required_argument, 0, 't' },
+        {0, 0, 0, 0}
+      };
+
+      c = getopt_long(argc, argv, "hb:RT:a:r:t:", long_options, &option_index);
+      if (c == -1)
+        break;
+
+      switch (c) {
+      case 'h':
+        _perf_gate_usage(argv[0]);
+        return EXIT_FAILURE;
+
+      case 'b':
+        baseline_file = optarg;
+        break;
+
+      case 'R':
+        record = true;
+        break;
+
+      case 'T':
+        threshold = atof(optarg);
+        break;
+
+      case 'a':
+        alpha = atof(optarg);
+        break;
+
+      case 'r':
+        options.repetitions = atoi(optarg);
+        break;
+
+      case 't':
+        options.min_time_ms = atoi(optarg);
+        break;
+      }
+    }
+
+  if (baseline_file == NULL) {
+    _perf_gate_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (options.repetitions < 5 || options.repetitions > BENCH_MAX_REPETITIONS) {
+    fprintf(stderr, "perf_gate: repetitions must be within 5 and %d\n", BENCH_MAX_REPETITIONS);
+    return EXIT_FAILURE;
+  }
+
+  if (!record && _read_baseline(baseline_file, baseline, &baseline_cnt) != 0) {
+    fprintf(stderr, "perf_gate: no usable baseline in '%s', recording one\n", baseline_file);
+    record = true;
+  }
+
+  bip32_key_init_from_entropy(&master_key, seed, sizeof(seed));
+  bip32_key_init_public_from_private_key(&public_key, &master_key);
+  bip32_key_serialize(&master_key, true, (uint8_t *)encoded_key, &size);
+
+  for (size_t i = 0; operations[i].name != NULL; i++) {
+    if (bench_run(&options, operations[i].name, operations[i].fn, NULL, &results[result_cnt]) != 0)
+      return EXIT_FAILURE;
+    result_cnt++;
+  }
+
+  if (record) {
+    if (_write_baseline(baseline_file, results, result_cnt) != 0)
+      return EXIT_FAILURE;
+    fprintf(stdout, "\nperf_gate: recorded baseline to '%s'\n", baseline_file);
+    return EXIT_SKIP;
+  }
+
+  fprintf(stdout, "\n%-36s %14s %14s %9s %9s  %s\n",
+          "operation", "baseline ns/op", "current ns/op", "change", "p-value", "verdict");
+
+  for (size_t i = 0; i < result_cnt; i++) {
+    perf_baseline_t *base = NULL;
+    for (size_t b = 0; b < baseline_cnt; b++)
+      if (strcmp(baseline[b].name, results[i].name) == 0)
+        base = &baseline[b];
+
+    if (base == NULL || base->sample_cnt < 2) {
+      fprintf(stdout, "%-36s %14s %14.1f %9s %9s  %s\n", results[i].name, "-",
+              results[i].ns_per_op, "-", "-", "not in baseline");
+      continue;
+    }
+
+    double base_median = _median(base->samples, base->sample_cnt);
+    double current_median = _median(results[i].samples, results[i].sample_cnt);
+    double change = 100.0 * (current_median - base_median) / base_median;
+    double p = _mann_whitney_p_slower(base->samples, base->sample_cnt,
+                                      results[i].samples, results[i].sample_cnt);
+    bool regression = change > threshold && p < alpha;
+
+    fprintf(stdout, "%-36s %14.1f %14.1f %+8.1f%% %9.4f  %s\n", results[i].name,
+            base_median, current_median, change, p, regression ? "REGRESSION" : "ok");
+
+    if (regression)
+      regressions++;
+  }
+
+  if (regressions) {
+    fprintf(stdout, "\nperf_gate: %d operation(s) regressed more than %.1f%% (alpha %.3f)\n",
+            regressions, threshold, alpha);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "sss.h"
+#include "../src/shamir.h"
+
+#define BATCH_SECRETS 1000
+#define BATCH_SECRET_SIZE 32
+
+static uint8_t secret[sss_MLEN];
+static sss_Share shares[5];
+static uint8_t shamir_shares[5 * sss_MLEN];
+static uint8_t batch[BATCH_SECRETS * BATCH_SECRET_SIZE];
+static uint8_t batch_shares[5 * sizeof(batch)];
+
+static int
+_split(void *arg)
+{
+  sss_Share out[5];
+
+  (void)arg;
+  sss_create_shares(out, secret, 5, 3);
+  return 0;
+}
+
+static int
+_combine(void *arg)
+{
+  uint8_t out[sss_MLEN];
+
+  (void)arg;
+  return sss_combine_shares(out, (const sss_Share *)shares, 3);
+}
+
+static int
+_split_batch(void *arg)
+{
+  sss_Share out[5];
+  uint8_t message[sss_MLEN] = { 0 };
+
+  (void)arg;
+
+  // sss splits whole sss_MLEN byte messages, each secret is zero padded to one
+  for (size_t i = 0; i < BATCH_SECRETS; i++) {
+    memcpy(message, batch + i * BATCH_SECRET_SIZE, BATCH_SECRET_SIZE);
+    sss_create_shares(out, message, 5, 3);
+  }
+  return 0;
+}
+
+static int
+_shamir_split(void *arg)
+{
+  uint8_t out[5 * sss_MLEN];
+
+  (void)arg;
+  return shamir_split(secret, sizeof(secret), 5, 3, out);
+}
+
+static int
+_shamir_combine(void *arg)
+{
+  static const uint8_t xs[] = { 1, 2, 3 };
+  uint8_t out[sss_MLEN];
+
+  (void)arg;
+  return shamir_combine(xs, shamir_shares, sizeof(out), 3, out);
+}
+
+static int
+_shamir_split_batch(void *arg)
+{
+  (void)arg;
+  return shamir_split(batch, sizeof(batch), 5, 3, batch_shares);
+}
+
+static int
+_shamir_combine_batch(void *arg)
+{
+  static const uint8_t xs[] = { 1, 2, 3 };
+  static uint8_t out[sizeof(batch)];
+
+  (void)arg;
+  return shamir_combine(xs, batch_shares, sizeof(out), 3, out);
+}
+
+int
+main(int argc, char **argv)
+{
+  bench_options_t options;
+  int res = 0;
+
+  if (bench_init(&options, argc, argv) != 0)
+    return EXIT_FAILURE;
+
+  memset(secret, 0x7f, sizeof(secret));
+  sss_create_shares(shares, secret, 5, 3);
+
+  res |= bench_run(&options, "sss.split (3 of 5)", _split, NULL, NULL);
+  res |= bench_run(&options, "sss.combine (3 of 5)", _combine, NULL, NULL);
+
+  // vendored sss against the GF(2^8) engine, single secrets and a batch
+  memset(batch, 0x7f, sizeof(batch));
+  shamir_split(secret, sizeof(secret), 5, 3, shamir_shares);
+  shamir_split(batch, sizeof(batch), 5, 3, batch_shares);
+
+  res |= bench_run(&options, "shamir.split (3 of 5)", _shamir_split, NULL, NULL);
+  res |= bench_run(&options, "shamir.combine (3 of 5)", _shamir_combine, NULL, NULL);
+  res |= bench_run(&options, "sss.split batch (1000x32B)", _split_batch, NULL, NULL);
+  res |= bench_run(&options, "shamir.split batch (1000x32B)", _shamir_split_batch, NULL, NULL);
+  res |= bench_run(&options, "shamir.combine batch (1000x32B)", _shamir_combine_batch, NULL, NULL);
+
+  shamir_use_simd(false);
+  res |= bench_run(&options, "shamir.split scalar (1000x32B)", _shamir_split_batch, NULL, NULL);
+  res |= bench_run(&options, "shamir.combine scalar (1000x32B)", _shamir_combine_batch, NULL, NULL);
+
+  return res == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
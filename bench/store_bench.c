@@ -0,0 +1,66 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "../src/store.h"
+
+static const char *mnemonics = "legal winner thank year wave sausage worth useful legal winner thank yellow";
+
+static int
+_unlock(void *arg)
+{
+  char sentence[512];
+  size_t size = sizeof(sentence);
+  return store_read_mnemonics(NULL, "password", NULL, (uint8_t *)sentence, &size);
+}
+
+static int
+_masterkey(void *arg)
+{
+  const char *label = arg;
+  bip32_key_t key;
+  store_t store;
+  int index, res = -1;
+
+  if (store_open(&store, NULL) != 0)
+    return -1;
+
+  index = store_find_by_label(&store, label);
+  if (index >= 0 && store_unlock(&store, "password") == 0)
+    res = store_masterkey(&store, index, NULL, &key);
+
+  store_close(&store);
+  return res;
+}
+
+int
+main(int argc, char **argv)
+{
+  bench_options_t options;
+  char home[] = "/tmp/btct_store_bench.XXXXXX";
+  char file[64];
+  int res = 0;
+
+  if (bench_init(&options, argc, argv) != 0)
+    return EXIT_FAILURE;
+
+  // keep the benchmark away from the users store
+  if (mkdtemp(home) == NULL)
+    return EXIT_FAILURE;
+  setenv("HOME", home, 1);
+
+  if (store_write_mnemonics(NULL, "password", NULL, (const uint8_t *)mnemonics) != 0
+      || store_write_wallet(NULL, "password", "cached", (const uint8_t *)mnemonics, NULL,
+                            STORE_SECTION_MASTERKEY, 0) != 0)
+    return EXIT_FAILURE;
+
+  res |= bench_run(&options, "store.unlock (pbkdf2, 4096 rounds)", _unlock, NULL, NULL);
+  res |= bench_run(&options, "store.masterkey (from mnemonics)", _masterkey, STORE_DEFAULT_LABEL, NULL);
+  res |= bench_run(&options, "store.masterkey (cached)", _masterkey, "cached", NULL);
+
+  snprintf(file, sizeof(file), "%s/.btct.dat", home);
+  unlink(file);
+  rmdir(home);
+
+  return res == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,55 @@
+#include <stdlib.h>
+
+#include "bench.h"
+#include "../src/utils.h"
+
+static uint8_t public_key[33] = {
+  0x03, 0x79, 0xbe, 0x66, 0x7e, 0xf9, 0xdc, 0xbb, 0xac, 0x55, 0xa0, 0x62, 0x95, 0xce, 0x87, 0x0b,
+  0x07, 0x02, 0x9b, 0xfc, 0xdb, 0x2d, 0xce, 0x28, 0xd9, 0x59, 0xf2, 0x81, 0x5b, 0x16, 0xf8, 0x17,
+  0x98
+};
+
+static int
+_hash160(void *arg)
+{
+  uint8_t hash[20];
+  return utils_hash160(public_key, sizeof(public_key), hash);
+}
+
+static int
+_base85_encode(void *arg)
+{
+  char result[128];
+  return utils_base85_encode(public_key, 32, result);
+}
+
+static int
+_to_hex_string(void *arg)
+{
+  char result[128];
+  return utils_to_hex_string(public_key, sizeof(public_key), result);
+}
+
+static int
+_fill_random(void *arg)
+{
+  uint8_t random[32];
+  return utils_fill_random(random, sizeof(random));
+}
+
+int
+main(int argc, char **argv)
+{
+  bench_options_t options;
+  int res = 0;
+
+  if (bench_init(&options, argc, argv) != 0)
+    return EXIT_FAILURE;
+
+  res |= bench_run(&options, "utils.hash160", _hash160, NULL, NULL);
+  res |= bench_run(&options, "utils.base85.encode", _base85_encode, NULL, NULL);
+  res |= bench_run(&options, "utils.hex.encode", _to_hex_string, NULL, NULL);
+  res |= bench_run(&options, "utils.fill_random (32 bytes)", _fill_random, NULL, NULL);
+
+  return res == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,375 @@
+#include <stdlib.h>
+#include <string.h>
+#include <nettle/ripemd160.h>
+#include <nettle/sha2.h>
+
+#include "../external/libbase58/libbase58.h"
+
+#include "address.h"
+#include "bech32.h"
+#include "stats.h"
+#include "utils.h"
+
+/** children derived at once by address_range_from_key */
+#define ADDRESS_RANGE_BLOCK 64
+
+static const struct {
+  const char *name;
+  uint32_t purpose;
+  /** size of the scriptPubKey */
+  size_t script_size;
+} _address_types[ADDRESS_TYPE_CNT] = {
+  [ADDRESS_P2PKH] = { "p2pkh", 44, 25 },
+  [ADDRESS_P2SH_P2WPKH] = { "p2sh-p2wpkh", 49, 23 },
+  [ADDRESS_P2WPKH] = { "p2wpkh", 84, 22 },
+  [ADDRESS_P2TR] = { "p2tr", 86, 34 },
+};
+
+int
+address_type_from_name(const char *name, address_type_t *type)
+{
+  for (int t = 0; t < ADDRESS_TYPE_CNT; t++) {
+    if (strcmp(name, _address_types[t].name) == 0) {
+      *type = t;
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+const char *
+address_type_name(address_type_t type)
+{
+  return type < ADDRESS_TYPE_CNT ? _address_types[type].name : NULL;
+}
+
+uint32_t
+address_type_purpose(address_type_t type)
+{
+  return type < ADDRESS_TYPE_CNT ? _address_types[type].purpose : 0;
+}
+
+/** base58check of version and hash160 */
+static int
+_base58_hash160(uint8_t version, const uint8_t *hash160, char *address, size_t *size)
+{
+  uint8_t buf[1 + RIPEMD160_DIGEST_SIZE + 4];
+
+  buf[0] = version;
+  memcpy(buf + 1, hash160, RIPEMD160_DIGEST_SIZE);
+  if (utils_sha256_checksum(buf, 1 + RIPEMD160_DIGEST_SIZE, buf + 1 + RIPEMD160_DIGEST_SIZE) != 0)
+    return -1;
+
+  STATS_INC(STATS_BASE58_ENCODE);
+  return b58enc(address, size, buf, sizeof(buf)) ? 0 : -2;
+}
+
+/**
+ * Hash work shared by all address types of one key, the compressed public
+ * key hash160 for the key hash types and the output key for taproot.
+ */
+typedef struct _address_key_t {
+  uint8_t pubkey[33];
+  uint8_t hash160[RIPEMD160_DIGEST_SIZE];
+  uint8_t output_key[32];
+} _address_key_t;
+
+static int
+_address_key_init(_address_key_t *prepared, const bip32_key_t *key, bool key_hash, bool taproot)
+{
+  bip32_key_t public_key;
+
+  if (key->public == false) {
+    if (bip32_key_init_public_from_private_key(&public_key, key) != 0)
+      return -1;
+    key = &public_key;
+  }
+
+  if (key_hash
+      && (bip32_key_secp256k1_serialize_public_key(key, true, prepared->pubkey) != 0
+          || utils_hash160(prepared->pubkey, sizeof(prepared->pubkey), prepared->hash160) != 0))
+    return -2;
+
+  if (taproot && bip32_key_p2tr_output_key(key, prepared->output_key) != 0)
+    return -2;
+
+  return 0;
+}
+
+/** hash160 of the p2sh-p2wpkh redeem script, the v0 witness program of the key hash */
+static int
+_address_redeem_hash(const _address_key_t *prepared, uint8_t *hash160)
+{
+  uint8_t script[2 + RIPEMD160_DIGEST_SIZE];
+
+  script[0] = 0x00;
+  script[1] = RIPEMD160_DIGEST_SIZE;
+  memcpy(script + 2, prepared->hash160, RIPEMD160_DIGEST_SIZE);
+  return utils_hash160(script, sizeof(script), hash160);
+}
+
+static int
+_address_encode(const _address_key_t *prepared, const bip44_coin_t *coin, address_type_t type,
+                char *address, size_t *size)
+{
+  uint8_t hash160[RIPEMD160_DIGEST_SIZE];
+
+  switch (type) {
+  case ADDRESS_P2PKH:
+    return _base58_hash160(coin->p2pkh, prepared->hash160, address, size) == 0 ? 0 : -3;
+
+  case ADDRESS_P2SH_P2WPKH:
+    if (_address_redeem_hash(prepared, hash160) != 0)
+      return -2;
+    return _base58_hash160(coin->p2sh, hash160, address, size) == 0 ? 0 : -3;
+
+  case ADDRESS_P2WPKH:
+    return bech32_segwit_address_encode(coin->hrp, 0, prepared->hash160, RIPEMD160_DIGEST_SIZE,
+                                        address, size) == 0 ? 0 : -3;
+
+  case ADDRESS_P2TR:
+    return bech32_segwit_address_encode(coin->hrp, 1, prepared->output_key,
+                                        sizeof(prepared->output_key), address, size) == 0 ? 0 : -3;
+
+  default:
+    return -1;
+  }
+}
+
+/** write the scriptPubKey of type, _address_types[type].script_size bytes */
+static int
+_address_script(const _address_key_t *prepared, address_type_t type, uint8_t *script)
+{
+  switch (type) {
+  case ADDRESS_P2PKH:
+    // OP_DUP OP_HASH160 <hash160> OP_EQUALVERIFY OP_CHECKSIG
+    script[0] = 0x76;
+    script[1] = 0xa9;
+    script[2] = RIPEMD160_DIGEST_SIZE;
+    memcpy(script + 3, prepared->hash160, RIPEMD160_DIGEST_SIZE);
+    script[23] = 0x88;
+    script[24] = 0xac;
+    return 0;
+
+  case ADDRESS_P2SH_P2WPKH:
+    // OP_HASH160 <redeem hash160> OP_EQUAL
+    script[0] = 0xa9;
+    script[1] = RIPEMD160_DIGEST_SIZE;
+    script[22] = 0x87;
+    return _address_redeem_hash(prepared, script + 2) == 0 ? 0 : -2;
+
+  case ADDRESS_P2WPKH:
+    // OP_0 <hash160>
+    script[0] = 0x00;
+    script[1] = RIPEMD160_DIGEST_SIZE;
+    memcpy(script + 2, prepared->hash160, RIPEMD160_DIGEST_SIZE);
+    return 0;
+
+  case ADDRESS_P2TR:
+    // OP_1 <output key>
+    script[0] = 0x51;
+    script[1] = sizeof(prepared->output_key);
+    memcpy(script + 2, prepared->output_key, sizeof(prepared->output_key));
+    return 0;
+
+  default:
+    return -1;
+  }
+}
+
+/** electrum scripthash, the sha256 digest in reverse byte order as hex */
+static void
+_address_scripthash_hex(const uint8_t *digest, char *out)
+{
+  static const char hex[] = "0123456789abcdef";
+
+  for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
+    out[2 * i] = hex[digest[SHA256_DIGEST_SIZE - 1 - i] >> 4];
+    out[2 * i + 1] = hex[digest[SHA256_DIGEST_SIZE - 1 - i] & 0x0f];
+  }
+  out[2 * SHA256_DIGEST_SIZE] = '\0';
+}
+
+/**
+ * Formats of up to ADDRESS_RANGE_BLOCK keys, each key is serialized and
+ * hashed once and the scripts of each scripthash format are hashed as one
+ * batch.
+ */
+static int
+_address_set_encode(const bip32_key_t *keys, size_t key_cnt, const bip44_coin_t *coin,
+                    const address_format_t *formats, size_t format_cnt,
+                    char *addresses, size_t stride)
+{
+  _address_key_t prepared[ADDRESS_RANGE_BLOCK];
+  uint8_t scripts[ADDRESS_RANGE_BLOCK * ADDRESS_SCRIPT_MAX_SIZE];
+  uint8_t digests[ADDRESS_RANGE_BLOCK * SHA256_DIGEST_SIZE];
+  bool key_hash = false, taproot = false;
+
+  STATS_STAGE(STATS_STAGE_ADDRESS);
+
+  if (!bip44_coin_has_addresses(coin))
+    return -1;
+
+  for (size_t f = 0; f < format_cnt; f++) {
+    address_type_t type = formats[f].type;
+
+    if (type >= ADDRESS_TYPE_CNT || formats[f].encoding >= ADDRESS_ENCODING_CNT)
+      return -1;
+
+    // without a bech32 hrp the coin has no segwit
+    if (type != ADDRESS_P2PKH && coin->hrp == NULL)
+      return -1;
+
+    if (formats[f].encoding == ADDRESS_ENCODING_SCRIPTHASH && stride < 2 * SHA256_DIGEST_SIZE + 1)
+      return -1;
+
+    taproot |= type == ADDRESS_P2TR;
+    key_hash |= type != ADDRESS_P2TR;
+  }
+
+  for (size_t i = 0; i < key_cnt; i++) {
+    if (_address_key_init(&prepared[i], &keys[i], key_hash, taproot) != 0)
+      return -2;
+  }
+
+  for (size_t f = 0; f < format_cnt; f++) {
+    address_type_t type = formats[f].type;
+    size_t script_size = _address_types[type].script_size;
+
+    if (formats[f].encoding == ADDRESS_ENCODING_ADDRESS) {
+      for (size_t i = 0; i < key_cnt; i++) {
+        size_t size = stride;
+        if (_address_encode(&prepared[i], coin, type, addresses + (i * format_cnt + f) * stride,
+                            &size) != 0)
+          return -3;
+      }
+      continue;
+    }
+
+    for (size_t i = 0; i < key_cnt; i++) {
+      if (_address_script(&prepared[i], type, scripts + i * script_size) != 0)
+        return -3;
+    }
+
+    if (utils_sha256_batch(scripts, script_size, key_cnt, digests) != 0)
+      return -3;
+
+    for (size_t i = 0; i < key_cnt; i++)
+      _address_scripthash_hex(digests + i * SHA256_DIGEST_SIZE,
+                              addresses + (i * format_cnt + f) * stride);
+  }
+
+  return 0;
+}
+
+int
+address_formats_from_names(char *names, address_format_t *formats, size_t *count)
+{
+  char *name, *saveptr = NULL;
+  size_t n = 0;
+
+  for (name = strtok_r(names, ",", &saveptr); name != NULL; name = strtok_r(NULL, ",", &saveptr)) {
+    char *encoding = strchr(name, ':');
+
+    if (n == ADDRESS_FORMAT_MAX)
+      return -1;
+
+    formats[n].encoding = ADDRESS_ENCODING_ADDRESS;
+    if (encoding != NULL) {
+      *encoding++ = '\0';
+      if (strcmp(encoding, "scripthash") != 0)
+        return -1;
+      formats[n].encoding = ADDRESS_ENCODING_SCRIPTHASH;
+    }
+
+    if (address_type_from_name(name, &formats[n].type) != 0)
+      return -1;
+
+    for (size_t f = 0; f < n; f++) {
+      if (formats[f].type == formats[n].type && formats[f].encoding == formats[n].encoding)
+        return -1;
+    }
+    n++;
+  }
+
+  if (n == 0)
+    return -1;
+
+  *count = n;
+  return 0;
+}
+
+int
+address_from_key(const bip32_key_t *key, const bip44_coin_t *coin, address_type_t type,
+                 char *address, size_t *size)
+{
+  _address_key_t prepared;
+
+  STATS_STAGE(STATS_STAGE_ADDRESS);
+
+  if (type >= ADDRESS_TYPE_CNT || !bip44_coin_has_addresses(coin))
+    return -1;
+
+  // without a bech32 hrp the coin has no segwit
+  if (type != ADDRESS_P2PKH && coin->hrp == NULL)
+    return -1;
+
+  if (_address_key_init(&prepared, key, type != ADDRESS_P2TR, type == ADDRESS_P2TR) != 0)
+    return -2;
+
+  return _address_encode(&prepared, coin, type, address, size);
+}
+
+int
+address_scripthash_from_key(const bip32_key_t *key, const bip44_coin_t *coin, address_type_t type,
+                            char *scripthash)
+{
+  address_format_t format = { type, ADDRESS_ENCODING_SCRIPTHASH };
+  return _address_set_encode(key, 1, coin, &format, 1, scripthash, ADDRESS_SCRIPTHASH_SIZE);
+}
+
+int
+address_set_from_key(const bip32_key_t *key, const bip44_coin_t *coin,
+                     const address_format_t *formats, size_t format_cnt,
+                     char *addresses, size_t stride)
+{
+  return _address_set_encode(key, 1, coin, formats, format_cnt, addresses, stride);
+}
+
+int
+address_range_from_key(const bip32_key_t *chain, const bip44_coin_t *coin,
+                       address_type_t type, uint32_t first, size_t count,
+                       char *addresses, size_t stride)
+{
+  address_format_t format = { type, ADDRESS_ENCODING_ADDRESS };
+  return address_set_range_from_key(chain, coin, &format, 1, first, count, addresses, stride);
+}
+
+int
+address_set_range_from_key(const bip32_key_t *chain, const bip44_coin_t *coin,
+                           const address_format_t *formats, size_t format_cnt,
+                           uint32_t first, size_t count, char *addresses, size_t stride)
+{
+  bip32_key_t children[ADDRESS_RANGE_BLOCK];
+  int res = 0;
+
+  for (size_t offset = 0; offset < count; offset += ADDRESS_RANGE_BLOCK) {
+    size_t block = count - offset < ADDRESS_RANGE_BLOCK ? count - offset : ADDRESS_RANGE_BLOCK;
+
+    if (bip32_key_derive_child_range(chain, first + offset, block, children) != 0) {
+      res = -1;
+      break;
+    }
+
+    if (_address_set_encode(children, block, coin, formats, format_cnt,
+                            addresses + offset * format_cnt * stride, stride) != 0)
+    {
+      res = -2;
+      break;
+    }
+  }
+
+  memset(children, 0, sizeof(children));
+  return res;
+}
@@ -0,0 +1,104 @@
+#ifndef __address_h
+#define __address_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bip32.h"
+#include "bip44_coin.h"
+
+/** longest address of any type including terminating zero */
+#define ADDRESS_MAX_SIZE 96
+/** electrum scripthash as hex including terminating zero */
+#define ADDRESS_SCRIPTHASH_SIZE 65
+/** longest scriptPubKey of any type */
+#define ADDRESS_SCRIPT_MAX_SIZE 34
+
+typedef enum address_type_t {
+  /** legacy pay to public key hash, bip44 */
+  ADDRESS_P2PKH,
+  /** segwit nested in pay to script hash, bip49 */
+  ADDRESS_P2SH_P2WPKH,
+  /** native segwit, bip84 */
+  ADDRESS_P2WPKH,
+  /** taproot key path spend, bip86 */
+  ADDRESS_P2TR,
+  ADDRESS_TYPE_CNT
+} address_type_t;
+
+typedef enum address_encoding_t {
+  /** the address string of the coin */
+  ADDRESS_ENCODING_ADDRESS,
+  /**
+   * sha256 of the scriptPubKey in reverse byte order as hex, the key of
+   * the electrum protocol blockchain.scripthash methods
+   */
+  ADDRESS_ENCODING_SCRIPTHASH,
+  ADDRESS_ENCODING_CNT
+} address_encoding_t;
+
+/** an address type and how it is written */
+typedef struct address_format_t {
+  address_type_t type;
+  address_encoding_t encoding;
+} address_format_t;
+
+#define ADDRESS_FORMAT_MAX (ADDRESS_TYPE_CNT * ADDRESS_ENCODING_CNT)
+
+/** parse an address type name as p2pkh, p2sh-p2wpkh, p2wpkh or p2tr */
+int address_type_from_name(const char *name, address_type_t *type);
+const char *address_type_name(address_type_t type);
+/** purpose of the bip44 style derivation path of the address type */
+uint32_t address_type_purpose(address_type_t type);
+
+/**
+ * Parse a comma separated list of formats, each an address type name
+ * optionally followed by ':scripthash', into at most ADDRESS_FORMAT_MAX
+ * formats. Each format is allowed once, names is modified.
+ */
+int address_formats_from_names(char *names, address_format_t *formats, size_t *count);
+
+/**
+ * Encode the address of type for key with the parameters of coin, fails
+ * for coins without address parameters and segwit types for coins
+ * without a bech32 hrp. On input size is the size of
+ * address, on success the length including the terminating zero.
+ */
+int address_from_key(const bip32_key_t *key, const bip44_coin_t *coin, address_type_t type,
+                     char *address, size_t *size);
+
+/**
+ * Write the electrum scripthash of the address of type for key to
+ * scripthash of ADDRESS_SCRIPTHASH_SIZE bytes.
+ */
+int address_scripthash_from_key(const bip32_key_t *key, const bip44_coin_t *coin, address_type_t type,
+                                char *scripthash);
+
+/**
+ * Encode several formats for one key, the public key is serialized and
+ * hashed once for all of them. formats[f] is written to
+ * addresses + f * stride.
+ */
+int address_set_from_key(const bip32_key_t *key, const bip44_coin_t *coin,
+                         const address_format_t *formats, size_t format_cnt,
+                         char *addresses, size_t stride);
+
+/**
+ * Derive the children first to first + count - 1 of the private chain key
+ * and write their addresses of type to addresses, address i at
+ * addresses + i * stride. stride should be ADDRESS_MAX_SIZE.
+ */
+int address_range_from_key(const bip32_key_t *chain, const bip44_coin_t *coin,
+                           address_type_t type, uint32_t first, size_t count,
+                           char *addresses, size_t stride);
+
+/**
+ * Formats of each child of a range, formats[f] of child i at
+ * addresses + (i * format_cnt + f) * stride. The scripts of a scripthash
+ * format are hashed in batches of children.
+ */
+int address_set_range_from_key(const bip32_key_t *chain, const bip44_coin_t *coin,
+                               const address_format_t *formats, size_t format_cnt,
+                               uint32_t first, size_t count, char *addresses, size_t stride);
+
+#endif
@@ -0,0 +1,389 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "agent.h"
+#include "utils.h"
+
+static volatile sig_atomic_t _agent_stop = 0;
+
+static void
+_agent_signal(int signum)
+{
+  (void)signum;
+  _agent_stop = 1;
+}
+
+static time_t
+_agent_now(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec;
+}
+
+static bool
+_agent_expired(const agent_t *ctx)
+{
+  return ctx->expires && ctx->expires - _agent_now() <= 0;
+}
+
+static int
+_agent_lock_memory(agent_t *ctx)
+{
+  if (mlock(ctx->master, ctx->locked_size) != 0)
+    return -1;
+
+#ifdef MADV_DONTDUMP
+  madvise(ctx->master, ctx->locked_size, MADV_DONTDUMP);
+#endif
+  return 0;
+}
+
+int
+agent_init(agent_t *ctx, const bip32_key_t *master, uint32_t ttl)
+{
+  memset(ctx, 0, sizeof(agent_t));
+  ctx->fd = -1;
+
+  // keep secrets out of core dumps and away from ptrace of same user
+  prctl(PR_SET_DUMPABLE, 0);
+
+  ctx->locked_size = sysconf(_SC_PAGESIZE);
+  ctx->master = mmap(NULL, ctx->locked_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ctx->master == MAP_FAILED) {
+    ctx->master = NULL;
+    return -1;
+  }
+
+  if (_agent_lock_memory(ctx) != 0) {
+    munmap(ctx->master, ctx->locked_size);
+    ctx->master = NULL;
+    return -2;
+  }
+
+  memcpy(ctx->master, master, sizeof(bip32_key_t));
+  ctx->expires = ttl ? _agent_now() + ttl : 0;
+  return 0;
+}
+
+int
+agent_listen(agent_t *ctx, const char *path)
+{
+  struct sockaddr_un addr = { .sun_family = AF_UNIX };
+  mode_t mask;
+
+  if (path == NULL) {
+    snprintf(ctx->dir, sizeof(ctx->dir), "/tmp/btct-XXXXXX");
+    if (mkdtemp(ctx->dir) == NULL) {
+      ctx->dir[0] = '\0';
+      return -1;
+    }
+    snprintf(ctx->path, sizeof(ctx->path), "%s/agent.%d", ctx->dir, getpid());
+  }
+  else if (snprintf(ctx->path, sizeof(ctx->path), "%s", path) >= (int)sizeof(ctx->path))
+    return -2;
+
+  ctx->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (ctx->fd == -1)
+    return -3;
+
+  memcpy(addr.sun_path, ctx->path, sizeof(addr.sun_path));
+
+  // only the owner may connect to the socket
+  mask = umask(0177);
+  if (bind(ctx->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    umask(mask);
+    ctx->path[0] = '\0';
+    return -4;
+  }
+  umask(mask);
+
+  if (listen(ctx->fd, 16) != 0)
+    return -5;
+
+  return 0;
+}
+
+pid_t
+agent_daemonize(agent_t *ctx)
+{
+  pid_t pid = fork();
+  if (pid == -1)
+    return -1;
+
+  if (pid > 0) {
+    // parent leaves socket in place for the child
+    utils_wipe(ctx->master, sizeof(bip32_key_t));
+    munmap(ctx->master, ctx->locked_size);
+    ctx->master = NULL;
+    close(ctx->fd);
+    ctx->fd = -1;
+    return pid;
+  }
+
+  // memory locks are not inherited over fork
+  if (_agent_lock_memory(ctx) != 0) {
+    agent_clear(ctx);
+    _exit(EXIT_FAILURE);
+  }
+
+  setsid();
+
+  int fd = open("/dev/null", O_RDWR);
+  if (fd != -1) {
+    dup2(fd, STDIN_FILENO);
+    dup2(fd, STDOUT_FILENO);
+    dup2(fd, STDERR_FILENO);
+    if (fd > STDERR_FILENO)
+      close(fd);
+  }
+
+  return 0;
+}
+
+static int
+_agent_handle_request(agent_t *ctx, char *request, char *response, size_t size)
+{
+  bip32_key_t child, public_key;
+  bip32_key_t *key = &child;
+  uint8_t encoded[128];
+  size_t encoded_size = sizeof(encoded);
+  bool public;
+
+  if (strcmp(request, "LOCK") == 0) {
+    snprintf(response, size, "OK locked\n");
+    return 1;
+  }
+
+  if (strncmp(request, "DERIVE ", 7) == 0)
+    public = false;
+  else if (strncmp(request, "PUBLIC ", 7) == 0)
+    public = true;
+  else {
+    snprintf(response, size, "ERR unknown request\n");
+    return 0;
+  }
+
+  if (bip32_key_derive_child_by_path(ctx->master, request + 7, &child) != 0) {
+    snprintf(response, size, "ERR failed to derive path\n");
+    goto out;
+  }
+
+  if (public) {
+    if (bip32_key_init_public_from_private_key(&public_key, &child) != 0) {
+      snprintf(response, size, "ERR failed to create public key\n");
+      goto out;
+    }
+    key = &public_key;
+  }
+
+  if (bip32_key_serialize(key, true, encoded, &encoded_size) != 0) {
+    snprintf(response, size, "ERR failed to serialize key\n");
+    goto out;
+  }
+
+  snprintf(response, size, "OK %s\n", encoded);
+
+ out:
+  utils_wipe(&child, sizeof(child));
+  utils_wipe(encoded, sizeof(encoded));
+  return 0;
+}
+
+static bool
+_agent_peer_allowed(int fd)
+{
+  struct ucred cred;
+  socklen_t len = sizeof(cred);
+
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0)
+    return false;
+
+  return cred.uid == getuid();
+}
+
+/**
+ * Serve request lines of one client until it disconnects, returns 1
+ * when the client requested the agent to lock or the ttl expired while
+ * it was connected.
+ */
+static int
+_agent_handle_client(agent_t *ctx, int fd)
+{
+  char buf[AGENT_LINE_SIZE], response[AGENT_LINE_SIZE];
+  size_t length = 0;
+  int res = 0;
+
+  while (res == 0 && !_agent_stop) {
+    ssize_t bytes = read(fd, buf + length, sizeof(buf) - length);
+    if (bytes < 0 && errno == EINTR)
+      continue;
+    if (bytes <= 0)
+      break;
+    length += bytes;
+
+    char *line = buf, *end;
+    while (res == 0 && (end = memchr(line, '\n', length - (line - buf))) != NULL) {
+      *end = '\0';
+
+      // a connected client must not outlive the ttl, the key is wiped right away
+      if (_agent_expired(ctx)) {
+        utils_wipe(ctx->master, sizeof(bip32_key_t));
+        snprintf(response, sizeof(response), "ERR agent expired\n");
+        res = 1;
+      }
+      else
+        res = _agent_handle_request(ctx, line, response, sizeof(response));
+      if (write(fd, response, strlen(response)) < 0)
+        res = -1;
+      utils_wipe(response, sizeof(response));
+      line = end + 1;
+    }
+
+    length -= line - buf;
+    memmove(buf, line, length);
+
+    // a line that does not fit is not a request we serve
+    if (length == sizeof(buf))
+      break;
+  }
+
+  utils_wipe(buf, sizeof(buf));
+  return res == 1 ? 1 : 0;
+}
+
+int
+agent_serve(agent_t *ctx)
+{
+  struct sigaction sa = { .sa_handler = _agent_signal };
+  struct timeval timeout = { .tv_sec = 5 };
+
+  // no SA_RESTART, poll must return when signaled
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  sigaction(SIGHUP, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  while (!_agent_stop) {
+    struct pollfd pfd = { .fd = ctx->fd, .events = POLLIN };
+    int wait = -1;
+
+    if (_agent_expired(ctx))
+      break;
+    if (ctx->expires)
+      wait = (ctx->expires - _agent_now()) * 1000;
+
+    int res = poll(&pfd, 1, wait);
+    if (res < 0 && errno != EINTR)
+      return -1;
+    if (res <= 0)
+      continue;
+
+    int fd = accept4(ctx->fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd == -1)
+      continue;
+
+    // a stalled client must not block the agent
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    if (_agent_peer_allowed(fd) && _agent_handle_client(ctx, fd) == 1)
+      _agent_stop = 1;
+
+    close(fd);
+  }
+
+  return 0;
+}
+
+void
+agent_clear(agent_t *ctx)
+{
+  if (ctx->master != NULL) {
+    utils_wipe(ctx->master, ctx->locked_size);
+    munlock(ctx->master, ctx->locked_size);
+    munmap(ctx->master, ctx->locked_size);
+    ctx->master = NULL;
+  }
+
+  if (ctx->fd != -1) {
+    close(ctx->fd);
+    ctx->fd = -1;
+  }
+
+  if (ctx->path[0] != '\0')
+    unlink(ctx->path);
+
+  if (ctx->dir[0] != '\0')
+    rmdir(ctx->dir);
+
+  ctx->path[0] = '\0';
+  ctx->dir[0] = '\0';
+}
+
+int
+agent_connect(const char *path)
+{
+  struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+  if (path == NULL)
+    path = getenv(AGENT_SOCKET_ENV);
+
+  if (path == NULL || strlen(path) >= sizeof(addr.sun_path))
+    return -1;
+
+  strcpy(addr.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd == -1)
+    return -2;
+
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return -3;
+  }
+
+  return fd;
+}
+
+int
+agent_request(int fd, const char *request, char *response, size_t size)
+{
+  char line[AGENT_LINE_SIZE];
+  size_t length = 0;
+
+  if (snprintf(line, sizeof(line), "%s\n", request) >= (int)sizeof(line))
+    return -1;
+
+  if (write(fd, line, strlen(line)) < 0)
+    return -2;
+
+  // responses are read a byte at a time to never consume the next one
+  while (length + 1 < size) {
+    ssize_t bytes = read(fd, response + length, 1);
+    if (bytes < 0 && errno == EINTR)
+      continue;
+    if (bytes <= 0)
+      return -3;
+
+    if (response[length] == '\n')
+      break;
+    length++;
+  }
+
+  response[length] = '\0';
+  return strncmp(response, "OK ", 3) == 0 ? 0 : -4;
+}
@@ -0,0 +1,54 @@
+#ifndef __agent_h__
+#define __agent_h__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+
+#include "bip32.h"
+
+/** environment variable holding the agent socket path for clients */
+#define AGENT_SOCKET_ENV "BTCT_AGENT_SOCK"
+/** longest request or response line exchanged with the agent */
+#define AGENT_LINE_SIZE 512
+
+/**
+ * Agent holding an unlocked master key in locked memory, serving key
+ * derivations on a UNIX socket until the time to live expires.
+ *
+ * Requests are one line each, "DERIVE <path>" responds with the encoded
+ * private key and "PUBLIC <path>" with the encoded public key of the
+ * path, "LOCK" wipes the key and stops the agent. Responses are either
+ * "OK <key>" or "ERR <reason>".
+ */
+typedef struct agent_t {
+  int fd;
+  char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+  char dir[64];
+  bip32_key_t *master;
+  size_t locked_size;
+  time_t expires;
+} agent_t;
+
+/** copy master key into locked memory, ttl in seconds where 0 never expires */
+int agent_init(agent_t *ctx, const bip32_key_t *master, uint32_t ttl);
+/** create listening socket at path, or in a new private directory if NULL */
+int agent_listen(agent_t *ctx, const char *path);
+/**
+ * Fork the agent into the background. Returns the child pid in the
+ * parent which has its copy of the key wiped, and 0 in the child.
+ */
+pid_t agent_daemonize(agent_t *ctx);
+/** serve requests until the ttl expires, LOCK is requested or a signal */
+int agent_serve(agent_t *ctx);
+/** wipe and unlock key memory, close and remove the socket */
+void agent_clear(agent_t *ctx);
+
+/** connect to agent at path, or the path in AGENT_SOCKET_ENV if NULL */
+int agent_connect(const char *path);
+/** send one request line and read the response line without newline */
+int agent_request(int fd, const char *request, char *response, size_t size);
+
+#endif
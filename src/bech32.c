@@ -0,0 +1,87 @@
+#include <string.h>
+
+#include "bech32.h"
+
+#define BECH32_CONST 1
+#define BECH32M_CONST 0x2bc830a3
+
+static const char _charset[] = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+
+static uint32_t
+_polymod_step(uint32_t chk, uint8_t value)
+{
+  uint8_t top = chk >> 25;
+
+  chk = (chk & 0x1ffffff) << 5 ^ value;
+  if (top & 1) chk ^= 0x3b6a57b2;
+  if (top & 2) chk ^= 0x26508e6d;
+  if (top & 4) chk ^= 0x1ea119fa;
+  if (top & 8) chk ^= 0x3d4233dd;
+  if (top & 16) chk ^= 0x2a1462b3;
+  return chk;
+}
+
+int
+bech32_segwit_address_encode(const char *hrp, uint8_t version,
+                             const uint8_t *program, size_t program_size,
+                             char *address, size_t *size)
+{
+  uint8_t data[1 + (40 * 8 + 4) / 5];
+  size_t hrp_size = strlen(hrp), data_size = 0, length;
+  uint32_t chk = 1, acc = 0;
+  int bits = 0;
+
+  // witness program rules of bip141, v0 is either p2wpkh or p2wsh
+  if (version > 16 || program_size < 2 || program_size > 40
+      || (version == 0 && program_size != 20 && program_size != 32))
+    return -1;
+
+  if (hrp_size == 0 || hrp_size > 83)
+    return -1;
+
+  // version as one 5 bit group followed by the program regrouped to 5 bits
+  data[data_size++] = version;
+  for (size_t i = 0; i < program_size; i++) {
+    acc = (acc << 8 | program[i]) & 0xfff;
+    bits += 8;
+    while (bits >= 5) {
+      bits -= 5;
+      data[data_size++] = (acc >> bits) & 0x1f;
+    }
+  }
+  if (bits)
+    data[data_size++] = (acc << (5 - bits)) & 0x1f;
+
+  length = hrp_size + 1 + data_size + 6;
+  if (length > 90 || *size < length + 1)
+    return -2;
+
+  for (size_t i = 0; i < hrp_size; i++) {
+    if (hrp[i] < 33 || hrp[i] > 126 || (hrp[i] >= 'A' && hrp[i] <= 'Z'))
+      return -1;
+    chk = _polymod_step(chk, hrp[i] >> 5);
+  }
+  chk = _polymod_step(chk, 0);
+  for (size_t i = 0; i < hrp_size; i++)
+    chk = _polymod_step(chk, hrp[i] & 0x1f);
+
+  memcpy(address, hrp, hrp_size);
+  address += hrp_size;
+  *address++ = '1';
+
+  for (size_t i = 0; i < data_size; i++) {
+    chk = _polymod_step(chk, data[i]);
+    *address++ = _charset[data[i]];
+  }
+
+  for (int i = 0; i < 6; i++)
+    chk = _polymod_step(chk, 0);
+  chk ^= version == 0 ? BECH32_CONST : BECH32M_CONST;
+
+  for (int i = 0; i < 6; i++)
+    *address++ = _charset[(chk >> ((5 - i) * 5)) & 0x1f];
+  *address = '\0';
+
+  *size = length + 1;
+  return 0;
+}
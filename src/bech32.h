@@ -0,0 +1,20 @@
+#ifndef __bech32_h
+#define __bech32_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** longest segwit address including terminating zero, bip173 limits it to 90 chars */
+#define BECH32_ADDRESS_MAX_SIZE 91
+
+/**
+ * Encode a segwit address of witness version and program, version 0
+ * uses bech32 (bip173) and later versions bech32m (bip350). On input
+ * size is the size of address, on success it is set to the length of
+ * the address including the terminating zero.
+ */
+int bech32_segwit_address_encode(const char *hrp, uint8_t version,
+                                 const uint8_t *program, size_t program_size,
+                                 char *address, size_t *size);
+
+#endif
@@ -1,4 +1,6 @@
 #include <string.h>
+#include <pthread.h>
+#include <gmp.h>
 #include <nettle/hmac.h>
 #include <nettle/sha2.h>
 #include <nettle/ripemd160.h>
@@ -6,10 +8,60 @@
 #include "utils.h"
 #include "../external/libbase58/libbase58.h"
 #include "../external/secp256k1/include/secp256k1.h"
+#include "../external/secp256k1/include/secp256k1_extrakeys.h"
 
 #include "bip32.h"
+#include "stats.h"
 #include "secp256k1.h"
 
+static pthread_once_t _secp256k1_once = PTHREAD_ONCE_INIT;
+static pthread_key_t _secp256k1_key;
+
+static void
+_secp256k1_context_free(void *data)
+{
+  secp256k1_context_destroy(data);
+}
+
+static void
+_secp256k1_init_once(void)
+{
+  pthread_key_create(&_secp256k1_key, _secp256k1_context_free);
+}
+
+/**
+ * Get the secp256k1 context of the calling thread, it is created and
+ * randomized on first use and reused for all following operations.
+ */
+static secp256k1_context *
+_bip32_secp256k1_context(void)
+{
+  secp256k1_context *secp256k1;
+  uint8_t seed[32];
+
+  pthread_once(&_secp256k1_once, _secp256k1_init_once);
+
+  secp256k1 = pthread_getspecific(_secp256k1_key);
+  if (secp256k1 != NULL) {
+    STATS_INC(STATS_CACHE_HITS);
+    return secp256k1;
+  }
+
+  secp256k1 = secp256k1_context_create(SECP256K1_CONTEXT_NONE);
+  if (secp256k1 == NULL)
+    return NULL;
+
+  if (utils_fill_random(seed, sizeof(seed)) != 0
+      || secp256k1_context_randomize(secp256k1, seed) != 1)
+  {
+    secp256k1_context_destroy(secp256k1);
+    return NULL;
+  }
+
+  pthread_setspecific(_secp256k1_key, secp256k1);
+  return secp256k1;
+}
+
 static int
 _bip32_key_init(bip32_key_t *ctx, uint8_t *secret, uint8_t *chain,
                 uint8_t depth, uint32_t index,
@@ -30,16 +82,13 @@ _bip32_key_init(bip32_key_t *ctx, uint8_t *secret, uint8_t *chain,
 int
 bip32_key_secp256k1_serialize_public_key(const bip32_key_t *ctx, bool compressed, uint8_t *result)
 {
-  struct secp256k1_context *secp256k1;
   size_t pubkey_size = compressed ? 33 : 65;
 
   if (ctx->public == false)
     return -1;
 
-  secp256k1 = secp256k1_context_create(SECP256K1_CONTEXT_NONE);
-  secp256k1_context_randomize(secp256k1, 0);
-  secp256k1_ec_pubkey_serialize(secp256k1, result, &pubkey_size, &ctx->key.public, compressed ? SECP256K1_EC_COMPRESSED : SECP256K1_EC_UNCOMPRESSED);
-  secp256k1_context_destroy(secp256k1);
+  // serialization does not touch secret data, no context setup needed
+  secp256k1_ec_pubkey_serialize(secp256k1_context_static, result, &pubkey_size, (const secp256k1_pubkey *)ctx->key.public, compressed ? SECP256K1_EC_COMPRESSED : SECP256K1_EC_UNCOMPRESSED);
 
   return 0;
 }
@@ -58,10 +107,13 @@ bip32_key_init_from_entropy(bip32_key_t *ctx, uint8_t *entropy, size_t size)
     char *key = "Bitcoin seed";
     struct hmac_sha512_ctx hmac_sha512;
 
+    STATS_STAGE(STATS_STAGE_MASTERKEY);
+
     if (size != 64)
         return -1;
 
     uint8_t mac[64];
+    STATS_INC(STATS_HMAC_SHA512);
     hmac_sha512_set_key(&hmac_sha512, strlen(key), (uint8_t *)key);
     hmac_sha512_update(&hmac_sha512, size, entropy);
     hmac_sha512_digest(&hmac_sha512, 64, mac);
@@ -74,27 +126,39 @@ bip32_key_init_from_entropy(bip32_key_t *ctx, uint8_t *entropy, size_t size)
     return _bip32_key_init(ctx, privkey, chain, 0, index, fingerprint, false);
 }
 
+int
+bip32_key_init_from_chain_and_key(bip32_key_t *ctx, const uint8_t *chain, const uint8_t *secret)
+{
+  uint8_t fingerprint[] = { 0, 0, 0, 0 };
+
+  // verifying a secret key needs no context setup
+  if (secp256k1_ec_seckey_verify(secp256k1_context_static, secret) != 1)
+    return -1;
+
+  return _bip32_key_init(ctx, (uint8_t *)secret, (uint8_t *)chain, 0, 0, fingerprint, false);
+}
+
 int
 bip32_key_init_public_from_private_key(bip32_key_t *ctx, const bip32_key_t *private)
 {
-  int res;
-  struct secp256k1_context *secp256k1;
-  struct secp256k1_pubkey pubkey;
+  secp256k1_context *secp256k1;
+  secp256k1_pubkey pubkey;
+
+  STATS_STAGE(STATS_STAGE_PUBKEY);
 
   memcpy(ctx, private, sizeof(bip32_key_t));
   ctx->public = true;
   memset(ctx->key.public, 0, sizeof(ctx->key.public));
 
-  secp256k1 = secp256k1_context_create(SECP256K1_CONTEXT_NONE);
-  if (secp256k1_context_randomize(secp256k1, 0) != 1)
+  secp256k1 = _bip32_secp256k1_context();
+  if (secp256k1 == NULL)
     return -1;
 
+  STATS_INC(STATS_EC_MULTIPLICATIONS);
   if (secp256k1_ec_pubkey_create(secp256k1, &pubkey, private->key.private) != 1)
     return -2;
 
   memcpy(ctx->key.public, pubkey.data, sizeof(pubkey.data));
-
-  secp256k1_context_destroy(secp256k1);
   return 0;
 }
 
@@ -107,11 +171,14 @@ bip32_key_derive_child_key(const bip32_key_t *parent, uint32_t index, bip32_key_
   uint8_t zeros[10] = {0};
   uint8_t tmp[1024];
 
+  STATS_STAGE(STATS_STAGE_DERIVE);
+
   memset(child, 0, sizeof(bip32_key_t));
 
   if (parent->public)
     return -1;
 
+  STATS_INC(STATS_HMAC_SHA512);
   hmac_sha512_set_key(&hmac_sha512, sizeof(parent->chain), parent->chain);
 
   if (index >= TWO_TO_POWER_OF_31)
@@ -184,6 +251,146 @@ bip32_key_derive_child_key(const bip32_key_t *parent, uint32_t index, bip32_key_
   return 0;
 }
 
+int
+bip32_key_derive_child_range(const bip32_key_t *parent, uint32_t first, size_t count,
+                             bip32_key_t *children)
+{
+  struct hmac_sha512_ctx key_hmac, hmac_sha512;
+  secp256k1_context *secp256k1;
+  bip32_key_t parent_public_key;
+  bip32_key_identifier_t ident;
+  uint8_t data[33 + 4], mac[64];
+  int res = 0;
+
+  STATS_STAGE(STATS_STAGE_DERIVE);
+
+  if (parent->public || first >= TWO_TO_POWER_OF_31 || count > TWO_TO_POWER_OF_31 - first)
+    return -1;
+
+  secp256k1 = _bip32_secp256k1_context();
+  if (secp256k1 == NULL)
+    return -1;
+
+  // public key and fingerprint of the parent are shared by all children
+  if (bip32_key_init_public_from_private_key(&parent_public_key, parent) != 0
+      || bip32_key_secp256k1_serialize_public_key(&parent_public_key, true, data) != 0
+      || bip32_key_identifier_init_from_key(ident, &parent_public_key) != 0)
+    return -2;
+
+  hmac_sha512_set_key(&key_hmac, sizeof(parent->chain), parent->chain);
+
+  for (size_t i = 0; i < count; i++) {
+    bip32_key_t *child = &children[i];
+    uint32_t index = first + i;
+
+    STATS_INC(STATS_HMAC_SHA512);
+    memcpy(&hmac_sha512, &key_hmac, sizeof(hmac_sha512));
+    utils_out_u32_be(data + 33, index);
+    hmac_sha512_update(&hmac_sha512, sizeof(data), data);
+    hmac_sha512_digest(&hmac_sha512, sizeof(mac), mac);
+
+    memset(child, 0, sizeof(bip32_key_t));
+    memcpy(child->key.private, parent->key.private, 32);
+    if (secp256k1_ec_seckey_tweak_add(secp256k1, child->key.private, mac) != 1) {
+      res = -3;
+      break;
+    }
+
+    memcpy(child->chain, mac + 32, 32);
+    memcpy(child->parent_fingerprint, ident, 4);
+    child->public = false;
+    child->depth = parent->depth + 1;
+    child->index = index;
+  }
+
+  memset(mac, 0, sizeof(mac));
+  memset(&key_hmac, 0, sizeof(key_hmac));
+  memset(&hmac_sha512, 0, sizeof(hmac_sha512));
+  return res;
+}
+
+int
+bip32_key_derive_hardened_private_key(const bip32_key_t *parent, const struct hmac_sha512_ctx *hmac,
+                                      uint32_t index, uint8_t *private_key)
+{
+  struct hmac_sha512_ctx hmac_sha512;
+  secp256k1_context *secp256k1;
+  uint8_t data[1 + 32 + 4], mac[64];
+  int res = 0;
+
+  STATS_STAGE(STATS_STAGE_DERIVE);
+
+  if (parent->public || index >= TWO_TO_POWER_OF_31)
+    return -1;
+
+  secp256k1 = _bip32_secp256k1_context();
+  if (secp256k1 == NULL)
+    return -1;
+
+  data[0] = 0x00;
+  memcpy(data + 1, parent->key.private, 32);
+  utils_out_u32_be(data + 33, TWO_TO_POWER_OF_31 + index);
+
+  STATS_INC(STATS_HMAC_SHA512);
+  memcpy(&hmac_sha512, hmac, sizeof(hmac_sha512));
+  hmac_sha512_update(&hmac_sha512, sizeof(data), data);
+  hmac_sha512_digest(&hmac_sha512, sizeof(mac), mac);
+
+  memcpy(private_key, parent->key.private, 32);
+  if (secp256k1_ec_seckey_tweak_add(secp256k1, private_key, mac) != 1)
+    res = -2;
+
+  utils_wipe(data, sizeof(data));
+  utils_wipe(mac, sizeof(mac));
+  utils_wipe(&hmac_sha512, sizeof(hmac_sha512));
+  return res;
+}
+
+int
+bip32_key_p2tr_output_key(const bip32_key_t *ctx, uint8_t *output_key)
+{
+  static const char tag[] = "TapTweak";
+  secp256k1_context *secp256k1;
+  secp256k1_xonly_pubkey internal, output;
+  secp256k1_pubkey tweaked;
+  struct sha256_ctx sha256;
+  uint8_t tag_hash[SHA256_DIGEST_SIZE], internal_key[32], tweak[SHA256_DIGEST_SIZE];
+  bip32_key_t public_key;
+  const bip32_key_t *key = ctx;
+
+  if (ctx->public == false) {
+    if (bip32_key_init_public_from_private_key(&public_key, ctx) != 0)
+      return -1;
+    key = &public_key;
+  }
+
+  secp256k1 = _bip32_secp256k1_context();
+  if (secp256k1 == NULL)
+    return -1;
+
+  if (secp256k1_xonly_pubkey_from_pubkey(secp256k1, &internal, NULL,
+                                         (const secp256k1_pubkey *)key->key.public) != 1
+      || secp256k1_xonly_pubkey_serialize(secp256k1, internal_key, &internal) != 1)
+    return -2;
+
+  // bip341 tagged hash, sha256(sha256(tag) || sha256(tag) || internal key)
+  sha256_init(&sha256);
+  sha256_update(&sha256, sizeof(tag) - 1, (const uint8_t *)tag);
+  sha256_digest(&sha256, sizeof(tag_hash), tag_hash);
+  sha256_update(&sha256, sizeof(tag_hash), tag_hash);
+  sha256_update(&sha256, sizeof(tag_hash), tag_hash);
+  sha256_update(&sha256, sizeof(internal_key), internal_key);
+  sha256_digest(&sha256, sizeof(tweak), tweak);
+
+  // bip86 commits to no script path, the tweak is of the internal key alone
+  if (secp256k1_xonly_pubkey_tweak_add(secp256k1, &tweaked, &internal, tweak) != 1
+      || secp256k1_xonly_pubkey_from_pubkey(secp256k1, &output, NULL, &tweaked) != 1
+      || secp256k1_xonly_pubkey_serialize(secp256k1, output_key, &output) != 1)
+    return -3;
+
+  return 0;
+}
+
 int
 bip32_key_derive_child_by_path(const bip32_key_t *ctx, const char *path, bip32_key_t *child)
 {
@@ -191,12 +398,15 @@ bip32_key_derive_child_by_path(const bip32_key_t *ctx, const char *path, bip32_k
   bool hardened;
   uint32_t index;
   char *token,  buffer[512];
-  snprintf(buffer, sizeof(buffer), path);
+  snprintf(buffer, sizeof(buffer), "%s", path);
 
   // FIXME: for now only private key derive
   if (buffer[0] != 'm')
     return -1;
 
+  // path "m" refers to the key itself
+  memcpy(child, ctx, sizeof(bip32_key_t));
+
   token = strtok(buffer + 1, "/");
   current = ctx;
   while(token)
@@ -227,6 +437,9 @@ _base58_checksum_encode(uint8_t *data, size_t size,
 {
     uint8_t checksum[4];
 
+    STATS_STAGE(STATS_STAGE_BASE58);
+    STATS_INC(STATS_BASE58_ENCODE);
+
     if (utils_sha256_checksum(data, size, checksum) != 0)
       return -1;
 
@@ -354,14 +567,8 @@ bip32_key_deserialize(bip32_key_t *key, const char *encoded_key)
   }
   else
   {
-    int res;
-    struct secp256k1_context *secp256k1;
-    struct secp256k1_pubkey pubkey;
-    secp256k1 = secp256k1_context_create(SECP256K1_CONTEXT_NONE);
-    secp256k1_context_randomize(secp256k1, 0);
-    if (secp256k1_ec_pubkey_parse(secp256k1, key->key.public, pbuf, 33) != 1)
+    if (secp256k1_ec_pubkey_parse(secp256k1_context_static, (secp256k1_pubkey *)key->key.public, pbuf, 33) != 1)
       return -3;
-    secp256k1_context_destroy(secp256k1);
   }
 
   return 0;
@@ -422,10 +629,19 @@ bip32_key_identifier_fingerprint(const bip32_key_identifier_t ident, uint8_t *fi
 
 int
 bip32_key_p2pkh_address_from_key(const bip32_key_t *ctx, uint8_t *address, size_t *size)
+{
+  return bip32_key_p2pkh_address_from_key_version(ctx, 0x00, address, size);
+}
+
+int
+bip32_key_p2pkh_address_from_key_version(const bip32_key_t *ctx, uint8_t version,
+                                         uint8_t *address, size_t *size)
 {
   uint8_t buf[256] = {0};
   bip32_key_t *public_key, tmp;
 
+  STATS_STAGE(STATS_STAGE_ADDRESS);
+
   public_key = ctx;
 
   // derive public key if private
@@ -445,9 +661,10 @@ bip32_key_p2pkh_address_from_key(const bip32_key_t *ctx, uint8_t *address, size_
     return -3;
 
   // calculate checksum of extended key version:<pubkey>
-  buf[0] = 0x00;
+  buf[0] = version;
   if (utils_sha256_checksum(buf, 1 + RIPEMD160_DIGEST_SIZE, buf + 1 + RIPEMD160_DIGEST_SIZE) != 0)
     return -4;
 
+  STATS_INC(STATS_BASE58_ENCODE);
   return b58enc((char*)address, size, buf, 1 + RIPEMD160_DIGEST_SIZE + 4) ? 0 : -5;
 }
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <inttypes.h>
+#include <nettle/hmac.h>
 #include <nettle/ripemd160.h>
 
 typedef struct bip32_key_t {
@@ -22,9 +23,29 @@ typedef struct bip32_key_t {
 
 int bip32_key_init_private(bip32_key_t *ctx);
 int bip32_key_init_from_entropy(bip32_key_t *bip32_key_ctx, uint8_t *entropy, size_t size);
+/** master private key of a chain code and secret, fails if secret is not a valid key */
+int bip32_key_init_from_chain_and_key(bip32_key_t *ctx, const uint8_t *chain, const uint8_t *secret);
 int bip32_key_init_public_from_private_key(bip32_key_t *ctx, const bip32_key_t *private);
 int bip32_key_p2pkh_address_from_key(const bip32_key_t *ctx, uint8_t *address, size_t *size);
+int bip32_key_p2pkh_address_from_key_version(const bip32_key_t *ctx, uint8_t version,
+                                             uint8_t *address, size_t *size);
 int bip32_key_derive_child_key(const bip32_key_t *parent, uint32_t index, bip32_key_t *child);
+/**
+ * Derive the non hardened children first to first + count - 1 of a
+ * private parent into children, the parent public key, fingerprint and
+ * keyed hmac are computed once for all of them.
+ */
+int bip32_key_derive_child_range(const bip32_key_t *parent, uint32_t first, size_t count,
+                                 bip32_key_t *children);
+/**
+ * Private key of the hardened child index' of a private parent, hmac is
+ * keyed with the parent chain code by the caller and copied per call.
+ * Neither the child chain code nor the parent fingerprint is computed.
+ */
+int bip32_key_derive_hardened_private_key(const bip32_key_t *parent, const struct hmac_sha512_ctx *hmac,
+                                          uint32_t index, uint8_t *private_key);
+/** bip86 taproot output key, the x-only internal key tweaked without script path */
+int bip32_key_p2tr_output_key(const bip32_key_t *ctx, uint8_t *output_key);
 int bip32_key_derive_child_by_path(const bip32_key_t *ctx, const char *path, bip32_key_t *child);
 int bip32_key_secp256k1_serialize_public_key(const bip32_key_t *ctx, bool compressed, uint8_t *result);
 int bip32_key_serialize(bip32_key_t *ctx, bool encoded,
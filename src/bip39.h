@@ -7,6 +7,9 @@
 #include <nettle/sha2.h>
 #include <nettle/pbkdf2.h>
 
+/** words of a mnemonic of 256 bits of entropy */
+#define BIP39_MAX_WORDS 24
+
 typedef struct bip39_t {
     struct sha256_ctx sha256;
 } bip39_t;
@@ -16,6 +19,12 @@ int bip39_init(bip39_t *ctx);
 
 int bip39_to_mnemonics(bip39_t *ctx, uint8_t *seed, size_t bits,
                        char ***mnemonics, size_t *count);
+/**
+ * Write the words of the mnemonic of entropy to words of at least
+ * BIP39_MAX_WORDS entries, the words point into the word list and nothing
+ * is allocated.
+ */
+int bip39_to_words(const uint8_t *entropy, size_t bits, const char **words, size_t *count);
 
 int bip39_to_seed(bip39_t *ctx, const uint8_t *menomics, size_t mnemonice_size,
                   int iterations,const uint8_t *passphrase,
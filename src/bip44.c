@@ -1,38 +1,349 @@
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/types.h>
 
 #include "bip44.h"
+#include "bip44_registry.h"
+#include "utils.h"
 
-bip44_coin_t *
-bip44_coin_by_symbol(const char *symbol) {
-  char *psym, *pbuf, buf[64]={0};
-  pbuf = buf;
-  psym = (char*)symbol;
+#include "../external/libbase58/libbase58.h"
 
-  while (*psym != '\0') {
-    *pbuf = toupper(*psym);
-    psym++;
-    pbuf++;
+typedef struct _bip44_discover_t {
+  const bip32_key_t *coinkey;
+  const bip44_used_t *used;
+  uint32_t gap_limit;
+  /** accounts scanned at once, next index of the external and internal chain of each */
+  uint32_t first;
+  uint32_t *chains;
+  size_t count;
+  _Atomic size_t next;
+  atomic_int failed;
+} _bip44_discover_t;
+
+const bip44_coin_t *
+bip44_coin_by_symbol(const char *symbol)
+{
+  uint8_t buf[BIP44_REGISTRY_SYMBOL_MAX];
+  size_t size = 0, slot;
+  uint16_t index;
+
+  for (; symbol[size] != '\0'; size++) {
+    if (size == sizeof(buf))
+      return NULL;
+    buf[size] = toupper((unsigned char)symbol[size]);
   }
 
-  if (strlen(buf) == 0)
+  if (size == 0)
+    return NULL;
+
+  slot = bip44_coin_hash(buf, size, 0) % BIP44_REGISTRY_SYMBOL_BUCKETS;
+  slot = bip44_coin_hash(buf, size, bip44_registry_seeds_by_symbol[slot]) % BIP44_REGISTRY_SYMBOL_SLOTS;
+  index = bip44_registry_by_symbol[slot];
+  if (index == BIP44_REGISTRY_EMPTY)
+    return NULL;
+
+  // the slot of a symbol not in the registry holds some other coin
+  if (strlen(bip44_registry[index].symbol) != size
+      || strncasecmp(bip44_registry[index].symbol, (const char *)buf, size) != 0)
     return NULL;
 
-  for (size_t i=0; i < sizeof(bip44_coins) / sizeof(bip44_coin_t); i++) {
-    if (strcmp(bip44_coins[i].symbol, buf) == 0)
-      return &bip44_coins[i];
+  return &bip44_registry[index];
+}
+
+const bip44_coin_t *
+bip44_coin_by_type(uint32_t type)
+{
+  uint8_t buf[4];
+  size_t slot;
+  uint16_t index;
+
+  utils_out_u32_be(buf, type);
+
+  slot = bip44_coin_hash(buf, sizeof(buf), 0) % BIP44_REGISTRY_TYPE_BUCKETS;
+  slot = bip44_coin_hash(buf, sizeof(buf), bip44_registry_seeds_by_type[slot]) % BIP44_REGISTRY_TYPE_SLOTS;
+  index = bip44_registry_by_type[slot];
+  if (index == BIP44_REGISTRY_EMPTY || bip44_registry[index].type != type)
+    return NULL;
+
+  return &bip44_registry[index];
+}
+
+int
+bip44_p2pkh_address_from_key(const bip32_key_t *key, const bip44_coin_t *coin, uint8_t *address, size_t *size)
+{
+  if (!bip44_coin_has_addresses(coin))
+    return -1;
+
+  return bip32_key_p2pkh_address_from_key_version(key, coin->p2pkh, address, size);
+}
+
+#define BIP44_PURPOSE 44
+#define BIP44_HARDENED 0x80000000
+
+int
+bip44_create_purpose(const bip32_key_t *masterkey, bip32_key_t *purposekey)
+{
+  return bip32_key_derive_child_key(masterkey, BIP44_HARDENED + BIP44_PURPOSE, purposekey) != 0 ? -1 : 0;
+}
+
+int
+bip44_create_coin(const bip32_key_t *purposekey, const bip44_coin_t *coin, bip32_key_t *coinkey)
+{
+  if (coin->type >= BIP44_HARDENED)
+    return -1;
+
+  return bip32_key_derive_child_key(purposekey, BIP44_HARDENED + coin->type, coinkey) != 0 ? -1 : 0;
+}
+
+int
+bip44_create_account_from_coin(const bip32_key_t *coinkey, uint32_t account, bip32_key_t *accountkey)
+{
+  if (account >= BIP44_HARDENED)
+    return -1;
+
+  return bip32_key_derive_child_key(coinkey, BIP44_HARDENED + account, accountkey) != 0 ? -1 : 0;
+}
+
+int
+bip44_create_account(const bip32_key_t *masterkey, const bip44_coin_t *coin, uint32_t account, bip32_key_t *accountkey)
+{
+  bip32_key_t purpose, coinkey;
+  int res = -1;
+
+  if (bip44_create_purpose(masterkey, &purpose) == 0
+      && bip44_create_coin(&purpose, coin, &coinkey) == 0
+      && bip44_create_account_from_coin(&coinkey, account, accountkey) == 0)
+    res = 0;
+
+  memset(&purpose, 0, sizeof(purpose));
+  memset(&coinkey, 0, sizeof(coinkey));
+  return res;
+}
+
+static int
+_bip44_hash160_cmp(const void *a, const void *b)
+{
+  return memcmp(a, b, RIPEMD160_DIGEST_SIZE);
+}
+
+int
+bip44_used_read(bip44_used_t *ctx, FILE *in, size_t *line_number)
+{
+  char *line = NULL;
+  size_t line_size = 0, capacity = 0;
+  ssize_t length;
+  int res = -1;
+
+  ctx->hash160 = NULL;
+  ctx->count = 0;
+  *line_number = 0;
+
+  while ((length = getline(&line, &line_size, in)) != -1) {
+    uint8_t address[1 + RIPEMD160_DIGEST_SIZE + 4], checksum[4], *hash160;
+    size_t size = sizeof(address);
+
+    (*line_number)++;
+    while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r' || line[length - 1] == ' '))
+      line[--length] = '\0';
+    if (length == 0)
+      continue;
+
+    if (ctx->count == capacity) {
+      uint8_t *grown;
+      capacity = capacity ? capacity * 2 : 1024;
+      grown = realloc(ctx->hash160, capacity * RIPEMD160_DIGEST_SIZE);
+      if (grown == NULL)
+        goto out;
+      ctx->hash160 = grown;
+    }
+    hash160 = ctx->hash160 + ctx->count * RIPEMD160_DIGEST_SIZE;
+
+    if (length == 2 * RIPEMD160_DIGEST_SIZE
+        && strspn(line, "0123456789abcdefABCDEF") == (size_t)length)
+    {
+      for (int i = 0; i < RIPEMD160_DIGEST_SIZE; i++)
+        sscanf(line + 2 * i, "%2hhx", &hash160[i]);
+    }
+    else if (b58tobin(address, &size, line, length) && size == sizeof(address)
+             && utils_sha256_checksum(address, 1 + RIPEMD160_DIGEST_SIZE, checksum) == 0
+             && memcmp(checksum, address + 1 + RIPEMD160_DIGEST_SIZE, sizeof(checksum)) == 0)
+    {
+      memcpy(hash160, address + 1, RIPEMD160_DIGEST_SIZE);
+    }
+    else {
+      res = -2;
+      goto out;
+    }
+
+    ctx->count++;
+  }
+
+  qsort(ctx->hash160, ctx->count, RIPEMD160_DIGEST_SIZE, _bip44_hash160_cmp);
+  res = 0;
+
+ out:
+  free(line);
+  if (res != 0)
+    bip44_used_free(ctx);
+  return res;
+}
+
+bool
+bip44_used_contains(const bip44_used_t *ctx, const uint8_t *hash160)
+{
+  return bsearch(hash160, ctx->hash160, ctx->count, RIPEMD160_DIGEST_SIZE, _bip44_hash160_cmp) != NULL;
+}
+
+void
+bip44_used_free(bip44_used_t *ctx)
+{
+  free(ctx->hash160);
+  ctx->hash160 = NULL;
+  ctx->count = 0;
+}
+
+int
+bip44_discover_chain(const bip32_key_t *coinkey, const bip44_used_t *used, uint32_t account,
+                     uint32_t chain, uint32_t gap_limit, uint32_t *next)
+{
+  bip32_key_t accountkey, chain_key, address_key, address_public;
+  uint8_t pubkey[33], hash160[RIPEMD160_DIGEST_SIZE];
+  uint32_t gap = 0;
+  int res = -1;
+
+  if (chain > 1)
+    return -1;
+
+  if (bip44_create_account_from_coin(coinkey, account, &accountkey) != 0
+      || bip32_key_derive_child_key(&accountkey, chain, &chain_key) != 0)
+    goto out;
+
+  *next = 0;
+  for (uint32_t index = 0; gap < gap_limit && index < BIP44_HARDENED; index++) {
+    if (bip32_key_derive_child_key(&chain_key, index, &address_key) != 0
+        || bip32_key_init_public_from_private_key(&address_public, &address_key) != 0
+        || bip32_key_secp256k1_serialize_public_key(&address_public, true, pubkey) != 0
+        || utils_hash160(pubkey, sizeof(pubkey), hash160) != 0)
+      goto out;
+
+    if (bip44_used_contains(used, hash160)) {
+      *next = index + 1;
+      gap = 0;
+    }
+    else
+      gap++;
+  }
+
+  res = 0;
+
+ out:
+  utils_wipe(&accountkey, sizeof(accountkey));
+  utils_wipe(&chain_key, sizeof(chain_key));
+  utils_wipe(&address_key, sizeof(address_key));
+  return res;
+}
+
+static void *
+_bip44_discover_worker(void *arg)
+{
+  _bip44_discover_t *job = arg;
+
+  while (atomic_load_explicit(&job->failed, memory_order_relaxed) == 0) {
+    size_t index = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+    if (index >= job->count)
+      break;
+
+    if (job->first + index / 2 >= BIP44_HARDENED)
+      continue;
+
+    if (bip44_discover_chain(job->coinkey, job->used, job->first + index / 2, index % 2,
+                             job->gap_limit, &job->chains[index]) != 0)
+    {
+      atomic_store(&job->failed, 1);
+      break;
+    }
   }
 
   return NULL;
 }
 
 int
-bip44_create_account(const bip32_key_t *masterkey, const bip44_coin_t *coin, uint32_t account, bip32_key_t *accountkey)
+bip44_discover(const bip32_key_t *coinkey, const bip44_used_t *used, uint32_t gap_limit, size_t threads,
+               int (*found)(const bip44_discovered_t *account, void *arg), void *arg)
 {
-  char path[1024];
-  snprintf(path, sizeof(path), "m/44'/%d'/%d'", coin->type, account);
-  if (bip32_key_derive_child_by_path(masterkey, path, accountkey) != 0)
+  pthread_t workers[BIP44_MAX_THREADS];
+  size_t window;
+  bool empty = false;
+  int res = 0;
+  _bip44_discover_t job = {
+    .coinkey = coinkey,
+    .used = used,
+    .gap_limit = gap_limit,
+    .first = 0,
+    .failed = 0,
+  };
+
+  if (gap_limit == 0)
     return -1;
 
-  return 0;
+  if (threads < 1)
+    threads = 1;
+  if (threads > BIP44_MAX_THREADS)
+    threads = BIP44_MAX_THREADS;
+
+  // accounts past the first empty one are scanned in vain, keep the window small
+  window = threads / 2 > 0 ? threads / 2 : 1;
+  job.count = 2 * window;
+  job.chains = calloc(job.count, sizeof(uint32_t));
+  if (job.chains == NULL)
+    return -2;
+
+  while (!empty && res == 0 && job.first < BIP44_HARDENED) {
+    size_t started = 0;
+
+    job.next = 0;
+    for (; started < threads && started < job.count; started++) {
+      if (pthread_create(&workers[started], NULL, _bip44_discover_worker, &job) != 0)
+        break;
+    }
+
+    // run on the calling thread if no worker could be started
+    if (started == 0)
+      _bip44_discover_worker(&job);
+
+    for (size_t i = 0; i < started; i++)
+      pthread_join(workers[i], NULL);
+
+    if (job.failed) {
+      res = -3;
+      break;
+    }
+
+    for (size_t a = 0; a < window && job.first + a < BIP44_HARDENED; a++) {
+      bip44_discovered_t account = {
+        .account = job.first + (uint32_t)a,
+        .external_next = job.chains[2 * a],
+        .internal_next = job.chains[2 * a + 1],
+      };
+
+      if (account.external_next == 0) {
+        empty = true;
+        break;
+      }
+
+      if (found(&account, arg) != 0) {
+        res = -4;
+        break;
+      }
+    }
+
+    job.first += window;
+  }
+
+  free(job.chains);
+  return res;
 }
@@ -1,6 +1,56 @@
-#include "bip44_coins.h"
+#include "bip44_coin.h"
 #include "bip32.h"
 
-bip44_coin_t *bip44_coin_by_symbol(const char *symbol);
+/** most worker threads used by discovery and the bip44 commands */
+#define BIP44_MAX_THREADS 256
+
+/** case insensitive lookup of a coin by symbol, NULL if not registered */
+const bip44_coin_t *bip44_coin_by_symbol(const char *symbol);
+/** lookup of a coin by its bip44 coin type, NULL if not registered */
+const bip44_coin_t *bip44_coin_by_type(uint32_t type);
+
+/** p2pkh address of key with the address version of coin */
+int bip44_p2pkh_address_from_key(const bip32_key_t *key, const bip44_coin_t *coin, uint8_t *address, size_t *size);
 
 int bip44_create_account(const bip32_key_t *masterkey, const bip44_coin_t *coin, uint32_t account, bip32_key_t *accountkey);
+
+/** m/44' of masterkey, shared by the accounts of every coin */
+int bip44_create_purpose(const bip32_key_t *masterkey, bip32_key_t *purposekey);
+/** m/44'/coin' from the purpose key */
+int bip44_create_coin(const bip32_key_t *purposekey, const bip44_coin_t *coin, bip32_key_t *coinkey);
+/** m/44'/coin'/account' from the coin key */
+int bip44_create_account_from_coin(const bip32_key_t *coinkey, uint32_t account, bip32_key_t *accountkey);
+
+/** set of used addresses, the sorted hash160 of each */
+typedef struct bip44_used_t {
+  uint8_t *hash160;
+  size_t count;
+} bip44_used_t;
+
+/**
+ * Read used addresses, one base58check address or hex encoded hash160
+ * per line, blank lines are skipped. Returns -2 on an invalid line with
+ * line_number set to it.
+ */
+int bip44_used_read(bip44_used_t *ctx, FILE *in, size_t *line_number);
+bool bip44_used_contains(const bip44_used_t *ctx, const uint8_t *hash160);
+void bip44_used_free(bip44_used_t *ctx);
+
+/** an account found by discovery, next is the index after the last used address of a chain, 0 if none */
+typedef struct bip44_discovered_t {
+  uint32_t account;
+  uint32_t external_next;
+  uint32_t internal_next;
+} bip44_discovered_t;
+
+/** scan chain 0 or 1 of account until gap_limit consecutive unused addresses */
+int bip44_discover_chain(const bip32_key_t *coinkey, const bip44_used_t *used, uint32_t account,
+                         uint32_t chain, uint32_t gap_limit, uint32_t *next);
+/**
+ * BIP44 account discovery below coinkey. The chains of a window of
+ * accounts are scanned at once on up to threads threads, found is called
+ * for each account in order until the first one without used addresses on
+ * its external chain. A non zero return of found ends discovery.
+ */
+int bip44_discover(const bip32_key_t *coinkey, const bip44_used_t *used, uint32_t gap_limit, size_t threads,
+                   int (*found)(const bip44_discovered_t *account, void *arg), void *arg);
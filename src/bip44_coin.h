@@ -0,0 +1,53 @@
+#ifndef __bip44_coin_h
+#define __bip44_coin_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct bip44_coin_t {
+  uint32_t type;
+  const char *symbol;
+  const char *coin;
+  /** base58 version byte of p2pkh and p2sh addresses and of wif keys */
+  uint8_t p2pkh;
+  uint8_t p2sh;
+  uint8_t wif;
+  /** human readable part of segwit addresses, NULL if the coin has none */
+  const char *hrp;
+  /** version of serialized extended public and private keys */
+  uint32_t xpub;
+  uint32_t xprv;
+} bip44_coin_t;
+
+/**
+ * Most registered coins have no known address parameters, they are all
+ * zero and no addresses can be encoded for the coin.
+ */
+static inline bool
+bip44_coin_has_addresses(const bip44_coin_t *coin)
+{
+  return coin->xpub != 0;
+}
+
+/**
+ * Hash of the coin registry lookup tables, seed selects one of a family
+ * of hash functions. Shared by the generator and the lookups.
+ */
+static inline uint32_t
+bip44_coin_hash(const uint8_t *data, size_t size, uint32_t seed)
+{
+  uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+
+  for (size_t i = 0; i < size; i++)
+    h = (h ^ data[i]) * 16777619u;
+
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+#endif
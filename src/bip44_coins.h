@@ -1,23 +1,22 @@
 #ifndef __bip44_coins__
 #define __bip44_coins__
 
-#include <stdint.h>
+#include "bip44_coin.h"
 
-typedef struct bip44_coin_t {
-  uint32_t type;
-  char *symbol;
-  char *coin;
-} bip44_coin_t;
-
-static bip44_coin_t bip44_coins[] = {
-  { 0, "BTC", "Bitcoin" },
-  { 1, "", "Testnet (all coins)" },
-  { 2, "LTC", "Litecoin" },
-  { 3, "DOGE", "Dogecoin" },
+/**
+ * SLIP-0044 registered coin types, input of bip44_registry_gen which
+ * generates the lookup tables used at runtime. Coins without address
+ * parameters leave them zero and have no addresses.
+ */
+static const bip44_coin_t bip44_coins[] = {
+  { 0, "BTC", "Bitcoin", 0x00, 0x05, 0x80, "bc", 0x0488b21e, 0x0488ade4 },
+  { 1, "", "Testnet (all coins)", 0x6f, 0xc4, 0xef, "tb", 0x043587cf, 0x04358394 },
+  { 2, "LTC", "Litecoin", 0x30, 0x32, 0xb0, "ltc", 0x019da462, 0x019d9cfe },
+  { 3, "DOGE", "Dogecoin", 0x1e, 0x16, 0x9e, NULL, 0x02facafd, 0x02fac398 },
   { 4, "RDD", "Reddcoin" },
-  { 5, "DASH", "Dash" },
-  { 6, "PPC", "Peercoin" },
-  { 7, "NMC", "Namecoin" },
+  { 5, "DASH", "Dash", 0x4c, 0x10, 0xcc, NULL, 0x02fe52cc, 0x02fe52f8 },
+  { 6, "PPC", "Peercoin", 0x37, 0x75, 0xb7, "pc", 0x0488b21e, 0x0488ade4 },
+  { 7, "NMC", "Namecoin", 0x34, 0x0d, 0xb4, "nc", 0x0488b21e, 0x0488ade4 },
   { 8, "FTC", "Feathercoin" },
   { 9, "XCP", "Counterparty" },
   { 10, "BLK", "Blackcoin" },
@@ -30,15 +29,15 @@ static bip44_coin_t bip44_coins[] = {
   { 17, "GRS", "Groestlcoin" },
   { 18, "DGC", "Digitalcoin" },
   { 19, "CCN", "Cannacoin" },
-  { 20, "DGB", "DigiByte" },
+  { 20, "DGB", "DigiByte", 0x1e, 0x3f, 0x80, "dgb", 0x0488b21e, 0x0488ade4 },
   { 21, "", "Open Assets" },
-  { 22, "MONA", "Monacoin" },
+  { 22, "MONA", "Monacoin", 0x32, 0x37, 0xb0, "mona", 0x0488b21e, 0x0488ade4 },
   { 23, "CLAM", "Clams" },
   { 24, "XPM", "Primecoin" },
   { 25, "NEOS", "Neoscoin" },
   { 26, "JBS", "Jumbucks" },
   { 27, "ZRC", "ziftrCOIN" },
-  { 28, "VTC", "Vertcoin" },
+  { 28, "VTC", "Vertcoin", 0x47, 0x05, 0x80, "vtc", 0x0488b21e, 0x0488ade4 },
   { 29, "NXT", "NXT" },
   { 30, "BURST", "Burst" },
   { 31, "MUE", "MonetaryUnit" },
@@ -155,7 +154,7 @@ static bip44_coin_t bip44_coins[] = {
   { 142, "BSQ", "bisq Token" },
   { 143, "RIC", "Riecoin" },
   { 144, "XRP", "XRP" },
-  { 145, "BCH", "Bitcoin Cash" },
+  { 145, "BCH", "Bitcoin Cash", 0x00, 0x05, 0x80, NULL, 0x0488b21e, 0x0488ade4 },
   { 146, "NEBL", "Neblio" },
   { 147, "ZCL", "ZClassic" },
   { 148, "XLM", "Stellar Lumens" },
@@ -166,7 +165,7 @@ static bip44_coin_t bip44_coins[] = {
   { 153, "BTM", "Bytom" },
   { 154, "BIO", "Biocoin" },
   { 155, "XWCC", "Whitecoin Classic" },
-  { 156, "BTG", "Bitcoin Gold" },
+  { 156, "BTG", "Bitcoin Gold", 0x26, 0x17, 0x80, "btg", 0x0488b21e, 0x0488ade4 },
   { 157, "BTC2X", "Bitcoin 2x" },
   { 158, "SSN", "SuperSkynet" },
   { 159, "TOA", "TOACoin" },
@@ -1,17 +1,54 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <inttypes.h>
 #include <getopt.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #include "command.h"
+#include "utils.h"
 #include "bip44.h"
+#include "address.h"
+
+#define BIP44_MAX_COINS 1024
+/** addresses derived by a worker at a time */
+#define BIP44_ADDRESS_BLOCK 1024
+
+typedef struct _bip44_accounts_t {
+  const bip32_key_t *purpose;
+  const bip44_coin_t **coins;
+  bip32_key_t *coin_keys;
+  size_t coin_cnt;
+  uint32_t first;
+  size_t account_cnt;
+  /** work items, coins in the first pass and coin accounts in the second */
+  size_t count;
+  _Atomic size_t next;
+  atomic_int failed;
+} _bip44_accounts_t;
+
+typedef struct _bip44_addresses_t {
+  const bip32_key_t *chain_key;
+  const bip44_coin_t *coin;
+  /** address formats written on each line, in order */
+  address_format_t formats[ADDRESS_FORMAT_MAX];
+  size_t format_cnt;
+  /** derivation path of the chain, prefix of each written line */
+  char path[64];
+  uint32_t first;
+  size_t count;
+  _Atomic size_t next;
+  atomic_int failed;
+} _bip44_addresses_t;
 
 static int _bip44_account(uint32_t account_nr, char *coin_symbol)
 {
   bip32_key_t key, account_key;
   uint8_t buf[4096]={0};
   size_t bytes = 0;
-  bip44_coin_t *coin;
+  const bip44_coin_t *coin;
 
   coin = bip44_coin_by_symbol(coin_symbol);
   if (coin == NULL)
@@ -53,6 +90,431 @@ static int _bip44_account(uint32_t account_nr, char *coin_symbol)
   return EXIT_SUCCESS;
 }
 
+/** read a serialized private masterkey line from stdin */
+static int
+_bip44_read_masterkey(const char *command, bip32_key_t *key)
+{
+  char buf[4096];
+  size_t length;
+  int res = -1;
+
+  if (fgets(buf, sizeof(buf), stdin) == NULL) {
+    fprintf(stderr, "%s: failed to read key from stdin\n", command);
+    return -1;
+  }
+
+  length = strlen(buf);
+  if (length > 0 && buf[length - 1] == '\n')
+    buf[length - 1] = '\0';
+
+  if (bip32_key_deserialize(key, buf) != 0)
+    fprintf(stderr, "%s: failed to deserialize key from stdin\n", command);
+  else if (key->public == true)
+    fprintf(stderr, "%s: failed, read private key is a public key\n", command);
+  else
+    res = 0;
+
+  memset(buf, 0, sizeof(buf));
+  return res;
+}
+
+static void *
+_bip44_coins_worker(void *arg)
+{
+  _bip44_accounts_t *job = arg;
+
+  while (atomic_load_explicit(&job->failed, memory_order_relaxed) == 0) {
+    size_t index = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+    if (index >= job->count)
+      break;
+
+    if (bip44_create_coin(job->purpose, job->coins[index], &job->coin_keys[index]) != 0) {
+      atomic_store(&job->failed, 1);
+      break;
+    }
+  }
+
+  return NULL;
+}
+
+static void *
+_bip44_accounts_worker(void *arg)
+{
+  _bip44_accounts_t *job = arg;
+  bip32_key_t account, account_public;
+  uint8_t xpub[128];
+  char line[256];
+
+  while (atomic_load_explicit(&job->failed, memory_order_relaxed) == 0) {
+    size_t index = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+    size_t xpub_size = sizeof(xpub);
+    const bip44_coin_t *coin;
+    uint32_t account_nr;
+
+    if (index >= job->count)
+      break;
+
+    coin = job->coins[index / job->account_cnt];
+    account_nr = job->first + index % job->account_cnt;
+
+    if (bip44_create_account_from_coin(&job->coin_keys[index / job->account_cnt], account_nr,
+                                       &account) != 0
+        || bip32_key_init_public_from_private_key(&account_public, &account) != 0
+        || bip32_key_serialize(&account_public, true, xpub, &xpub_size) != 0
+        || snprintf(line, sizeof(line), "%s %" PRIu32 " %s\n",
+                    coin->symbol, account_nr, xpub) >= (int)sizeof(line))
+    {
+      atomic_store(&job->failed, 1);
+      break;
+    }
+
+    // one account per line, lines from different workers never interleave
+    flockfile(stdout);
+    fputs(line, stdout);
+    funlockfile(stdout);
+  }
+
+  memset(&account, 0, sizeof(account));
+  return NULL;
+}
+
+/** run worker on up to threads threads, workers take their items from the job */
+static void
+_bip44_run(void *(*worker)(void *), void *job, size_t count, size_t threads)
+{
+  pthread_t workers[BIP44_MAX_THREADS];
+  size_t started = 0;
+
+  if (threads > count)
+    threads = count;
+
+  for (; started < threads; started++) {
+    if (pthread_create(&workers[started], NULL, worker, job) != 0)
+      break;
+  }
+
+  // run on the calling thread if no worker could be started
+  if (started == 0)
+    worker(job);
+
+  for (size_t i = 0; i < started; i++)
+    pthread_join(workers[i], NULL);
+}
+
+/**
+ * Derive m/44' once, then the coin type keys and finally the account
+ * keys of every coin in parallel, writing one line with coin symbol,
+ * account number and account xpub per account.
+ */
+static int
+_bip44_accounts(char *coin_list, uint32_t first, uint32_t last, size_t threads)
+{
+  const bip44_coin_t *coins[BIP44_MAX_COINS];
+  bip32_key_t key, purpose;
+  bip32_key_t *coin_keys = NULL;
+  char *symbol, *saveptr = NULL;
+  size_t coin_cnt = 0;
+  int res = EXIT_FAILURE;
+  _bip44_accounts_t job = {
+    .purpose = &purpose,
+    .coins = coins,
+    .first = first,
+    .account_cnt = (size_t)last - first + 1,
+    .failed = 0,
+  };
+
+  for (symbol = strtok_r(coin_list, ",", &saveptr); symbol != NULL;
+       symbol = strtok_r(NULL, ",", &saveptr))
+  {
+    if (coin_cnt == BIP44_MAX_COINS) {
+      fputs("bip44.accounts: too many coins\n", stderr);
+      return EXIT_FAILURE;
+    }
+
+    coins[coin_cnt] = bip44_coin_by_symbol(symbol);
+    if (coins[coin_cnt] == NULL) {
+      fprintf(stderr, "bip44.accounts: symbol '%s' not found in coin table\n", symbol);
+      return EXIT_FAILURE;
+    }
+    coin_cnt++;
+  }
+
+  if (coin_cnt == 0) {
+    fputs("bip44.accounts: no coins specified\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  if (_bip44_read_masterkey("bip44.accounts", &key) != 0)
+    goto out;
+
+  coin_keys = calloc(coin_cnt, sizeof(bip32_key_t));
+  if (coin_keys == NULL)
+    goto out;
+
+  job.coin_keys = coin_keys;
+  job.coin_cnt = coin_cnt;
+
+  if (bip44_create_purpose(&key, &purpose) != 0) {
+    fputs("bip44.accounts: failed to derive purpose key\n", stderr);
+    goto out;
+  }
+
+  job.count = coin_cnt;
+  job.next = 0;
+  _bip44_run(_bip44_coins_worker, &job, job.count, threads);
+
+  if (!job.failed) {
+    job.count = coin_cnt * job.account_cnt;
+    job.next = 0;
+    _bip44_run(_bip44_accounts_worker, &job, job.count, threads);
+  }
+
+  fflush(stdout);
+
+  if (job.failed) {
+    fputs("bip44.accounts: failed to create account keys\n", stderr);
+    goto out;
+  }
+
+  res = EXIT_SUCCESS;
+
+ out:
+  memset(&key, 0, sizeof(key));
+  memset(&purpose, 0, sizeof(purpose));
+  if (coin_keys != NULL) {
+    memset(coin_keys, 0, coin_cnt * sizeof(bip32_key_t));
+    free(coin_keys);
+  }
+  return res;
+}
+
+/** coin and account key of the reported accounts */
+typedef struct _bip44_report_t {
+  const bip44_coin_t *coin;
+  const bip32_key_t *coin_key;
+} _bip44_report_t;
+
+/** write a line with coin symbol, account number, account xpub and next indices of a found account */
+static int
+_bip44_discover_report(const bip44_discovered_t *account, void *arg)
+{
+  const _bip44_report_t *report = arg;
+  bip32_key_t account_key, account_public;
+  uint8_t xpub[128];
+  size_t xpub_size = sizeof(xpub);
+  int res = -1;
+
+  if (bip44_create_account_from_coin(report->coin_key, account->account, &account_key) == 0
+      && bip32_key_init_public_from_private_key(&account_public, &account_key) == 0
+      && bip32_key_serialize(&account_public, true, xpub, &xpub_size) == 0)
+  {
+    fprintf(stdout, "%s %" PRIu32 " %s %" PRIu32 " %" PRIu32 "\n", report->coin->symbol,
+            account->account, xpub, account->external_next, account->internal_next);
+    res = 0;
+  }
+
+  utils_wipe(&account_key, sizeof(account_key));
+  return res;
+}
+
+/**
+ * BIP44 account discovery against the used addresses of filename,
+ * reporting accounts in order until the first one without used addresses
+ * on its external chain.
+ */
+static int
+_bip44_discover(const char *coin_symbol, const char *filename, uint32_t gap_limit, size_t threads)
+{
+  bip32_key_t key, purpose, coin_key;
+  const bip44_coin_t *coin;
+  bip44_used_t used = { 0 };
+  _bip44_report_t report;
+  size_t line_number;
+  FILE *in;
+  int res = EXIT_FAILURE;
+
+  coin = bip44_coin_by_symbol(coin_symbol);
+  if (coin == NULL) {
+    fprintf(stderr, "bip44.discover: symbol '%s' not found in coin table\n", coin_symbol);
+    return EXIT_FAILURE;
+  }
+
+  in = fopen(filename, "r");
+  if (in == NULL) {
+    fprintf(stderr, "bip44.discover: failed to open '%s'\n", filename);
+    return EXIT_FAILURE;
+  }
+
+  res = bip44_used_read(&used, in, &line_number);
+  fclose(in);
+  if (res == -2) {
+    fprintf(stderr, "bip44.discover: invalid address or hash160 on line %ld of '%s'\n",
+            line_number, filename);
+    return EXIT_FAILURE;
+  }
+  else if (res != 0) {
+    fprintf(stderr, "bip44.discover: failed to read '%s'\n", filename);
+    return EXIT_FAILURE;
+  }
+
+  fprintf(stderr, "bip44.discover: read %ld used addresses from '%s'\n", used.count, filename);
+  res = EXIT_FAILURE;
+
+  if (_bip44_read_masterkey("bip44.discover", &key) != 0)
+    goto out;
+
+  if (bip44_create_purpose(&key, &purpose) != 0
+      || bip44_create_coin(&purpose, coin, &coin_key) != 0)
+  {
+    fputs("bip44.discover: failed to derive coin type key\n", stderr);
+    goto out;
+  }
+
+  report.coin = coin;
+  report.coin_key = &coin_key;
+  if (bip44_discover(&coin_key, &used, gap_limit, threads, _bip44_discover_report, &report) != 0) {
+    fputs("bip44.discover: failed to scan accounts\n", stderr);
+    goto out;
+  }
+
+  fflush(stdout);
+  res = EXIT_SUCCESS;
+
+ out:
+  utils_wipe(&key, sizeof(key));
+  utils_wipe(&purpose, sizeof(purpose));
+  utils_wipe(&coin_key, sizeof(coin_key));
+  bip44_used_free(&used);
+  return res;
+}
+
+static void *
+_bip44_addresses_worker(void *arg)
+{
+  _bip44_addresses_t *job = arg;
+  char *addresses, *lines;
+  size_t blocks = (job->count + BIP44_ADDRESS_BLOCK - 1) / BIP44_ADDRESS_BLOCK;
+
+  addresses = malloc(BIP44_ADDRESS_BLOCK * job->format_cnt * ADDRESS_MAX_SIZE);
+  lines = malloc(BIP44_ADDRESS_BLOCK * (sizeof(job->path) + 12 + job->format_cnt * ADDRESS_MAX_SIZE));
+  if (addresses == NULL || lines == NULL) {
+    atomic_store(&job->failed, 1);
+    goto out;
+  }
+
+  while (atomic_load_explicit(&job->failed, memory_order_relaxed) == 0) {
+    size_t block = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+    size_t offset = block * BIP44_ADDRESS_BLOCK, count, length = 0;
+
+    if (block >= blocks)
+      break;
+
+    count = job->count - offset < BIP44_ADDRESS_BLOCK ? job->count - offset : BIP44_ADDRESS_BLOCK;
+    // all formats of a child come from one public key serialization and hash
+    if (address_set_range_from_key(job->chain_key, job->coin, job->formats, job->format_cnt,
+                                   job->first + offset, count, addresses, ADDRESS_MAX_SIZE) != 0)
+    {
+      atomic_store(&job->failed, 1);
+      break;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      length += sprintf(lines + length, "%s/%" PRIu32, job->path, job->first + (uint32_t)(offset + i));
+      for (size_t t = 0; t < job->format_cnt; t++)
+        length += sprintf(lines + length, " %s",
+                          addresses + (i * job->format_cnt + t) * ADDRESS_MAX_SIZE);
+      lines[length++] = '\n';
+    }
+
+    // a block of lines is written at once, blocks of different workers never interleave
+    flockfile(stdout);
+    fwrite(lines, 1, length, stdout);
+    funlockfile(stdout);
+  }
+
+ out:
+  free(addresses);
+  free(lines);
+  return NULL;
+}
+
+/**
+ * Derive the chain key of account once, then all formats of a range of
+ * its children in blocks on worker threads.
+ */
+static int
+_bip44_addresses(const char *coin_symbol, const address_format_t *formats, size_t format_cnt,
+                 uint32_t purpose_nr, uint32_t account_nr, uint32_t chain,
+                 uint32_t first, uint32_t last, size_t threads)
+{
+  bip32_key_t key, purpose, coin_key, account, chain_key;
+  const bip44_coin_t *coin;
+  int res = EXIT_FAILURE;
+  _bip44_addresses_t job = {
+    .chain_key = &chain_key,
+    .format_cnt = format_cnt,
+    .first = first,
+    .count = (size_t)last - first + 1,
+    .next = 0,
+    .failed = 0,
+  };
+
+  coin = bip44_coin_by_symbol(coin_symbol);
+  if (coin == NULL) {
+    fprintf(stderr, "bip44.addresses: symbol '%s' not found in coin table\n", coin_symbol);
+    return EXIT_FAILURE;
+  }
+  job.coin = coin;
+
+  if (!bip44_coin_has_addresses(coin)) {
+    fprintf(stderr, "bip44.addresses: coin '%s' has no known address parameters\n", coin->symbol);
+    return EXIT_FAILURE;
+  }
+
+  for (size_t f = 0; f < format_cnt; f++) {
+    if (formats[f].type != ADDRESS_P2PKH && coin->hrp == NULL) {
+      fprintf(stderr, "bip44.addresses: coin '%s' has no segwit addresses\n", coin->symbol);
+      return EXIT_FAILURE;
+    }
+    job.formats[f] = formats[f];
+  }
+
+  if (_bip44_read_masterkey("bip44.addresses", &key) != 0)
+    return EXIT_FAILURE;
+
+  // m/purpose'/coin'/account'/chain
+  if (bip32_key_derive_child_key(&key, 0x80000000 + purpose_nr, &purpose) != 0
+      || bip44_create_coin(&purpose, coin, &coin_key) != 0
+      || bip44_create_account_from_coin(&coin_key, account_nr, &account) != 0
+      || bip32_key_derive_child_key(&account, chain, &chain_key) != 0)
+  {
+    fputs("bip44.addresses: failed to derive chain key\n", stderr);
+    goto out;
+  }
+
+  snprintf(job.path, sizeof(job.path), "m/%" PRIu32 "'/%" PRIu32 "'/%" PRIu32 "'/%" PRIu32,
+           purpose_nr, coin->type, account_nr, chain);
+
+  _bip44_run(_bip44_addresses_worker, &job,
+             (job.count + BIP44_ADDRESS_BLOCK - 1) / BIP44_ADDRESS_BLOCK, threads);
+  fflush(stdout);
+
+  if (job.failed) {
+    fputs("bip44.addresses: failed to create addresses\n", stderr);
+    goto out;
+  }
+
+  res = EXIT_SUCCESS;
+
+ out:
+  memset(&key, 0, sizeof(key));
+  memset(&purpose, 0, sizeof(purpose));
+  memset(&coin_key, 0, sizeof(coin_key));
+  memset(&account, 0, sizeof(account));
+  memset(&chain_key, 0, sizeof(chain_key));
+  return res;
+}
+
 static void
 _bip44_account_command_usage(void)
 {
@@ -110,12 +572,327 @@ _bip44_account_command(int argc, char **argv)
   return _bip44_account(account_nr, coin_symbol);
 }
 
+static void
+_bip44_accounts_command_usage(void)
+{
+  fputs("usage: btct bip44.accounts <args>\n", stderr);
+  fputs("\n", stderr);
+  fputs("  -c, --coins <symbols>    Comma separated coin symbols, default is 'BTC'.\n", stderr);
+  fputs("  -a, --accounts <range>   Account number or range of account numbers as first-last,\n", stderr);
+  fputs("                           default is account #0.\n", stderr);
+  fputs("  -t, --threads <count>    Number of worker threads, default is one per online cpu.\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Reads a masterkey from stdin and writes a line with coin symbol, account number and\n", stderr);
+  fputs("  account xpub for every account of every coin, lines are written in no particular\n", stderr);
+  fputs("  order.\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Generate accounts #0 to #9 for BTC, LTC and DOGE\n", stderr);
+  fputs("\n", stderr);
+  fputs("      echo 'legal winner thank year wave sausage worth useful legal winner thank yellow' \\\n",stderr);
+  fputs("          | btct bip39.seed --passphrase=TREZOR \\\n", stderr);
+  fputs("          | btct bip32.masterkey\\\n", stderr);
+  fputs("          | btct bip44.accounts --coins=BTC,LTC,DOGE --accounts=0-9\n", stderr);
+  fputs("\n", stderr);
+}
+
+static int
+_bip44_accounts_command(int argc, char **argv)
+{
+  int c;
+  char *coins = "BTC";
+  uint32_t first = 0, last = 0;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  char coin_list[4096];
+
+  while (1)
+    {
+      int option_index = 0;
+      static struct option long_options[] = {
+        {"help",  no_argument, 0, 'h' },
+        {"coins",  required_argument, 0, 'c' },
+        {"accounts",  required_argument, 0, 'a' },
+        {"threads",  required_argument, 0, 't' },
+        {0, 0, 0, 0}
+      };
+
+      c = getopt_long(argc, argv, "hc:a:t:", long_options, &option_index);
+      if (c == -1)
+        break;
+
+      switch (c) {
+      case 'h':
+        _bip44_accounts_command_usage();
+        return EXIT_FAILURE;
+
+      case 'c':
+        coins = optarg;
+        break;
+
+      case 'a':
+        if (utils_parse_range(optarg, &first, &last) != 0 || last >= 0x80000000) {
+          fprintf(stderr, "bip44.accounts: invalid account range '%s'\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 't':
+        threads = atol(optarg);
+        break;
+      }
+    }
+
+  if (threads < 1)
+    threads = 1;
+  if (threads > BIP44_MAX_THREADS)
+    threads = BIP44_MAX_THREADS;
+
+  if (strlen(coins) >= sizeof(coin_list)) {
+    fputs("bip44.accounts: coin list is too long\n", stderr);
+    return EXIT_FAILURE;
+  }
+  strcpy(coin_list, coins);
+
+  return _bip44_accounts(coin_list, first, last, threads);
+}
+
+static void
+_bip44_discover_command_usage(void)
+{
+  fputs("usage: btct bip44.discover <args>\n", stderr);
+  fputs("\n", stderr);
+  fputs("  -c, --coin <symbol>      Specify coin symbol for specific coin type, default is 'BTC'.\n", stderr);
+  fputs("  -u, --used <filename>    File of used addresses, one p2pkh address or hex encoded\n", stderr);
+  fputs("                           hash160 per line.\n", stderr);
+  fputs("  -g, --gap-limit <count>  Unused addresses in a row that end a chain, default is 20.\n", stderr);
+  fputs("  -t, --threads <count>    Number of worker threads, default is one per online cpu.\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Reads a masterkey from stdin and discovers accounts as described by bip44, the\n", stderr);
+  fputs("  external and internal chain of several accounts are scanned at once. Discovery\n", stderr);
+  fputs("  ends at the first account without used addresses on its external chain. For each\n", stderr);
+  fputs("  used account a line with coin symbol, account number, account xpub and the next\n", stderr);
+  fputs("  unused external and internal address index is written.\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Discover BTC accounts of a wallet\n", stderr);
+  fputs("\n", stderr);
+  fputs("      echo 'legal winner thank year wave sausage worth useful legal winner thank yellow' \\\n",stderr);
+  fputs("          | btct bip39.seed --passphrase=TREZOR \\\n", stderr);
+  fputs("          | btct bip32.masterkey\\\n", stderr);
+  fputs("          | btct bip44.discover --used=addresses.txt\n", stderr);
+  fputs("\n", stderr);
+}
+
+static int
+_bip44_discover_command(int argc, char **argv)
+{
+  int c;
+  char *coin_symbol = "BTC", *used = NULL;
+  long gap_limit = 20;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+  while (1)
+    {
+      int option_index = 0;
+      static struct option long_options[] = {
+        {"help",  no_argument, 0, 'h' },
+        {"coin",  required_argument, 0, 'c' },
+        {"used",  required_argument, 0, 'u' },
+        {"gap-limit",  required_argument, 0, 'g' },
+        {"threads",  required_argument, 0, 't' },
+        {0, 0, 0, 0}
+      };
+
+      c = getopt_long(argc, argv, "hc:u:g:t:", long_options, &option_index);
+      if (c == -1)
+        break;
+
+      switch (c) {
+      case 'h':
+        _bip44_discover_command_usage();
+        return EXIT_FAILURE;
+
+      case 'c':
+        coin_symbol = optarg;
+        break;
+
+      case 'u':
+        used = optarg;
+        break;
+
+      case 'g':
+        gap_limit = atol(optarg);
+        break;
+
+      case 't':
+        threads = atol(optarg);
+        break;
+      }
+    }
+
+  if (used == NULL) {
+    fputs("bip44.discover: a file of used addresses is required, see --used\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  if (gap_limit < 1 || gap_limit > 100000) {
+    fputs("bip44.discover: gap limit must be between 1 and 100000\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  if (threads < 1)
+    threads = 1;
+  if (threads > BIP44_MAX_THREADS)
+    threads = BIP44_MAX_THREADS;
+
+  return _bip44_discover(coin_symbol, used, gap_limit, threads);
+}
+
+static void
+_bip44_addresses_command_usage(void)
+{
+  fputs("usage: btct bip44.addresses <args>\n", stderr);
+  fputs("\n", stderr);
+  fputs("  -c, --coin <symbol>      Specify coin symbol for specific coin type, default is 'BTC'.\n", stderr);
+  fputs("  -f, --formats <formats>  Comma separated address types p2pkh (bip44), p2sh-p2wpkh\n", stderr);
+  fputs("                           (bip49), p2wpkh (bip84) or p2tr (bip86), default is p2pkh.\n", stderr);
+  fputs("                           A type followed by ':scripthash' writes the electrum\n", stderr);
+  fputs("                           scripthash of its scriptPubKey instead of the address.\n", stderr);
+  fputs("  -p, --purpose <number>   Purpose of the derivation path, default follows the first\n", stderr);
+  fputs("                           address type.\n", stderr);
+  fputs("  -a, --account <count>    Account number, default is account #0.\n", stderr);
+  fputs("  -i, --internal           Derive addresses of the internal (change) chain.\n", stderr);
+  fputs("  -r, --range <range>      Address index or range of indices as first-last, default\n", stderr);
+  fputs("                           is 0-19.\n", stderr);
+  fputs("  -t, --threads <count>    Number of worker threads, default is one per online cpu.\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Reads a masterkey from stdin and writes a line with derivation path and addresses\n", stderr);
+  fputs("  of each type for every index of the range, blocks of lines are written in no\n", stderr);
+  fputs("  particular order.\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Generate the first 1000 native segwit receive addresses of BTC account #0\n", stderr);
+  fputs("\n", stderr);
+  fputs("      echo 'legal winner thank year wave sausage worth useful legal winner thank yellow' \\\n",stderr);
+  fputs("          | btct bip39.seed --passphrase=TREZOR \\\n", stderr);
+  fputs("          | btct bip32.masterkey\\\n", stderr);
+  fputs("          | btct bip44.addresses --formats=p2wpkh --range=0-999\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Legacy, native segwit and taproot addresses of the same bip84 keys\n", stderr);
+  fputs("\n", stderr);
+  fputs("      ... | btct bip44.addresses --formats=p2wpkh,p2pkh,p2tr\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Native segwit addresses with the scripthash to look them up on an electrum server\n", stderr);
+  fputs("\n", stderr);
+  fputs("      ... | btct bip44.addresses --formats=p2wpkh,p2wpkh:scripthash\n", stderr);
+  fputs("\n", stderr);
+}
+
+static int
+_bip44_addresses_command(int argc, char **argv)
+{
+  int c;
+  char *coin_symbol = "BTC";
+  address_format_t formats[ADDRESS_FORMAT_MAX] = { { ADDRESS_P2PKH, ADDRESS_ENCODING_ADDRESS } };
+  size_t format_cnt = 1;
+  char names[256];
+  uint32_t purpose_nr = 0, account_nr = 0, chain = 0, first = 0, last = 19, unused;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+  while (1)
+    {
+      int option_index = 0;
+      static struct option long_options[] = {
+        {"help",  no_argument, 0, 'h' },
+        {"coin",  required_argument, 0, 'c' },
+        {"formats",  required_argument, 0, 'f' },
+        {"format",  required_argument, 0, 'f' },
+        {"purpose",  required_argument, 0, 'p' },
+        {"account",  required_argument, 0, 'a' },
+        {"internal",  no_argument, 0, 'i' },
+        {"range",  required_argument, 0, 'r' },
+        {"threads",  required_argument, 0, 't' },
+        {0, 0, 0, 0}
+      };
+
+      c = getopt_long(argc, argv, "hc:f:p:a:ir:t:", long_options, &option_index);
+      if (c == -1)
+        break;
+
+      switch (c) {
+      case 'h':
+        _bip44_addresses_command_usage();
+        return EXIT_FAILURE;
+
+      case 'c':
+        coin_symbol = optarg;
+        break;
+
+      case 'f':
+        // parsing splits the list in place, keep optarg for the error message
+        snprintf(names, sizeof(names), "%s", optarg);
+        if (address_formats_from_names(names, formats, &format_cnt) != 0) {
+          fprintf(stderr, "bip44.addresses: invalid address formats '%s'\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'p':
+        if (utils_parse_range(optarg, &purpose_nr, &unused) != 0 || unused != purpose_nr
+            || purpose_nr >= 0x80000000)
+        {
+          fprintf(stderr, "bip44.addresses: invalid purpose '%s'\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'a':
+        if (utils_parse_range(optarg, &account_nr, &unused) != 0 || unused != account_nr
+            || account_nr >= 0x80000000)
+        {
+          fprintf(stderr, "bip44.addresses: invalid account '%s'\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'i':
+        chain = 1;
+        break;
+
+      case 'r':
+        if (utils_parse_range(optarg, &first, &last) != 0 || last >= 0x80000000) {
+          fprintf(stderr, "bip44.addresses: invalid address range '%s'\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 't':
+        threads = atol(optarg);
+        break;
+      }
+    }
+
+  if (threads < 1)
+    threads = 1;
+  if (threads > BIP44_MAX_THREADS)
+    threads = BIP44_MAX_THREADS;
+
+  if (purpose_nr == 0)
+    purpose_nr = address_type_purpose(formats[0].type);
+
+  return _bip44_addresses(coin_symbol, formats, format_cnt, purpose_nr, account_nr, chain,
+                          first, last, threads);
+}
+
 static void _bip44_command_usage(void)
 {
   fputs("usage: btct bip44.<command> <args>\n", stderr);
   fputs("\n", stderr);
   fputs("  account         Generate a bip44 account for specified coin from encoded masterkey\n", stderr);
   fputs("                  read on stdin.\n", stderr);
+  fputs("  accounts        Generate account xpubs for a range of accounts of several coins\n", stderr);
+  fputs("                  from encoded masterkey read on stdin.\n", stderr);
+  fputs("  discover        Discover used accounts of a coin from encoded masterkey read on\n", stderr);
+  fputs("                  stdin and a file of used addresses.\n", stderr);
+  fputs("  addresses       Generate p2pkh, segwit or taproot addresses of a range of indices\n", stderr);
+  fputs("                  of an account from encoded masterkey read on stdin.\n", stderr);
   fputs("\n",stderr);
   fputs("examples:\n", stderr);
   fputs("\n",stderr);
@@ -134,6 +911,9 @@ int bip44_command(int argc, char **argv)
 
   struct command_t commands[] = {
     { "bip44.account", _bip44_account_command },
+    { "bip44.accounts", _bip44_accounts_command },
+    { "bip44.discover", _bip44_discover_command },
+    { "bip44.addresses", _bip44_addresses_command },
     { NULL, NULL, }
   };
 
@@ -0,0 +1,258 @@
+/**
+ * Generates bip44_registry.h from the coin table in bip44_coins.h: the
+ * coins with their address parameters and two perfect hash indices over
+ * them, one by upper case symbol and one by coin type.
+ *
+ * The indices use hash and displace: a key is put in bucket
+ * hash(key, 0) % buckets and every bucket has a seed chosen so that
+ * hash(key, seed) % slots of its keys land on free slots. A lookup hashes
+ * the key twice and compares one entry.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+
+// most coins only have type, symbol and name, zero parameters mark them as without addresses
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+#include "bip44_coins.h"
+
+#define COIN_CNT (sizeof(bip44_coins) / sizeof(bip44_coins[0]))
+#define SYMBOL_MAX 16
+#define EMPTY 0xffff
+
+typedef struct _key_t {
+  uint8_t data[SYMBOL_MAX];
+  size_t size;
+  uint16_t coin;
+} _key_t;
+
+typedef struct _index_t {
+  size_t buckets;
+  size_t slots;
+  uint16_t *seeds;
+  uint16_t *table;
+} _index_t;
+
+static size_t *_sort_bucket_sizes;
+
+static int
+_bucket_cmp(const void *a, const void *b)
+{
+  size_t sa = _sort_bucket_sizes[*(const size_t *)a], sb = _sort_bucket_sizes[*(const size_t *)b];
+  return sa < sb ? 1 : sa > sb ? -1 : 0;
+}
+
+static int
+_index_build(_index_t *index, _key_t *keys, size_t count)
+{
+  size_t *bucket_of, *bucket_sizes, *order, slots[64];
+  uint8_t *used;
+
+  index->buckets = count / 4 + 1;
+  index->slots = count + count / 4 + 1;
+  index->seeds = calloc(index->buckets, sizeof(uint16_t));
+  index->table = malloc(index->slots * sizeof(uint16_t));
+  bucket_of = calloc(count, sizeof(size_t));
+  bucket_sizes = calloc(index->buckets, sizeof(size_t));
+  order = calloc(index->buckets, sizeof(size_t));
+  used = calloc(index->slots, 1);
+  if (!index->seeds || !index->table || !bucket_of || !bucket_sizes || !order || !used)
+    return -1;
+
+  for (size_t s = 0; s < index->slots; s++)
+    index->table[s] = EMPTY;
+
+  for (size_t k = 0; k < count; k++) {
+    bucket_of[k] = bip44_coin_hash(keys[k].data, keys[k].size, 0) % index->buckets;
+    bucket_sizes[bucket_of[k]]++;
+  }
+
+  // place the largest buckets first while most slots are free
+  for (size_t b = 0; b < index->buckets; b++)
+    order[b] = b;
+  _sort_bucket_sizes = bucket_sizes;
+  qsort(order, index->buckets, sizeof(size_t), _bucket_cmp);
+
+  for (size_t o = 0; o < index->buckets; o++) {
+    size_t b = order[o], size = bucket_sizes[b];
+    uint32_t seed;
+
+    if (size == 0)
+      break;
+    if (size > sizeof(slots) / sizeof(slots[0]))
+      return -1;
+
+    for (seed = 1; seed < EMPTY; seed++) {
+      size_t n = 0;
+
+      for (size_t k = 0; k < count && n < size; k++) {
+        size_t slot;
+
+        if (bucket_of[k] != b)
+          continue;
+
+        slot = bip44_coin_hash(keys[k].data, keys[k].size, seed) % index->slots;
+        if (used[slot])
+          break;
+
+        size_t i;
+        for (i = 0; i < n && slots[i] != slot; i++)
+          ;
+        if (i < n)
+          break;
+        slots[n++] = slot;
+      }
+
+      if (n == size)
+        break;
+    }
+
+    if (seed == EMPTY)
+      return -1;
+
+    index->seeds[b] = seed;
+    for (size_t k = 0, n = 0; k < count; k++) {
+      if (bucket_of[k] != b)
+        continue;
+      used[slots[n]] = 1;
+      index->table[slots[n++]] = keys[k].coin;
+    }
+  }
+
+  free(bucket_of);
+  free(bucket_sizes);
+  free(order);
+  free(used);
+  return 0;
+}
+
+static void
+_index_write(FILE *out, const char *macro, const char *name, const _index_t *index)
+{
+  fprintf(out, "#define BIP44_REGISTRY_%s_BUCKETS %zu\n", macro, index->buckets);
+  fprintf(out, "#define BIP44_REGISTRY_%s_SLOTS %zu\n\n", macro, index->slots);
+
+  fprintf(out, "static const uint16_t bip44_registry_seeds_by_%s[] = {", name);
+  for (size_t b = 0; b < index->buckets; b++)
+    fprintf(out, "%s%u,", b % 16 ? " " : "\n  ", index->seeds[b]);
+  fputs("\n};\n\n", out);
+
+  fprintf(out, "static const uint16_t bip44_registry_by_%s[] = {", name);
+  for (size_t s = 0; s < index->slots; s++)
+    fprintf(out, "%s%u,", s % 16 ? " " : "\n  ", index->table[s]);
+  fputs("\n};\n\n", out);
+}
+
+static void
+_string_write(FILE *out, const char *str)
+{
+  if (str == NULL) {
+    fputs("NULL", out);
+    return;
+  }
+
+  fputc('"', out);
+  for (; *str; str++) {
+    if (*str == '"' || *str == '\\')
+      fputc('\\', out);
+    fputc(*str, out);
+  }
+  fputc('"', out);
+}
+
+int
+main(int argc, char **argv)
+{
+  static _key_t symbols[COIN_CNT], types[COIN_CNT];
+  _index_t by_symbol, by_type;
+  size_t symbol_cnt = 0, symbol_max = 0;
+  FILE *out;
+
+  if (argc != 2) {
+    fputs("usage: bip44_registry_gen <output>\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  for (size_t c = 0; c < COIN_CNT; c++) {
+    const char *symbol = bip44_coins[c].symbol;
+    size_t size = strlen(symbol);
+    bool duplicate = false;
+
+    types[c].size = 4;
+    types[c].coin = c;
+    types[c].data[0] = bip44_coins[c].type >> 24;
+    types[c].data[1] = bip44_coins[c].type >> 16;
+    types[c].data[2] = bip44_coins[c].type >> 8;
+    types[c].data[3] = bip44_coins[c].type;
+
+    if (size == 0)
+      continue;
+    if (size > SYMBOL_MAX) {
+      fprintf(stderr, "bip44_registry_gen: symbol '%s' is too long\n", symbol);
+      return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < size; i++)
+      symbols[symbol_cnt].data[i] = toupper((unsigned char)symbol[i]);
+    symbols[symbol_cnt].size = size;
+    symbols[symbol_cnt].coin = c;
+
+    // a symbol shared by several coins finds the first one
+    for (size_t s = 0; s < symbol_cnt && !duplicate; s++)
+      duplicate = symbols[s].size == size && memcmp(symbols[s].data, symbols[symbol_cnt].data, size) == 0;
+    if (duplicate)
+      continue;
+
+    if (size > symbol_max)
+      symbol_max = size;
+    symbol_cnt++;
+  }
+
+  if (_index_build(&by_symbol, symbols, symbol_cnt) != 0
+      || _index_build(&by_type, types, COIN_CNT) != 0)
+  {
+    fputs("bip44_registry_gen: failed to build perfect hash\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  out = fopen(argv[1], "w");
+  if (out == NULL) {
+    fprintf(stderr, "bip44_registry_gen: failed to open '%s'\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  fputs("/* generated by bip44_registry_gen from bip44_coins.h, do not edit */\n", out);
+  fputs("#ifndef __bip44_registry_h\n#define __bip44_registry_h\n\n", out);
+  fputs("#include \"bip44_coin.h\"\n\n", out);
+  fprintf(out, "#define BIP44_REGISTRY_SIZE %zu\n", COIN_CNT);
+  fprintf(out, "#define BIP44_REGISTRY_SYMBOL_MAX %zu\n", symbol_max);
+  fprintf(out, "#define BIP44_REGISTRY_EMPTY %u\n\n", EMPTY);
+
+  fputs("static const bip44_coin_t bip44_registry[] = {\n", out);
+  for (size_t c = 0; c < COIN_CNT; c++) {
+    const bip44_coin_t *coin = &bip44_coins[c];
+
+    fprintf(out, "  { %u, ", coin->type);
+    _string_write(out, coin->symbol);
+    fputs(", ", out);
+    _string_write(out, coin->coin);
+    fprintf(out, ", 0x%02x, 0x%02x, 0x%02x, ", coin->p2pkh, coin->p2sh, coin->wif);
+    _string_write(out, coin->hrp);
+    fprintf(out, ", 0x%08x, 0x%08x },\n", coin->xpub, coin->xprv);
+  }
+  fputs("};\n\n", out);
+
+  _index_write(out, "SYMBOL", "symbol", &by_symbol);
+  _index_write(out, "TYPE", "type", &by_type);
+
+  fputs("#endif\n", out);
+
+  if (fclose(out) != 0) {
+    fprintf(stderr, "bip44_registry_gen: failed to write '%s'\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -1,10 +1,30 @@
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
 #include <nettle/hmac.h>
 
 #include "../external/libbase58/libbase58.h"
 
 #include "bip39.h"
 #include "bip85.h"
+#include "stats.h"
+#include "utils.h"
+
+static const char *_bip85_hmac_key = "bip-entropy-from-k";
+
+static size_t
+_bip85_bip39_entropy_bits(uint32_t word_cnt)
+{
+  switch (word_cnt) {
+  case 12: return 128;
+  case 15: return 160;
+  case 18: return 192;
+  case 21: return 224;
+  case 24: return 256;
+  default: return 0;
+  }
+}
 
 int
 bip85_entropy_from_key(const bip32_key_t *master_key, const char *subpath, uint8_t *entropy)
@@ -12,7 +32,6 @@ bip85_entropy_from_key(const bip32_key_t *master_key, const char *subpath, uint8
   bip32_key_t child;
   char bip85_path[256];  
   struct hmac_sha512_ctx hmac_sha512;
-  const char *key = "bip-entropy-from-k";
   
   if (master_key->public == true)
     return -1;
@@ -21,80 +40,356 @@ bip85_entropy_from_key(const bip32_key_t *master_key, const char *subpath, uint8
   if (bip32_key_derive_child_by_path(master_key, bip85_path, &child) != 0)
     return -2;
 
-  hmac_sha512_set_key(&hmac_sha512, strlen(key), (uint8_t*)key);
+  STATS_INC(STATS_HMAC_SHA512);
+  hmac_sha512_set_key(&hmac_sha512, strlen(_bip85_hmac_key), (const uint8_t *)_bip85_hmac_key);
   hmac_sha512_update(&hmac_sha512, sizeof(child.key.private), child.key.private);
   hmac_sha512_digest(&hmac_sha512, 64, entropy);  
 
+  utils_wipe(&child, sizeof(child));
   return 0;
 }
 
 int
-bip85_application_bip39(const bip32_key_t *key, uint32_t language, uint32_t word_cnt, uint32_t index,
-                            char ***result, size_t *result_cnt)
+bip85_init(bip85_t *ctx, const bip32_key_t *master_key, const char *subpath)
+{
+  char bip85_path[256];
+
+  memset(ctx, 0, sizeof(bip85_t));
+
+  if (master_key->public == true)
+    return -1;
+
+  snprintf(bip85_path, sizeof(bip85_path), "m/83696968'/%s", subpath);
+  if (bip32_key_derive_child_by_path(master_key, bip85_path, &ctx->node) != 0)
+    return -2;
+
+  hmac_sha512_set_key(&ctx->chain_hmac, sizeof(ctx->node.chain), ctx->node.chain);
+  hmac_sha512_set_key(&ctx->hmac, strlen(_bip85_hmac_key), (const uint8_t *)_bip85_hmac_key);
+  return 0;
+}
+
+void
+bip85_clear(bip85_t *ctx)
+{
+  utils_wipe(ctx, sizeof(bip85_t));
+}
+
+int
+bip85_entropy_from_index(const bip85_t *ctx, uint32_t index, uint8_t *entropy)
 {
-  bip39_t bip39;
-  char buf[1024] = {0};
-  uint8_t entropy[512] = {0};
-  size_t entropy_bits;
+  struct hmac_sha512_ctx hmac_sha512;
+  uint8_t child[32];
+
+  if (index >= 0x80000000)
+    return -1;
+
+  // only the private key of the child is used, no chain code or fingerprint
+  if (bip32_key_derive_hardened_private_key(&ctx->node, &ctx->chain_hmac, index, child) != 0)
+    return -2;
 
-  if (word_cnt == 12) entropy_bits = 128;
-  else if (word_cnt == 15) entropy_bits = 160;
-  else if (word_cnt == 18) entropy_bits = 192;
-  else if (word_cnt == 21) entropy_bits = 224;
-  else if (word_cnt == 24) entropy_bits = 256;
-  else return -1;
+  // the keyed inner and outer state is copied instead of set up again
+  STATS_INC(STATS_HMAC_SHA512);
+  hmac_sha512 = ctx->hmac;
+  hmac_sha512_update(&hmac_sha512, sizeof(child), child);
+  hmac_sha512_digest(&hmac_sha512, 64, entropy);
+
+  utils_wipe(child, sizeof(child));
+  utils_wipe(&hmac_sha512, sizeof(hmac_sha512));
+  return 0;
+}
+
+int
+bip85_bip39_init(bip85_t *ctx, const bip32_key_t *key, uint32_t language, uint32_t word_cnt)
+{
+  char subpath[64];
+
+  if (_bip85_bip39_entropy_bits(word_cnt) == 0)
+    return -1;
 
   // only suport for english bip39
   if (language != 0)
     return -2;
 
-  // derive entropy for bip39 seed phrase
-  snprintf(buf, sizeof(buf), "39'/%d'/%d'/%d'", language, word_cnt, index);
-  if (bip85_entropy_from_key(key, buf, &entropy) != 0)
+  snprintf(subpath, sizeof(subpath), "39'/%" PRIu32 "'/%" PRIu32 "'", language, word_cnt);
+  if (bip85_init(ctx, key, subpath) != 0)
     return -3;
 
-  bip39_init(&bip39);  
-  if (bip39_to_mnemonics(&bip39, entropy, entropy_bits, result, result_cnt) != 0)
-    return -4;
+  ctx->length = word_cnt;
+  return 0;
+}
 
+int
+bip85_bip39_from_index(const bip85_t *ctx, uint32_t index, const char **words, size_t *word_cnt)
+{
+  uint8_t entropy[64];
+  int res = 0;
+
+  if (bip85_entropy_from_index(ctx, index, entropy) != 0)
+    return -3;
+
+  if (bip39_to_words(entropy, _bip85_bip39_entropy_bits(ctx->length), words, word_cnt) != 0)
+    res = -4;
+
+  utils_wipe(entropy, sizeof(entropy));
+  return res;
+}
+
+int
+bip85_application_bip39(const bip32_key_t *key, uint32_t language, uint32_t word_cnt, uint32_t index,
+                            char ***result, size_t *result_cnt)
+{
+  bip85_t bip85;
+  const char *words[BIP85_BIP39_MAX_WORDS];
+  int res;
+
+  res = bip85_bip39_init(&bip85, key, language, word_cnt);
+  if (res == 0)
+    res = bip85_bip39_from_index(&bip85, index, words, result_cnt);
+  bip85_clear(&bip85);
+
+  if (res != 0)
+    return res;
+
+  *result = malloc(sizeof(char *) * *result_cnt);
+  if (*result == NULL)
+    return -5;
+
+  memcpy(*result, words, sizeof(char *) * *result_cnt);
   return 0;
 }
 
 int
-bip85_application_pwd_base85(const bip32_key_t *key, uint32_t length, uint32_t index, char *result)
+bip85_xprv_init(bip85_t *ctx, const bip32_key_t *key)
 {
-  char buf[1024] = {0};
-  size_t buf_size = sizeof(buf);
-  uint8_t entropy[512] = {0};
+  return bip85_init(ctx, key, "32'") == 0 ? 0 : -1;
+}
 
-  snprintf(buf, buf_size, "707785'/%d'/%d'", length, index);
-  if (bip85_entropy_from_key(key, buf, &entropy) != 0)
+int
+bip85_xprv_from_index(const bip85_t *ctx, uint32_t index, bip32_key_t *result)
+{
+  uint8_t entropy[64];
+  int res = 0;
+
+  if (bip85_entropy_from_index(ctx, index, entropy) != 0)
+    return -1;
+
+  // first half is the chain code, second half the private key
+  if (bip32_key_init_from_chain_and_key(result, entropy, entropy + 32) != 0)
+    res = -2;
+
+  utils_wipe(entropy, sizeof(entropy));
+  return res;
+}
+
+int
+bip85_hex_init(bip85_t *ctx, const bip32_key_t *key, uint32_t byte_cnt)
+{
+  char subpath[64];
+
+  if (byte_cnt < 16 || byte_cnt > 64)
     return -1;
 
-  if (utils_base85_encode(entropy, 64, buf) != 0)
+  snprintf(subpath, sizeof(subpath), "128169'/%" PRIu32 "'", byte_cnt);
+  if (bip85_init(ctx, key, subpath) != 0)
     return -2;
 
-  strncat(result, buf, length);
+  ctx->length = byte_cnt;
   return 0;
 }
 
 int
-bip85_application_hd_seed_wif(const bip32_key_t *key, uint32_t index, char *result, size_t *size)
+bip85_hex_from_index(const bip85_t *ctx, uint32_t index, uint8_t *result)
+{
+  uint8_t entropy[64];
+
+  if (bip85_entropy_from_index(ctx, index, entropy) != 0)
+    return -1;
+
+  memcpy(result, entropy, ctx->length);
+  utils_wipe(entropy, sizeof(entropy));
+  return 0;
+}
+
+int
+bip85_application_xprv(const bip32_key_t *key, uint32_t index, bip32_key_t *result)
 {
-  char buf[1024] = {0};
-  size_t buf_size = sizeof(buf);
-  uint8_t entropy[512] = {0};
+  bip85_t bip85;
+  int res;
+
+  res = bip85_xprv_init(&bip85, key);
+  if (res == 0)
+    res = bip85_xprv_from_index(&bip85, index, result);
+
+  bip85_clear(&bip85);
+  return res;
+}
+
+int
+bip85_application_hex(const bip32_key_t *key, uint32_t byte_cnt, uint32_t index, uint8_t *result)
+{
+  bip85_t bip85;
+  int res;
+
+  res = bip85_hex_init(&bip85, key, byte_cnt);
+  if (res == 0)
+    res = bip85_hex_from_index(&bip85, index, result);
+
+  bip85_clear(&bip85);
+  return res;
+}
+
+int
+bip85_drng_init(bip85_drng_t *ctx, const bip32_key_t *key, uint32_t index)
+{
+  bip85_t bip85;
+  uint8_t entropy[64];
+
+  memset(ctx, 0, sizeof(bip85_drng_t));
+
+  if (bip85_init(&bip85, key, "0'") != 0 || bip85_entropy_from_index(&bip85, index, entropy) != 0) {
+    bip85_clear(&bip85);
+    return -1;
+  }
+
+  // absorb the entropy, one block of shake256 with its 0x1f and 0x80 padding
+  for (size_t i = 0; i < sizeof(entropy); i++)
+    ctx->state.a[i / 8] ^= (uint64_t)entropy[i] << (8 * (i % 8));
+  ctx->state.a[sizeof(entropy) / 8] ^= (uint64_t)0x1f << (8 * (sizeof(entropy) % 8));
+  ctx->state.a[(SHA3_256_BLOCK_SIZE - 1) / 8] ^= (uint64_t)0x80 << (8 * ((SHA3_256_BLOCK_SIZE - 1) % 8));
+  sha3_permute(&ctx->state);
+
+  bip85_clear(&bip85);
+  utils_wipe(entropy, sizeof(entropy));
+  return 0;
+}
+
+int
+bip85_drng_read(bip85_drng_t *ctx, uint8_t *result, size_t size)
+{
+  while (size > 0) {
+    if (ctx->offset == SHA3_256_BLOCK_SIZE) {
+      sha3_permute(&ctx->state);
+      ctx->offset = 0;
+    }
+
+    // whole lanes at once where the block and output allow it
+    if (ctx->offset % 8 == 0 && size >= 8) {
+      uint64_t lane = ctx->state.a[ctx->offset / 8];
+      for (int i = 0; i < 8; i++)
+        result[i] = lane >> (8 * i);
+      result += 8;
+      size -= 8;
+      ctx->offset += 8;
+      continue;
+    }
+
+    *result++ = ctx->state.a[ctx->offset / 8] >> (8 * (ctx->offset % 8));
+    size--;
+    ctx->offset++;
+  }
+
+  return 0;
+}
+
+void
+bip85_drng_clear(bip85_drng_t *ctx)
+{
+  utils_wipe(ctx, sizeof(bip85_drng_t));
+}
+
+int
+bip85_pwd_base85_init(bip85_t *ctx, const bip32_key_t *key, uint32_t length)
+{
+  char subpath[32];
+
+  if (length < 1 || length > BIP85_PWD_BASE85_MAX)
+    return -1;
+
+  snprintf(subpath, sizeof(subpath), "707785'/%" PRIu32 "'", length);
+  if (bip85_init(ctx, key, subpath) != 0)
+    return -2;
+
+  ctx->length = length;
+  return 0;
+}
+
+int
+bip85_pwd_base85_from_index(const bip85_t *ctx, uint32_t index, char *result)
+{
+  uint8_t entropy[64];
+  char encoded[BIP85_PWD_BASE85_MAX];
+  int res;
+
+  if (bip85_entropy_from_index(ctx, index, entropy) != 0)
+    return -1;
+
+  // only the groups of 4 bytes that end up in the password are encoded
+  res = utils_base85_encode(entropy, (ctx->length + 4) / 5 * 4, encoded);
+  utils_wipe(entropy, sizeof(entropy));
+  if (res != 0) {
+    utils_wipe(encoded, sizeof(encoded));
+    return -2;
+  }
+
+  memcpy(result, encoded, ctx->length);
+  result[ctx->length] = '\0';
+
+  utils_wipe(encoded, sizeof(encoded));
+  return 0;
+}
+
+int
+bip85_application_pwd_base85(const bip32_key_t *key, uint32_t length, uint32_t index, char *result)
+{
+  bip85_t bip85;
+  int res;
+
+  res = bip85_pwd_base85_init(&bip85, key, length);
+  if (res == 0)
+    res = bip85_pwd_base85_from_index(&bip85, index, result);
+
+  bip85_clear(&bip85);
+  return res;
+}
+
+int
+bip85_hd_seed_wif_init(bip85_t *ctx, const bip32_key_t *key)
+{
+  return bip85_init(ctx, key, "2'") == 0 ? 0 : -1;
+}
+
+int
+bip85_hd_seed_wif_from_index(const bip85_t *ctx, uint32_t index, char *result, size_t *size)
+{
+  uint8_t entropy[64];
   bip32_key_t private_key;
+  int res = 0;
 
-  snprintf(buf, buf_size, "2'/%d'", index);
-  if (bip85_entropy_from_key(key, buf, &entropy) != 0)
+  if (bip85_entropy_from_index(ctx, index, entropy) != 0)
     return -1;
 
-  private_key.public = false;
+  // the first 32 bytes of the entropy are the key
+  bip32_key_init_private(&private_key);
   memcpy(private_key.key.private, entropy, 32);
 
-  if (bip32_key_to_wif(&private_key, result, &size) != 0)
-    return -3;
+  if (bip32_key_to_wif(&private_key, (uint8_t *)result, size) != 0)
+    res = -2;
 
-  return 0;
+  utils_wipe(entropy, sizeof(entropy));
+  utils_wipe(&private_key, sizeof(private_key));
+  return res;
+}
+
+int
+bip85_application_hd_seed_wif(const bip32_key_t *key, uint32_t index, char *result, size_t *size)
+{
+  bip85_t bip85;
+  int res;
+
+  res = bip85_hd_seed_wif_init(&bip85, key);
+  if (res == 0)
+    res = bip85_hd_seed_wif_from_index(&bip85, index, result, size);
+
+  bip85_clear(&bip85);
+  return res;
 }
@@ -2,11 +2,88 @@
 #define __bip85_h__
 
 #include <stdint.h>
+#include <nettle/hmac.h>
+#include <nettle/sha3.h>
 #include "bip32.h"
 
+/** words of the longest bip39 mnemonic */
+#define BIP85_BIP39_MAX_WORDS 24
+/** longest base85 password, all 64 bytes of entropy encoded */
+#define BIP85_PWD_BASE85_MAX 80
+
+/**
+ * Derivation of many indices of one application. The node of the
+ * application path without its index, m/83696968'/app'/..., the hmac keyed
+ * with its chain code and the keyed entropy hmac are set up once, an index
+ * then costs the hmac and scalar addition of its hardened child key.
+ */
+typedef struct bip85_t {
+  bip32_key_t node;
+  struct hmac_sha512_ctx chain_hmac;
+  struct hmac_sha512_ctx hmac;
+  /** length parameter of the application, words for bip39, bytes for hex and characters for pwd */
+  uint32_t length;
+} bip85_t;
+
 int bip85_entropy_from_key(const bip32_key_t *key, const char *subpath, uint8_t *entropy);
 int bip85_application_bip39(const bip32_key_t *key, uint32_t language, uint32_t word_cnt, uint32_t index,
                             char ***result, size_t *result_cnt);
 int bip85_application_pwd_base85(const bip32_key_t *key, uint32_t length, uint32_t index, char *result);
 int bip85_application_hd_seed_wif(const bip32_key_t *key, uint32_t index, char *result, size_t *size);
+/** master key of a child wallet, application 32' */
+int bip85_application_xprv(const bip32_key_t *key, uint32_t index, bip32_key_t *result);
+/** 16 to 64 bytes of entropy, application 128169', result is byte_cnt bytes */
+int bip85_application_hex(const bip32_key_t *key, uint32_t byte_cnt, uint32_t index, uint8_t *result);
+
+/** derive the node m/83696968'/subpath of master_key, subpath excludes the index */
+int bip85_init(bip85_t *ctx, const bip32_key_t *master_key, const char *subpath);
+/** wipe the cached node */
+void bip85_clear(bip85_t *ctx);
+/** 64 bytes of entropy of index below the cached node, safe to call from several threads */
+int bip85_entropy_from_index(const bip85_t *ctx, uint32_t index, uint8_t *entropy);
+
+/** cache the node of 39'/language'/word_cnt' */
+int bip85_bip39_init(bip85_t *ctx, const bip32_key_t *key, uint32_t language, uint32_t word_cnt);
+/**
+ * Mnemonic of index written to words of BIP85_BIP39_MAX_WORDS entries, the
+ * words point into the word list and nothing is allocated.
+ */
+int bip85_bip39_from_index(const bip85_t *ctx, uint32_t index, const char **words, size_t *word_cnt);
+
+/** cache the node of 32' */
+int bip85_xprv_init(bip85_t *ctx, const bip32_key_t *key);
+/** master key of the child wallet of index, chain code and key are the two halves of the entropy */
+int bip85_xprv_from_index(const bip85_t *ctx, uint32_t index, bip32_key_t *result);
+
+/** cache the node of 128169'/byte_cnt' */
+int bip85_hex_init(bip85_t *ctx, const bip32_key_t *key, uint32_t byte_cnt);
+/** ctx->length bytes of entropy of index */
+int bip85_hex_from_index(const bip85_t *ctx, uint32_t index, uint8_t *result);
+
+/** cache the node of 707785'/length', length is 1 to BIP85_PWD_BASE85_MAX */
+int bip85_pwd_base85_init(bip85_t *ctx, const bip32_key_t *key, uint32_t length);
+/** password of index, result is ctx->length characters and a terminating nul */
+int bip85_pwd_base85_from_index(const bip85_t *ctx, uint32_t index, char *result);
+
+/** cache the node of 2' */
+int bip85_hd_seed_wif_init(bip85_t *ctx, const bip32_key_t *key);
+/** wif of the key of index, size is the size of result and on return the bytes written with the nul */
+int bip85_hd_seed_wif_from_index(const bip85_t *ctx, uint32_t index, char *result, size_t *size);
+
+/**
+ * Deterministic random number generator of application 0', SHAKE256
+ * absorbing the 64 bytes of entropy of index and squeezed for as many
+ * bytes as wanted.
+ */
+typedef struct bip85_drng_t {
+  struct sha3_state state;
+  /** bytes of the current block already read */
+  size_t offset;
+} bip85_drng_t;
+
+int bip85_drng_init(bip85_drng_t *ctx, const bip32_key_t *key, uint32_t index);
+/** read the next size bytes of the stream */
+int bip85_drng_read(bip85_drng_t *ctx, uint8_t *result, size_t size);
+/** wipe the generator state */
+void bip85_drng_clear(bip85_drng_t *ctx);
 #endif
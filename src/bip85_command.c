@@ -1,10 +1,51 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <inttypes.h>
 #include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
 
 #include "command.h"
+#include "address.h"
+#include "bip44.h"
 #include "bip85.h"
+#include "utils.h"
+
+#define BIP85_MAX_THREADS 256
+/** indices derived by a worker at a time */
+#define BIP85_INDEX_BLOCK 64
+
+/** bytes of drng output written at a time */
+#define BIP85_DRNG_BLOCK (64 * 1024)
+/** longest line written for one index */
+#define BIP85_LINE_MAX 512
+
+/**
+ * Write the line of index to line of BIP85_LINE_MAX bytes, returns its
+ * length or negative on error.
+ */
+typedef int (*_bip85_line_fn_t)(const bip85_t *bip85, const void *arg, uint32_t index, char *line);
+
+typedef struct _bip85_indices_t {
+  const bip85_t *bip85;
+  _bip85_line_fn_t line;
+  /** application parameters passed on to line */
+  const void *arg;
+  uint32_t first;
+  size_t count;
+  /** prefix each line with its index */
+  bool numbered;
+  _Atomic size_t next;
+  atomic_int failed;
+} _bip85_indices_t;
+
+typedef struct _bip85_provision_t {
+  const bip44_coin_t *coin;
+  address_type_t type;
+  uint32_t account_nr;
+} _bip85_provision_t;
 
 static int
 _bip85_read_private_key_from_stdin(bip32_key_t *key)
@@ -37,27 +78,180 @@ _bip85_read_private_key_from_stdin(bip32_key_t *key)
   return 0;
 }
 
+/** run worker on up to threads threads, workers take their items from the job */
+static void
+_bip85_run(void *(*worker)(void *), void *job, size_t count, size_t threads)
+{
+  pthread_t workers[BIP85_MAX_THREADS];
+  size_t started = 0;
+
+  if (threads > count)
+    threads = count;
+  if (threads > BIP85_MAX_THREADS)
+    threads = BIP85_MAX_THREADS;
+
+  for (; started < threads; started++) {
+    if (pthread_create(&workers[started], NULL, worker, job) != 0)
+      break;
+  }
+
+  // run on the calling thread if no worker could be started
+  if (started == 0)
+    worker(job);
+
+  for (size_t i = 0; i < started; i++)
+    pthread_join(workers[i], NULL);
+}
+
+static void *
+_bip85_indices_worker(void *arg)
+{
+  _bip85_indices_t *job = arg;
+  size_t blocks = (job->count + BIP85_INDEX_BLOCK - 1) / BIP85_INDEX_BLOCK;
+  char lines[BIP85_INDEX_BLOCK * (12 + BIP85_LINE_MAX)];
+
+  while (atomic_load_explicit(&job->failed, memory_order_relaxed) == 0) {
+    size_t block = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+    size_t offset = block * BIP85_INDEX_BLOCK, count, length = 0;
+
+    if (block >= blocks)
+      break;
+
+    count = job->count - offset < BIP85_INDEX_BLOCK ? job->count - offset : BIP85_INDEX_BLOCK;
+    for (size_t i = 0; i < count; i++) {
+      uint32_t index = job->first + (uint32_t)(offset + i);
+      int line_length;
+
+      if (job->numbered)
+        length += sprintf(lines + length, "%" PRIu32 " ", index);
+
+      line_length = job->line(job->bip85, job->arg, index, lines + length);
+      if (line_length < 0) {
+        atomic_store(&job->failed, 1);
+        break;
+      }
+      length += line_length;
+      lines[length++] = '\n';
+    }
+
+    // a block of lines is written at once, blocks of different workers never interleave
+    flockfile(stdout);
+    fwrite(lines, 1, length, stdout);
+    funlockfile(stdout);
+  }
+
+  return NULL;
+}
+
+/**
+ * Write the lines of a range of indices of the application cached in
+ * bip85, in blocks on worker threads.
+ */
 static int
-_bip85_bip39(uint32_t language, uint32_t words, uint32_t index)
+_bip85_indices(const char *command, const bip85_t *bip85, _bip85_line_fn_t line, const void *arg,
+               uint32_t first, uint32_t last, size_t threads)
+{
+  _bip85_indices_t job = {
+    .bip85 = bip85,
+    .line = line,
+    .arg = arg,
+    .first = first,
+    .count = (size_t)last - first + 1,
+    .numbered = first != last,
+    .next = 0,
+    .failed = 0,
+  };
+
+  _bip85_run(_bip85_indices_worker, &job,
+             (job.count + BIP85_INDEX_BLOCK - 1) / BIP85_INDEX_BLOCK, threads);
+  fflush(stdout);
+
+  if (job.failed) {
+    fprintf(stderr, "%s: failed to derive index\n", command);
+    return -1;
+  }
+
+  return 0;
+}
+
+static int
+_bip85_bip39_line(const bip85_t *bip85, const void *arg, uint32_t index, char *line)
+{
+  const char *words[BIP85_BIP39_MAX_WORDS];
+  size_t word_cnt = 0;
+  int length = 0;
+
+  (void)arg;
+  if (bip85_bip39_from_index(bip85, index, words, &word_cnt) != 0)
+    return -1;
+
+  // 24 words of at most 8 letters fit a line
+  for (size_t w = 0; w < word_cnt; w++)
+    length += sprintf(line + length, w < word_cnt - 1 ? "%s " : "%s", words[w]);
+
+  return length;
+}
+
+/**
+ * Derive the node m/83696968'/39'/language'/words' once, then the
+ * mnemonics of a range of indices in blocks on worker threads.
+ */
+static int
+_bip85_bip39(uint32_t language, uint32_t words, uint32_t first, uint32_t last, size_t threads)
 {
   bip32_key_t key;
-  char **result = NULL;
-  size_t result_count = 0;
+  bip85_t bip85;
+  int res = EXIT_FAILURE;
 
   if (_bip85_read_private_key_from_stdin(&key) != 0)
     return EXIT_FAILURE;
 
-  if (bip85_application_bip39(&key, language, words, index, &result, &result_count) != 0)
-    return EXIT_FAILURE;
-  
-  for(size_t i = 0; i < result_count; i++) {
-    fprintf(stdout, "%s", result[i]);
-    if (i < result_count - 1)
-      fputs(" ", stdout);
+  if (bip85_bip39_init(&bip85, &key, language, words) != 0) {
+    fputs("bip85.bip39: failed to derive application key\n", stderr);
+    goto out;
+  }
+
+  if (_bip85_indices("bip85.bip39", &bip85, _bip85_bip39_line, NULL, first, last, threads) != 0)
+    goto out;
+
+  res = EXIT_SUCCESS;
+
+ out:
+  utils_wipe(&key, sizeof(key));
+  bip85_clear(&bip85);
+  return res;
+}
+
+/** worker threads of the -t option or the online cpu default, after option parsing */
+static size_t
+_bip85_threads(long threads)
+{
+  if (threads < 1)
+    threads = 1;
+  if (threads > BIP85_MAX_THREADS)
+    threads = BIP85_MAX_THREADS;
+  return threads;
+}
+
+/** parse the options shared by the range commands, returns the option if not one of them */
+static int
+_bip85_parse_range_option(const char *command, int c, uint32_t *first, uint32_t *last, long *threads)
+{
+  switch (c) {
+  case 'i':
+    if (utils_parse_range(optarg, first, last) != 0 || *last >= 0x80000000) {
+      fprintf(stderr, "%s: invalid index range '%s'\n", command, optarg);
+      return -1;
+    }
+    return 0;
+
+  case 't':
+    *threads = atol(optarg);
+    return 0;
+
+  default:
+    return c;
   }
-  fputs("\n", stdout);
-  
-  return EXIT_SUCCESS;
 }
 
 static void
@@ -71,7 +265,10 @@ _bip85_bip39_command_usage(void)
   fputs("  -l, --language <index> Specify which language to use for  mnemonics , default\n", stderr);
   fputs("                         language is 0 (english).\n", stderr);
   fputs("  -w, --words <count>    Specify the amount of words to use, default is 12\n", stderr);
-  fputs("  -i, --index <index>    Specify the index for the mnemonics, default is 0\n", stderr);
+  fputs("  -i, --index <index>    Specify the index or range of indices as first-last for the\n", stderr);
+  fputs("                         mnemonics, default is 0. For a range each line starts with\n", stderr);
+  fputs("                         the index, blocks of lines are written in no particular order.\n", stderr);
+  fputs("  -t, --threads <count>  Number of worker threads, default is one per online cpu.\n", stderr);
   fputs("\n", stderr);
   fputs("  Generate 24 words mnemonics for use with a hot wallet\n", stderr);
   fputs("\n", stderr);
@@ -80,6 +277,10 @@ _bip85_bip39_command_usage(void)
   fputs("          | btct bip32.masterkey\\\n", stderr);
   fputs("          | btct bip85.bip39 --words=24 --index=100\n", stderr);
   fputs("\n", stderr);
+  fputs("  Generate the mnemonics of the first 10000 child wallets\n", stderr);
+  fputs("\n", stderr);
+  fputs("      ... | btct bip85.bip39 --index=0-9999\n", stderr);
+  fputs("\n", stderr);
 }
 
 static  int
@@ -88,7 +289,8 @@ _bip85_bip39_command(int argc, char **argv)
   int c;
   uint32_t language = 0;
   uint32_t word_cnt = 12;
-  uint32_t index = 0;
+  uint32_t first = 0, last = 0;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
 
   while (1)
     {
@@ -98,14 +300,15 @@ _bip85_bip39_command(int argc, char **argv)
         {"language",  required_argument, 0, 'l' },
         {"words",  required_argument, 0, 'w' },
         {"index",  required_argument, 0, 'i' },
+        {"threads",  required_argument, 0, 't' },
         {0, 0, 0, 0}
       };
 
-      c = getopt_long(argc, argv, "hl:w:i:", long_options, &option_index);
+      c = getopt_long(argc, argv, "hl:w:i:t:", long_options, &option_index);
       if (c == -1)
         break;
 
-      switch (c) {
+      switch (_bip85_parse_range_option("bip85.bip39", c, &first, &last, &threads)) {
       case 'h':
         _bip85_bip39_command_usage();
         return EXIT_FAILURE;
@@ -118,13 +321,12 @@ _bip85_bip39_command(int argc, char **argv)
         word_cnt = atoi(optarg);
         break;
 
-      case 'i':
-        index = atoi(optarg);
-        break;
+      case -1:
+        return EXIT_FAILURE;
       }
     }
 
-  return _bip85_bip39(language, word_cnt, index);
+  return _bip85_bip39(language, word_cnt, first, last, _bip85_threads(threads));
 }
 
 static void
@@ -134,8 +336,11 @@ _bip85_pwd_base85_command_usage(void)
   fputs("\n", stderr);
   fputs("Generates a new password from deterministic entropy using base85 encoding.\n", stderr);
   fputs("\n", stderr);
-  fputs("  -l, --length <length>  Specify the length of password, default is 12.\n", stderr);
-  fputs("  -i, --index <index>    Specify the index for the password, default is 0\n", stderr);
+  fputs("  -l, --length <length>  Specify the length of password, 1 to 80, default is 12.\n", stderr);
+  fputs("  -i, --index <index>    Specify the index or range of indices as first-last for the\n", stderr);
+  fputs("                         password, default is 0. For a range each line starts with\n", stderr);
+  fputs("                         the index.\n", stderr);
+  fputs("  -t, --threads <count>  Number of worker threads, default is one per online cpu.\n", stderr);
   fputs("\n", stderr);
   fputs("  Generate a password with length 12 from index 1\n", stderr);
   fputs("\n", stderr);
@@ -147,20 +352,36 @@ _bip85_pwd_base85_command_usage(void)
 }
 
 static int
-_bip85_pwd_base85(uint32_t length, uint32_t index)
+_bip85_pwd_base85_line(const bip85_t *bip85, const void *arg, uint32_t index, char *line)
+{
+  (void)arg;
+  return bip85_pwd_base85_from_index(bip85, index, line) == 0 ? (int)bip85->length : -1;
+}
+
+static int
+_bip85_pwd_base85(uint32_t length, uint32_t first, uint32_t last, size_t threads)
 {
   bip32_key_t key;
-  char buf[512];
+  bip85_t bip85;
+  int res = EXIT_FAILURE;
 
   if (_bip85_read_private_key_from_stdin(&key) != 0)
     return EXIT_FAILURE;
 
-  if (bip85_application_pwd_base85(&key, length, index, buf) != 0)
-    return EXIT_FAILURE;
+  if (bip85_pwd_base85_init(&bip85, &key, length) != 0) {
+    fputs("bip85.pwd_base85: failed to derive application key, length should be 1 to 80\n", stderr);
+    goto out;
+  }
+
+  if (_bip85_indices("bip85.pwd_base85", &bip85, _bip85_pwd_base85_line, NULL, first, last, threads) != 0)
+    goto out;
 
-  fprintf(stdout, "%s\n", buf);
+  res = EXIT_SUCCESS;
 
-  return EXIT_SUCCESS;
+ out:
+  utils_wipe(&key, sizeof(key));
+  bip85_clear(&bip85);
+  return res;
 }
 
 static  int
@@ -168,7 +389,8 @@ _bip85_pwd_base85_command(int argc, char **argv)
 {
   int c;
   uint32_t length = 12;
-  uint32_t index = 0;
+  uint32_t first = 0, last = 0;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
 
   while (1)
     {
@@ -177,14 +399,15 @@ _bip85_pwd_base85_command(int argc, char **argv)
         {"help",  no_argument, 0, 'h' },
         {"length",  required_argument, 0, 'l' },
         {"index",  required_argument, 0, 'i' },
+        {"threads",  required_argument, 0, 't' },
         {0, 0, 0, 0}
       };
 
-      c = getopt_long(argc, argv, "hl:i:", long_options, &option_index);
+      c = getopt_long(argc, argv, "hl:i:t:", long_options, &option_index);
       if (c == -1)
         break;
 
-      switch (c) {
+      switch (_bip85_parse_range_option("bip85.pwd_base85", c, &first, &last, &threads)) {
       case 'h':
         _bip85_pwd_base85_command_usage();
         return EXIT_FAILURE;
@@ -193,13 +416,12 @@ _bip85_pwd_base85_command(int argc, char **argv)
         length = atoi(optarg);
         break;
 
-      case 'i':
-        index = atoi(optarg);
-        break;
+      case -1:
+        return EXIT_FAILURE;
       }
     }
 
-  return _bip85_pwd_base85(length, index);
+  return _bip85_pwd_base85(length, first, last, _bip85_threads(threads));
 }
 
 static void
@@ -209,7 +431,9 @@ _bip85_hd_seed_wif_command_usage(void)
   fputs("\n", stderr);
   fputs("Generates a HD Seed WIF from deterministic entropy for Bitcoin Core wallets.\n", stderr);
   fputs("\n", stderr);
-  fputs("  -i, --index <index>    Specify the index for the password, default is 0\n", stderr);
+  fputs("  -i, --index <index>    Specify the index or range of indices as first-last, default\n", stderr);
+  fputs("                         is 0. For a range each line starts with the index.\n", stderr);
+  fputs("  -t, --threads <count>  Number of worker threads, default is one per online cpu.\n", stderr);
   fputs("\n", stderr);
   fputs("  Generate HD Seed WIF wallet using index 2\n", stderr);
   fputs("\n", stderr);
@@ -221,28 +445,47 @@ _bip85_hd_seed_wif_command_usage(void)
 }
 
 static int
-_bip85_hd_seed_wif(uint32_t index)
+_bip85_hd_seed_wif_line(const bip85_t *bip85, const void *arg, uint32_t index, char *line)
+{
+  size_t size = BIP85_LINE_MAX;
+
+  (void)arg;
+  // size includes the terminating nul
+  return bip85_hd_seed_wif_from_index(bip85, index, line, &size) == 0 ? (int)size - 1 : -1;
+}
+
+static int
+_bip85_hd_seed_wif(uint32_t first, uint32_t last, size_t threads)
 {
   bip32_key_t key;
-  char buf[512];
-  size_t size;
+  bip85_t bip85;
+  int res = EXIT_FAILURE;
 
   if (_bip85_read_private_key_from_stdin(&key) != 0)
     return EXIT_FAILURE;
 
-  if (bip85_application_hd_seed_wif(&key, index, buf, &size) != 0)
-    return EXIT_FAILURE;
+  if (bip85_hd_seed_wif_init(&bip85, &key) != 0) {
+    fputs("bip85.hd_seed_wif: failed to derive application key\n", stderr);
+    goto out;
+  }
+
+  if (_bip85_indices("bip85.hd_seed_wif", &bip85, _bip85_hd_seed_wif_line, NULL, first, last, threads) != 0)
+    goto out;
 
-  fprintf(stdout, "%s\n", buf);
+  res = EXIT_SUCCESS;
 
-  return EXIT_SUCCESS;
+ out:
+  utils_wipe(&key, sizeof(key));
+  bip85_clear(&bip85);
+  return res;
 }
 
 static int
 _bip85_hd_seed_wif_command(int argc, char **argv)
 {
   int c;
-  uint32_t index = 0;
+  uint32_t first = 0, last = 0;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
 
   while (1)
     {
@@ -250,25 +493,518 @@ _bip85_hd_seed_wif_command(int argc, char **argv)
       static struct option long_options[] = {
         {"help",  no_argument, 0, 'h' },
         {"index",  required_argument, 0, 'i' },
+        {"threads",  required_argument, 0, 't' },
         {0, 0, 0, 0}
       };
 
-      c = getopt_long(argc, argv, "hi:", long_options, &option_index);
+      c = getopt_long(argc, argv, "hi:t:", long_options, &option_index);
       if (c == -1)
         break;
 
-      switch (c) {
+      switch (_bip85_parse_range_option("bip85.hd_seed_wif", c, &first, &last, &threads)) {
       case 'h':
         _bip85_hd_seed_wif_command_usage();
         return EXIT_FAILURE;
 
+      case -1:
+        return EXIT_FAILURE;
+      }
+    }
+
+  return _bip85_hd_seed_wif(first, last, _bip85_threads(threads));
+}
+
+static int
+_bip85_xprv_line(const bip85_t *bip85, const void *arg, uint32_t index, char *line)
+{
+  bip32_key_t child;
+  size_t size = BIP85_LINE_MAX;
+  int res;
+
+  (void)arg;
+  res = bip85_xprv_from_index(bip85, index, &child) == 0
+    && bip32_key_serialize(&child, true, (uint8_t *)line, &size) == 0 ? (int)strlen(line) : -1;
+
+  utils_wipe(&child, sizeof(child));
+  return res;
+}
+
+static int
+_bip85_hex_line(const bip85_t *bip85, const void *arg, uint32_t index, char *line)
+{
+  uint8_t entropy[64];
+  int res;
+
+  (void)arg;
+  res = bip85_hex_from_index(bip85, index, entropy) == 0
+    && utils_to_hex_string(entropy, bip85->length, line) == 0 ? (int)(2 * bip85->length) : -1;
+
+  utils_wipe(entropy, sizeof(entropy));
+  return res;
+}
+
+/** child master xprv, account xpub and first receive address of a child wallet */
+static int
+_bip85_provision_line(const bip85_t *bip85, const void *arg, uint32_t index, char *line)
+{
+  const _bip85_provision_t *provision = arg;
+  bip32_key_t child, purpose, coin_key, account, account_public, chain, receive;
+  size_t size = BIP85_LINE_MAX, length;
+  int res = -1;
+
+  if (bip85_xprv_from_index(bip85, index, &child) != 0
+      || bip32_key_serialize(&child, true, (uint8_t *)line, &size) != 0)
+    goto out;
+
+  length = strlen(line);
+  line[length++] = ' ';
+  size = BIP85_LINE_MAX - length;
+
+  // m/purpose'/coin'/account' of the child wallet and its receive address m/.../0/0
+  if (bip32_key_derive_child_key(&child, 0x80000000 + address_type_purpose(provision->type), &purpose) != 0
+      || bip44_create_coin(&purpose, provision->coin, &coin_key) != 0
+      || bip44_create_account_from_coin(&coin_key, provision->account_nr, &account) != 0
+      || bip32_key_init_public_from_private_key(&account_public, &account) != 0
+      || bip32_key_serialize(&account_public, true, (uint8_t *)line + length, &size) != 0)
+    goto out;
+
+  length += strlen(line + length);
+  line[length++] = ' ';
+  size = BIP85_LINE_MAX - length;
+
+  // public parents can not derive children, the receive address comes from the account key
+  if (bip32_key_derive_child_key(&account, 0, &chain) != 0
+      || bip32_key_derive_child_key(&chain, 0, &receive) != 0
+      || address_from_key(&receive, provision->coin, provision->type, line + length, &size) != 0)
+    goto out;
+
+  res = (int)(length + strlen(line + length));
+
+ out:
+  utils_wipe(&child, sizeof(child));
+  utils_wipe(&purpose, sizeof(purpose));
+  utils_wipe(&coin_key, sizeof(coin_key));
+  utils_wipe(&account, sizeof(account));
+  utils_wipe(&chain, sizeof(chain));
+  utils_wipe(&receive, sizeof(receive));
+  return res;
+}
+
+static int
+_bip85_xprv(uint32_t first, uint32_t last, size_t threads)
+{
+  bip32_key_t key;
+  bip85_t bip85;
+  int res = EXIT_FAILURE;
+
+  if (_bip85_read_private_key_from_stdin(&key) != 0)
+    return EXIT_FAILURE;
+
+  if (bip85_xprv_init(&bip85, &key) != 0) {
+    fputs("bip85.xprv: failed to derive application key\n", stderr);
+    goto out;
+  }
+
+  if (_bip85_indices("bip85.xprv", &bip85, _bip85_xprv_line, NULL, first, last, threads) != 0)
+    goto out;
+
+  res = EXIT_SUCCESS;
+
+ out:
+  utils_wipe(&key, sizeof(key));
+  bip85_clear(&bip85);
+  return res;
+}
+
+static int
+_bip85_hex(uint32_t byte_cnt, uint32_t first, uint32_t last, size_t threads)
+{
+  bip32_key_t key;
+  bip85_t bip85;
+  int res = EXIT_FAILURE;
+
+  if (_bip85_read_private_key_from_stdin(&key) != 0)
+    return EXIT_FAILURE;
+
+  if (bip85_hex_init(&bip85, &key, byte_cnt) != 0) {
+    fputs("bip85.hex: failed to derive application key, bytes should be 16 to 64\n", stderr);
+    goto out;
+  }
+
+  if (_bip85_indices("bip85.hex", &bip85, _bip85_hex_line, NULL, first, last, threads) != 0)
+    goto out;
+
+  res = EXIT_SUCCESS;
+
+ out:
+  utils_wipe(&key, sizeof(key));
+  bip85_clear(&bip85);
+  return res;
+}
+
+/**
+ * Derive the xprv application node once, then the child wallets of a
+ * range of indices with their account xpub and first address in blocks
+ * on worker threads.
+ */
+static int
+_bip85_provision(const char *coin_symbol, address_type_t type, uint32_t account_nr,
+                 uint32_t first, uint32_t last, size_t threads)
+{
+  bip32_key_t key;
+  bip85_t bip85;
+  int res = EXIT_FAILURE;
+  _bip85_provision_t provision = {
+    .coin = bip44_coin_by_symbol(coin_symbol),
+    .type = type,
+    .account_nr = account_nr,
+  };
+
+  if (provision.coin == NULL) {
+    fprintf(stderr, "bip85.provision: symbol '%s' not found in coin table\n", coin_symbol);
+    return EXIT_FAILURE;
+  }
+
+  if (!bip44_coin_has_addresses(provision.coin)) {
+    fprintf(stderr, "bip85.provision: coin '%s' has no known address parameters\n", provision.coin->symbol);
+    return EXIT_FAILURE;
+  }
+
+  if (type != ADDRESS_P2PKH && provision.coin->hrp == NULL) {
+    fprintf(stderr, "bip85.provision: coin '%s' has no segwit addresses\n", provision.coin->symbol);
+    return EXIT_FAILURE;
+  }
+
+  if (_bip85_read_private_key_from_stdin(&key) != 0)
+    return EXIT_FAILURE;
+
+  if (bip85_xprv_init(&bip85, &key) != 0) {
+    fputs("bip85.provision: failed to derive application key\n", stderr);
+    goto out;
+  }
+
+  if (_bip85_indices("bip85.provision", &bip85, _bip85_provision_line, &provision,
+                     first, last, threads) != 0)
+    goto out;
+
+  res = EXIT_SUCCESS;
+
+ out:
+  utils_wipe(&key, sizeof(key));
+  bip85_clear(&bip85);
+  return res;
+}
+
+static void
+_bip85_xprv_command_usage(void)
+{
+  fputs("usage: btct bip85.xprv <args>\n", stderr);
+  fputs("\n", stderr);
+  fputs("Generates the master key of a child wallet from deterministic entropy.\n", stderr);
+  fputs("\n", stderr);
+  fputs("  -i, --index <index>    Specify the index or range of indices as first-last, default\n", stderr);
+  fputs("                         is 0. For a range each line starts with the index.\n", stderr);
+  fputs("  -t, --threads <count>  Number of worker threads, default is one per online cpu.\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Generate the child wallet master key of index 0\n", stderr);
+  fputs("\n", stderr);
+  fputs("      echo 'legal winner thank year wave sausage worth useful legal winner thank yellow' \\\n",stderr);
+  fputs("          | btct bip39.seed --passphrase=TREZOR \\\n", stderr);
+  fputs("          | btct bip32.masterkey\\\n", stderr);
+  fputs("          | btct bip85.xprv --index=0\n", stderr);
+  fputs("\n", stderr);
+}
+
+static int
+_bip85_xprv_command(int argc, char **argv)
+{
+  int c;
+  uint32_t first = 0, last = 0;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+  while (1)
+    {
+      int option_index = 0;
+      static struct option long_options[] = {
+        {"help",  no_argument, 0, 'h' },
+        {"index",  required_argument, 0, 'i' },
+        {"threads",  required_argument, 0, 't' },
+        {0, 0, 0, 0}
+      };
+
+      c = getopt_long(argc, argv, "hi:t:", long_options, &option_index);
+      if (c == -1)
+        break;
+
+      switch (_bip85_parse_range_option("bip85.xprv", c, &first, &last, &threads)) {
+      case 'h':
+        _bip85_xprv_command_usage();
+        return EXIT_FAILURE;
+
+      case -1:
+        return EXIT_FAILURE;
+      }
+    }
+
+  return _bip85_xprv(first, last, _bip85_threads(threads));
+}
+
+static void
+_bip85_hex_command_usage(void)
+{
+  fputs("usage: btct bip85.hex <args>\n", stderr);
+  fputs("\n", stderr);
+  fputs("Generates hex encoded deterministic entropy.\n", stderr);
+  fputs("\n", stderr);
+  fputs("  -b, --bytes <count>    Specify the number of bytes, 16 to 64, default is 64.\n", stderr);
+  fputs("  -i, --index <index>    Specify the index or range of indices as first-last, default\n", stderr);
+  fputs("                         is 0. For a range each line starts with the index.\n", stderr);
+  fputs("  -t, --threads <count>  Number of worker threads, default is one per online cpu.\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Generate 32 bytes of entropy of index 3\n", stderr);
+  fputs("\n", stderr);
+  fputs("      echo 'legal winner thank year wave sausage worth useful legal winner thank yellow' \\\n",stderr);
+  fputs("          | btct bip39.seed --passphrase=TREZOR \\\n", stderr);
+  fputs("          | btct bip32.masterkey\\\n", stderr);
+  fputs("          | btct bip85.hex --bytes=32 --index=3\n", stderr);
+  fputs("\n", stderr);
+}
+
+static int
+_bip85_hex_command(int argc, char **argv)
+{
+  int c;
+  uint32_t byte_cnt = 64, first = 0, last = 0;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+  while (1)
+    {
+      int option_index = 0;
+      static struct option long_options[] = {
+        {"help",  no_argument, 0, 'h' },
+        {"bytes",  required_argument, 0, 'b' },
+        {"index",  required_argument, 0, 'i' },
+        {"threads",  required_argument, 0, 't' },
+        {0, 0, 0, 0}
+      };
+
+      c = getopt_long(argc, argv, "hb:i:t:", long_options, &option_index);
+      if (c == -1)
+        break;
+
+      switch (_bip85_parse_range_option("bip85.hex", c, &first, &last, &threads)) {
+      case 'h':
+        _bip85_hex_command_usage();
+        return EXIT_FAILURE;
+
+      case 'b':
+        byte_cnt = atoi(optarg);
+        break;
+
+      case -1:
+        return EXIT_FAILURE;
+      }
+    }
+
+  return _bip85_hex(byte_cnt, first, last, _bip85_threads(threads));
+}
+
+static void
+_bip85_provision_command_usage(void)
+{
+  fputs("usage: btct bip85.provision <args>\n", stderr);
+  fputs("\n", stderr);
+  fputs("Generates child wallets, for each index a line with the child master xprv, its account\n", stderr);
+  fputs("xpub and its first receive address.\n", stderr);
+  fputs("\n", stderr);
+  fputs("  -c, --coin <symbol>      Specify coin symbol for specific coin type, default is 'BTC'.\n", stderr);
+  fputs("  -f, --format <type>      Address type p2pkh (bip44), p2sh-p2wpkh (bip49), p2wpkh\n", stderr);
+  fputs("                           (bip84) or p2tr (bip86), default is p2wpkh. The purpose\n", stderr);
+  fputs("                           of the account path follows the address type.\n", stderr);
+  fputs("  -a, --account <number>   Account number, default is account #0.\n", stderr);
+  fputs("  -i, --index <index>      Index or range of indices as first-last of the child\n", stderr);
+  fputs("                           wallets, default is 0-9.\n", stderr);
+  fputs("  -t, --threads <count>    Number of worker threads, default is one per online cpu.\n", stderr);
+  fputs("\n", stderr);
+  fputs("  For a range each line starts with the index, blocks of lines are written in no\n", stderr);
+  fputs("  particular order.\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Provision 10000 native segwit child wallets\n", stderr);
+  fputs("\n", stderr);
+  fputs("      echo 'legal winner thank year wave sausage worth useful legal winner thank yellow' \\\n",stderr);
+  fputs("          | btct bip39.seed --passphrase=TREZOR \\\n", stderr);
+  fputs("          | btct bip32.masterkey\\\n", stderr);
+  fputs("          | btct bip85.provision --index=0-9999\n", stderr);
+  fputs("\n", stderr);
+}
+
+static int
+_bip85_provision_command(int argc, char **argv)
+{
+  int c;
+  char *coin_symbol = "BTC";
+  address_type_t type = ADDRESS_P2WPKH;
+  uint32_t account_nr = 0, first = 0, last = 9, unused;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+  while (1)
+    {
+      int option_index = 0;
+      static struct option long_options[] = {
+        {"help",  no_argument, 0, 'h' },
+        {"coin",  required_argument, 0, 'c' },
+        {"format",  required_argument, 0, 'f' },
+        {"account",  required_argument, 0, 'a' },
+        {"index",  required_argument, 0, 'i' },
+        {"threads",  required_argument, 0, 't' },
+        {0, 0, 0, 0}
+      };
+
+      c = getopt_long(argc, argv, "hc:f:a:i:t:", long_options, &option_index);
+      if (c == -1)
+        break;
+
+      switch (_bip85_parse_range_option("bip85.provision", c, &first, &last, &threads)) {
+      case 'h':
+        _bip85_provision_command_usage();
+        return EXIT_FAILURE;
+
+      case 'c':
+        coin_symbol = optarg;
+        break;
+
+      case 'f':
+        if (address_type_from_name(optarg, &type) != 0) {
+          fprintf(stderr, "bip85.provision: unknown address type '%s'\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'a':
+        if (utils_parse_range(optarg, &account_nr, &unused) != 0 || unused != account_nr
+            || account_nr >= 0x80000000)
+        {
+          fprintf(stderr, "bip85.provision: invalid account '%s'\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case -1:
+        return EXIT_FAILURE;
+      }
+    }
+
+  return _bip85_provision(coin_symbol, type, account_nr, first, last, _bip85_threads(threads));
+}
+
+/** write size bytes of the drng of index in blocks of BIP85_DRNG_BLOCK */
+static int
+_bip85_drng(uint32_t index, unsigned long long size)
+{
+  static uint8_t block[BIP85_DRNG_BLOCK];
+  bip32_key_t key;
+  bip85_drng_t drng;
+  int res = EXIT_FAILURE;
+
+  if (_bip85_read_private_key_from_stdin(&key) != 0)
+    return EXIT_FAILURE;
+
+  if (bip85_drng_init(&drng, &key, index) != 0) {
+    fputs("bip85.drng: failed to derive application key\n", stderr);
+    goto out;
+  }
+
+  freopen(NULL, "wb", stdout);
+  while (size > 0) {
+    size_t length = size < sizeof(block) ? size : sizeof(block);
+
+    bip85_drng_read(&drng, block, length);
+    if (fwrite(block, 1, length, stdout) != length) {
+      fputs("bip85.drng: failed to write entropy\n", stderr);
+      goto out;
+    }
+    size -= length;
+  }
+
+  if (fflush(stdout) != 0) {
+    fputs("bip85.drng: failed to write entropy\n", stderr);
+    goto out;
+  }
+
+  res = EXIT_SUCCESS;
+
+ out:
+  utils_wipe(&key, sizeof(key));
+  utils_wipe(block, sizeof(block));
+  bip85_drng_clear(&drng);
+  return res;
+}
+
+static void
+_bip85_drng_command_usage(void)
+{
+  fputs("usage: btct bip85.drng <args>\n", stderr);
+  fputs("\n", stderr);
+  fputs("Writes a stream of deterministic random bytes, SHAKE256 seeded with derived entropy.\n", stderr);
+  fputs("\n", stderr);
+  fputs("  -i, --index <index>    Specify the index of the generator, default is 0.\n", stderr);
+  fputs("  -b, --bytes <size>     Specify the number of bytes to write, default is 64.\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Seed a test fixture with 1 MiB of deterministic entropy of index 4\n", stderr);
+  fputs("\n", stderr);
+  fputs("      echo 'legal winner thank year wave sausage worth useful legal winner thank yellow' \\\n",stderr);
+  fputs("          | btct bip39.seed --passphrase=TREZOR \\\n", stderr);
+  fputs("          | btct bip32.masterkey\\\n", stderr);
+  fputs("          | btct bip85.drng --index=4 --bytes=1048576 > fixture.bin\n", stderr);
+  fputs("\n", stderr);
+}
+
+static int
+_bip85_drng_command(int argc, char **argv)
+{
+  int c;
+  uint32_t index = 0, unused;
+  unsigned long long size = 64;
+  char *end;
+
+  while (1)
+    {
+      int option_index = 0;
+      static struct option long_options[] = {
+        {"help",  no_argument, 0, 'h' },
+        {"index",  required_argument, 0, 'i' },
+        {"bytes",  required_argument, 0, 'b' },
+        {0, 0, 0, 0}
+      };
+
+      c = getopt_long(argc, argv, "hi:b:", long_options, &option_index);
+      if (c == -1)
+        break;
+
+      switch (c) {
+      case 'h':
+        _bip85_drng_command_usage();
+        return EXIT_FAILURE;
+
       case 'i':
-        index = atoi(optarg);
+        if (utils_parse_range(optarg, &index, &unused) != 0 || unused != index || index >= 0x80000000) {
+          fprintf(stderr, "bip85.drng: invalid index '%s'\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'b':
+        errno = 0;
+        size = strtoull(optarg, &end, 10);
+        if (errno != 0 || end == optarg || *end != '\0' || optarg[0] == '-') {
+          fprintf(stderr, "bip85.drng: invalid size '%s'\n", optarg);
+          return EXIT_FAILURE;
+        }
         break;
       }
     }
 
-  return _bip85_hd_seed_wif(index);
+  return _bip85_drng(index, size);
 }
 
 static void _bip85_command_usage(void)
@@ -277,7 +1013,11 @@ static void _bip85_command_usage(void)
   fputs("\n", stderr);
   fputs("  bip39           Derive a deterministic mneonmic seed phrase.\n", stderr);
   fputs("  hd_seed_wif     Derive a HD Seed for Bitcoin Core wallets.\n", stderr);
+  fputs("  xprv            Derive the master key of a child wallet.\n", stderr);
+  fputs("  hex             Derive hex encoded entropy.\n", stderr);
   fputs("  pwd_base85      Derive a deterministic password.\n", stderr);
+  fputs("  provision       Derive child wallets with their account xpub and first address.\n", stderr);
+  fputs("  drng            Write a stream of deterministic random bytes.\n", stderr);
   fputs("\n",stderr);
   fputs("examples:\n", stderr);
   fputs("\n",stderr);
@@ -298,6 +1038,10 @@ int bip85_command(int argc, char **argv)
     { "bip85.bip39", _bip85_bip39_command },
     { "bip85.pwd_base85", _bip85_pwd_base85_command },
     { "bip85.hd_seed_wif", _bip85_hd_seed_wif_command },
+    { "bip85.xprv", _bip85_xprv_command },
+    { "bip85.hex", _bip85_hex_command },
+    { "bip85.provision", _bip85_provision_command },
+    { "bip85.drng", _bip85_drng_command },
     { NULL, NULL, }
   };
 
@@ -4,6 +4,7 @@
 #include <string.h>
 
 #include "command.h"
+#include "stats.h"
 
 extern int (store_command)(int,char**);
 extern int (bip32_command)(int,char**);
@@ -11,6 +12,7 @@ extern int (bip39_command)(int,char**);
 extern int (bip44_command)(int,char**);
 extern int (bip85_command)(int,char**);
 extern int (sss_command)(int,char**);
+extern int (wallet_command)(int,char**);
 
 static command_t commands[] = {
     { "store", store_command },
@@ -19,12 +21,13 @@ static command_t commands[] = {
     { "bip44", bip44_command },
     { "bip85", bip85_command },
     { "sss", sss_command },
+    { "wallet", wallet_command },
     { NULL, NULL, }
 };
 
 static void usage(void)
 {
-    fputs("usage: btct [-v | --version] [-h | --help]\n", stderr);
+    fputs("usage: btct [-v | --version] [-h | --help] [-s | --stats]\n", stderr);
     fputs("               <module>[.<command>] [<args>]\n", stderr);
     fputs("\n", stderr);
     fputs("These are the BiTCoin Tools (btct) modules used for various operation:\n", stderr);
@@ -43,6 +46,10 @@ static void usage(void)
           "               most often to secure encryption keys. The secret is split into multiple\n"
           "               shares, which individually do not give any information about the secret.", stderr);
     fputs("\n\n", stderr);
+    fputs("  wallet       Bulk provisioning of random wallets\n", stderr);
+    fputs("\n", stderr);
+    fputs("  -s, --stats  Print operation counts and time spent per stage to stderr at exit.\n", stderr);
+    fputs("\n", stderr);
     fputs("To get more information of each module, name the module and add the --help argument to the btct\n"
           "commandline, for example if you want to know more about bip32 module run like:\n", stderr);
     fputs("\n", stderr);
@@ -55,6 +62,23 @@ static void version(void)
     fputs("bct v1.0.0\n", stderr);
 }
 
+#ifdef BTCT_STATS
+static void _stats_report(void)
+{
+    stats_report(stderr);
+}
+#endif
+
+static void stats(void)
+{
+#ifdef BTCT_STATS
+    stats_enable();
+    atexit(_stats_report);
+#else
+    fputs("btct: built without statistics support, --stats is ignored\n", stderr);
+#endif
+}
+
 int
 main(int argc, char **argv)
 {
@@ -79,10 +103,11 @@ main(int argc, char **argv)
         static struct option long_options[] = {
             {"help",  no_argument, 0, 'h' },
             {"version", no_argument, 0, 'v'},
+            {"stats", no_argument, 0, 's'},
             {0, 0, 0, 0}
         };
 
-        c = getopt_long(argc_command, argv, "hv", long_options, &option_index);
+        c = getopt_long(argc_command, argv, "hvs", long_options, &option_index);
         if (c == -1)
             break;
 
@@ -93,6 +118,9 @@ main(int argc, char **argv)
             case 'v':
                 version();
                 return EXIT_FAILURE;
+            case 's':
+                stats();
+                break;
         }
     }
 
@@ -106,6 +134,9 @@ main(int argc, char **argv)
     argv += argc_command;
     *argv = command;
 
+    // let the command parse its own arguments from the start
+    optind = 0;
+
     int res = command_dispatch(commands, command, true, argc, argv);
     if (res == -1)
         usage();
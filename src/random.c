@@ -0,0 +1,210 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/random.h>
+#include <nettle/sha2.h>
+
+#include "random.h"
+#include "utils.h"
+
+typedef struct _random_thread_state_t {
+  random_drbg_t drbg;
+  uint64_t fork_generation;
+} _random_thread_state_t;
+
+static pthread_once_t _random_once = PTHREAD_ONCE_INIT;
+static pthread_key_t _random_key;
+static _Atomic uint64_t _fork_generation = 0;
+
+static void
+_refill(random_drbg_t *ctx)
+{
+  struct chacha_ctx chacha;
+  uint8_t nonce[CHACHA_NONCE_SIZE] = {0};
+
+  memset(ctx->buffer, 0, sizeof(ctx->buffer));
+  chacha_set_key(&chacha, ctx->key);
+  chacha_set_nonce(&chacha, nonce);
+  chacha_crypt(&chacha, sizeof(ctx->buffer), ctx->buffer, ctx->buffer);
+  utils_wipe(&chacha, sizeof(chacha));
+
+  // fast key erasure, replace key before any output is served
+  memcpy(ctx->key, ctx->buffer, sizeof(ctx->key));
+  utils_wipe(ctx->buffer, sizeof(ctx->key));
+  ctx->available = sizeof(ctx->buffer) - sizeof(ctx->key);
+}
+
+int
+random_drbg_init(random_drbg_t *ctx, const uint8_t seed[CHACHA_KEY_SIZE])
+{
+  memset(ctx, 0, sizeof(random_drbg_t));
+  memcpy(ctx->key, seed, sizeof(ctx->key));
+  return 0;
+}
+
+int
+random_drbg_reseed(random_drbg_t *ctx, const uint8_t *seed, size_t size)
+{
+  struct sha256_ctx sha256;
+
+  sha256_init(&sha256);
+  sha256_update(&sha256, sizeof(ctx->key), ctx->key);
+  sha256_update(&sha256, size, seed);
+  sha256_digest(&sha256, sizeof(ctx->key), ctx->key);
+
+  utils_wipe(ctx->buffer, sizeof(ctx->buffer));
+  ctx->available = 0;
+  ctx->generated = 0;
+  return 0;
+}
+
+int
+random_drbg_generate(random_drbg_t *ctx, uint8_t *out, size_t size)
+{
+  while (size > 0) {
+    if (ctx->available == 0)
+      _refill(ctx);
+
+    size_t n = size < ctx->available ? size : ctx->available;
+    uint8_t *p = ctx->buffer + sizeof(ctx->buffer) - ctx->available;
+
+    memcpy(out, p, n);
+    utils_wipe(p, n);
+
+    ctx->available -= n;
+    ctx->generated += n;
+    out += n;
+    size -= n;
+  }
+
+  return 0;
+}
+
+void
+random_drbg_clear(random_drbg_t *ctx)
+{
+  utils_wipe(ctx, sizeof(random_drbg_t));
+}
+
+int
+random_seed(uint8_t *out, size_t size)
+{
+  while (size > 0) {
+    ssize_t res = getrandom(out, size, 0);
+    if (res < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == ENOSYS)
+        break;
+      return -1;
+    }
+    out += res;
+    size -= res;
+  }
+
+  if (size == 0)
+    return 0;
+
+  // kernels older than 3.17 lacks getrandom()
+  int h = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+  if (h == -1)
+    return -2;
+
+  while (size > 0) {
+    ssize_t res = read(h, out, size);
+    if (res < 0 && errno == EINTR)
+      continue;
+    if (res <= 0) {
+      close(h);
+      return -3;
+    }
+    out += res;
+    size -= res;
+  }
+
+  close(h);
+  return 0;
+}
+
+static void
+_random_fork_child(void)
+{
+  atomic_fetch_add_explicit(&_fork_generation, 1, memory_order_relaxed);
+}
+
+static void
+_random_thread_state_free(void *data)
+{
+  utils_wipe(data, sizeof(_random_thread_state_t));
+  free(data);
+}
+
+static void
+_random_init_once(void)
+{
+  pthread_key_create(&_random_key, _random_thread_state_free);
+  pthread_atfork(NULL, NULL, _random_fork_child);
+}
+
+static int
+_random_thread_state_reseed(_random_thread_state_t *state)
+{
+  uint8_t seed[CHACHA_KEY_SIZE];
+
+  if (random_seed(seed, sizeof(seed)) != 0)
+    return -1;
+
+  random_drbg_reseed(&state->drbg, seed, sizeof(seed));
+  utils_wipe(seed, sizeof(seed));
+
+  state->fork_generation = atomic_load_explicit(&_fork_generation, memory_order_relaxed);
+  return 0;
+}
+
+int
+random_fill(uint8_t *out, size_t size)
+{
+  _random_thread_state_t *state;
+
+  pthread_once(&_random_once, _random_init_once);
+
+  state = pthread_getspecific(_random_key);
+  if (state == NULL) {
+    state = calloc(1, sizeof(_random_thread_state_t));
+    if (state == NULL)
+      return -1;
+
+    if (_random_thread_state_reseed(state) != 0) {
+      free(state);
+      return -2;
+    }
+    pthread_setspecific(_random_key, state);
+  }
+
+  // serve large requests in chunks so no key outlives the reseed budget
+  while (size > 0) {
+    size_t n;
+
+    // never continue the parents stream in a forked child
+    if (state->fork_generation != atomic_load_explicit(&_fork_generation, memory_order_relaxed)
+        || state->drbg.generated >= RANDOM_RESEED_BYTES)
+    {
+      if (_random_thread_state_reseed(state) != 0)
+        return -3;
+    }
+
+    n = RANDOM_RESEED_BYTES - state->drbg.generated;
+    if (n > size)
+      n = size;
+
+    random_drbg_generate(&state->drbg, out, n);
+    out += n;
+    size -= n;
+  }
+
+  return 0;
+}
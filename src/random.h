@@ -0,0 +1,41 @@
+#ifndef __random_h
+#define __random_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <nettle/chacha.h>
+
+/** keystream generated per refill, the first 32 bytes become the next key */
+#define RANDOM_BUFFER_SIZE (16 * CHACHA_BLOCK_SIZE)
+/** per-thread generators reseed from the kernel after this many bytes */
+#define RANDOM_RESEED_BYTES (1024 * 1024)
+
+/**
+ * ChaCha20 based deterministic random bit generator using fast key
+ * erasure, each refill of the buffer replaces the key with the first 32
+ * bytes of keystream and served bytes are wiped from the buffer.
+ */
+typedef struct random_drbg_t {
+  uint8_t key[CHACHA_KEY_SIZE];
+  uint8_t buffer[RANDOM_BUFFER_SIZE];
+  size_t available;
+  uint64_t generated;
+} random_drbg_t;
+
+int random_drbg_init(random_drbg_t *ctx, const uint8_t seed[CHACHA_KEY_SIZE]);
+/** mix additional seed material into the key, discarding buffered output */
+int random_drbg_reseed(random_drbg_t *ctx, const uint8_t *seed, size_t size);
+int random_drbg_generate(random_drbg_t *ctx, uint8_t *out, size_t size);
+void random_drbg_clear(random_drbg_t *ctx);
+
+/** read seed material from the kernel using getrandom() */
+int random_seed(uint8_t *out, size_t size);
+
+/**
+ * Fill buffer with random bytes from a per-thread generator seeded by
+ * the kernel. The generator is reseeded after RANDOM_RESEED_BYTES, also
+ * within a single large request, and in the child after fork().
+ */
+int random_fill(uint8_t *out, size_t size);
+
+#endif
@@ -0,0 +1,356 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <nettle/memops.h>
+#include <nettle/sha2.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#define SHAMIR_X86 1
+#endif
+
+#include "shamir.h"
+#include "random.h"
+#include "utils.h"
+
+/** bytes of each polynomial coefficient generated at once, bounds memory use */
+#define SHAMIR_BLOCK_SIZE 4096
+
+/** y[i] = c * a[i] ^ b[i], y may be a or b */
+typedef void (*_mul_add_fn_t)(uint8_t *y, const uint8_t *a, const uint8_t *b, size_t size,
+                              uint8_t c);
+
+static pthread_once_t _shamir_once = PTHREAD_ONCE_INIT;
+static uint8_t _gf_exp[510];
+static uint8_t _gf_log[256];
+static _mul_add_fn_t _mul_add;
+
+static inline uint8_t
+_gf_mul(uint8_t a, uint8_t b)
+{
+  if (a == 0 || b == 0)
+    return 0;
+  return _gf_exp[_gf_log[a] + _gf_log[b]];
+}
+
+static inline uint8_t
+_gf_div(uint8_t a, uint8_t b)
+{
+  if (a == 0)
+    return 0;
+  return _gf_exp[_gf_log[a] + 255 - _gf_log[b]];
+}
+
+static void
+_mul_add_scalar(uint8_t *y, const uint8_t *a, const uint8_t *b, size_t size, uint8_t c)
+{
+  uint8_t product[256];
+
+  // building the product table only pays off for longer vectors
+  if (size < sizeof(product)) {
+    for (size_t i = 0; i < size; i++)
+      y[i] = _gf_mul(c, a[i]) ^ b[i];
+    return;
+  }
+
+  for (int i = 0; i < 256; i++)
+    product[i] = _gf_mul(c, i);
+
+  for (size_t i = 0; i < size; i++)
+    y[i] = product[a[i]] ^ b[i];
+}
+
+#ifdef SHAMIR_X86
+/**
+ * Products of the low and high nibble with c are looked up sixteen at a
+ * time with PSHUFB, the product of the byte is their sum.
+ */
+__attribute__((target("ssse3")))
+static void
+_mul_add_ssse3(uint8_t *y, const uint8_t *a, const uint8_t *b, size_t size, uint8_t c)
+{
+  uint8_t low[16], high[16];
+  size_t i = 0;
+
+  for (int n = 0; n < 16; n++) {
+    low[n] = _gf_mul(c, n);
+    high[n] = _gf_mul(c, n << 4);
+  }
+
+  __m128i tlow = _mm_loadu_si128((const __m128i *)low);
+  __m128i thigh = _mm_loadu_si128((const __m128i *)high);
+  __m128i mask = _mm_set1_epi8(0x0f);
+
+  for (; i + 16 <= size; i += 16) {
+    __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+    __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+    __m128i pl = _mm_shuffle_epi8(tlow, _mm_and_si128(va, mask));
+    __m128i ph = _mm_shuffle_epi8(thigh, _mm_and_si128(_mm_srli_epi64(va, 4), mask));
+    _mm_storeu_si128((__m128i *)(y + i), _mm_xor_si128(_mm_xor_si128(pl, ph), vb));
+  }
+
+  for (; i < size; i++)
+    y[i] = (low[a[i] & 0x0f] ^ high[a[i] >> 4]) ^ b[i];
+}
+#endif
+
+static void
+_shamir_init_once(void)
+{
+  uint8_t x = 1;
+
+  // 3 generates the multiplicative group of GF(2^8) mod x^8 + x^4 + x^3 + x + 1
+  for (int i = 0; i < 255; i++) {
+    _gf_exp[i] = _gf_exp[i + 255] = x;
+    _gf_log[x] = i;
+    x ^= (x << 1) ^ ((x & 0x80) ? 0x1b : 0);
+  }
+
+  _mul_add = _mul_add_scalar;
+#ifdef SHAMIR_X86
+  if (__builtin_cpu_supports("ssse3"))
+    _mul_add = _mul_add_ssse3;
+#endif
+}
+
+int
+shamir_use_simd(bool enable)
+{
+  pthread_once(&_shamir_once, _shamir_init_once);
+
+  if (!enable) {
+    _mul_add = _mul_add_scalar;
+    return 0;
+  }
+
+#ifdef SHAMIR_X86
+  if (__builtin_cpu_supports("ssse3")) {
+    _mul_add = _mul_add_ssse3;
+    return 0;
+  }
+#endif
+  return -1;
+}
+
+int
+shamir_split(const uint8_t *secret, size_t size, uint8_t share_cnt, uint8_t threshold,
+             uint8_t *shares)
+{
+  size_t coefficients_size;
+  uint8_t *coefficients;
+  int res = 0;
+
+  if (share_cnt == 0 || threshold == 0 || threshold > share_cnt)
+    return -1;
+
+  pthread_once(&_shamir_once, _shamir_init_once);
+
+  coefficients_size = (size_t)(threshold - 1) * SHAMIR_BLOCK_SIZE;
+  coefficients = malloc(coefficients_size ? coefficients_size : 1);
+  if (coefficients == NULL)
+    return -2;
+
+  for (size_t offset = 0; offset < size; offset += SHAMIR_BLOCK_SIZE) {
+    size_t length = size - offset < SHAMIR_BLOCK_SIZE ? size - offset : SHAMIR_BLOCK_SIZE;
+
+    // coefficient j of the block at coefficients + j * length, j = 1..threshold-1
+    if (random_fill(coefficients, (size_t)(threshold - 1) * length) != 0) {
+      res = -3;
+      break;
+    }
+
+    for (int s = 0; s < share_cnt; s++) {
+      uint8_t *y = shares + (size_t)s * size + offset;
+      uint8_t x = s + 1;
+
+      if (threshold == 1) {
+        memcpy(y, secret + offset, length);
+        continue;
+      }
+
+      // horner, starting from the highest coefficient
+      memcpy(y, coefficients + (size_t)(threshold - 2) * length, length);
+      for (int j = threshold - 3; j >= 0; j--)
+        _mul_add(y, y, coefficients + (size_t)j * length, length, x);
+      _mul_add(y, y, secret + offset, length, x);
+    }
+  }
+
+  utils_wipe(coefficients, coefficients_size);
+  free(coefficients);
+  return res;
+}
+
+int
+shamir_combine(const uint8_t *xs, const uint8_t *shares, size_t size, uint8_t share_cnt,
+               uint8_t *secret)
+{
+  if (share_cnt == 0)
+    return -1;
+
+  for (int i = 0; i < share_cnt; i++) {
+    if (xs[i] == 0)
+      return -1;
+    for (int j = 0; j < i; j++) {
+      if (xs[i] == xs[j])
+        return -1;
+    }
+  }
+
+  pthread_once(&_shamir_once, _shamir_init_once);
+
+  memset(secret, 0, size);
+
+  // lagrange interpolation at x = 0
+  for (int i = 0; i < share_cnt; i++) {
+    uint8_t numerator = 1, denominator = 1;
+
+    for (int j = 0; j < share_cnt; j++) {
+      if (j == i)
+        continue;
+      numerator = _gf_mul(numerator, xs[j]);
+      denominator = _gf_mul(denominator, xs[j] ^ xs[i]);
+    }
+
+    _mul_add(secret, shares + (size_t)i * size, secret, size, _gf_div(numerator, denominator));
+  }
+
+  return 0;
+}
+
+/** tag of a batch secret, binds the threshold its shares claim */
+static void
+_shamir_batch_tag(const uint8_t *secret, size_t size, uint8_t threshold, uint8_t *tag)
+{
+  static const char *domain = "btct shamir batch";
+  struct sha256_ctx sha256;
+  uint8_t digest[SHA256_DIGEST_SIZE];
+
+  sha256_init(&sha256);
+  sha256_update(&sha256, strlen(domain), (const uint8_t *)domain);
+  sha256_update(&sha256, 1, &threshold);
+  sha256_update(&sha256, size, secret);
+  sha256_digest(&sha256, sizeof(digest), digest);
+  memcpy(tag, digest, SHAMIR_BATCH_TAG_SIZE);
+
+  utils_wipe(&sha256, sizeof(sha256));
+  utils_wipe(digest, sizeof(digest));
+}
+
+int
+shamir_batch_split(const uint8_t *secrets, const size_t *offsets, size_t count,
+                   uint8_t share_cnt, uint8_t threshold, uint8_t *shares)
+{
+  size_t total = offsets[count] + count * SHAMIR_BATCH_TAG_SIZE;
+  uint8_t *records, *split;
+  int res = 0;
+
+  if (share_cnt == 0 || threshold == 0 || threshold > share_cnt)
+    return -1;
+
+  records = malloc(total ? total : 1);
+  split = malloc(total ? (size_t)share_cnt * total : 1);
+  if (records == NULL || split == NULL) {
+    res = -2;
+    goto out;
+  }
+
+  // secret i followed by its tag at offsets[i] + i * SHAMIR_BATCH_TAG_SIZE
+  for (size_t i = 0; i < count; i++) {
+    uint8_t *record = records + offsets[i] + i * SHAMIR_BATCH_TAG_SIZE;
+    size_t size = offsets[i + 1] - offsets[i];
+
+    memcpy(record, secrets + offsets[i], size);
+    _shamir_batch_tag(record, size, threshold, record + size);
+  }
+
+  if (shamir_split(records, total, share_cnt, threshold, split) != 0) {
+    res = -3;
+    goto out;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    size_t length = offsets[i + 1] - offsets[i] + SHAMIR_BATCH_TAG_SIZE;
+    uint8_t *share = shares + (offsets[i] + i * SHAMIR_BATCH_OVERHEAD) * share_cnt;
+
+    for (int s = 0; s < share_cnt; s++) {
+      share[0] = s + 1;
+      share[1] = threshold;
+      memcpy(share + 2, split + (size_t)s * total + offsets[i] + i * SHAMIR_BATCH_TAG_SIZE, length);
+      share += 2 + length;
+    }
+  }
+
+ out:
+  if (records != NULL) {
+    utils_wipe(records, total);
+    free(records);
+  }
+  if (split != NULL) {
+    utils_wipe(split, (size_t)share_cnt * total);
+    free(split);
+  }
+  return res;
+}
+
+int
+shamir_batch_combine(const uint8_t *shares, size_t size, uint8_t share_cnt, uint8_t *secret)
+{
+  uint8_t xs[SHAMIR_MAX_SHARES], tag[SHAMIR_BATCH_TAG_SIZE];
+  uint8_t threshold, *ys, *record;
+  size_t length;
+  int res = 0;
+
+  if (share_cnt == 0 || size <= SHAMIR_BATCH_OVERHEAD)
+    return -1;
+
+  // all shares of a secret claim the same threshold
+  threshold = shares[1];
+  for (int i = 0; i < share_cnt; i++) {
+    if (shares[(size_t)i * size + 1] != threshold)
+      return -1;
+  }
+
+  if (threshold == 0)
+    return -1;
+  if (share_cnt < threshold)
+    return -2;
+
+  length = size - 2;
+  ys = malloc((size_t)share_cnt * length);
+  record = malloc(length);
+  if (ys == NULL || record == NULL) {
+    res = -1;
+    goto out;
+  }
+
+  for (int i = 0; i < share_cnt; i++) {
+    xs[i] = shares[(size_t)i * size];
+    memcpy(ys + (size_t)i * length, shares + (size_t)i * size + 2, length);
+  }
+
+  if (shamir_combine(xs, ys, length, share_cnt, record) != 0) {
+    res = -1;
+    goto out;
+  }
+
+  _shamir_batch_tag(record, length - SHAMIR_BATCH_TAG_SIZE, threshold, tag);
+  if (!memeql_sec(tag, record + length - SHAMIR_BATCH_TAG_SIZE, sizeof(tag))) {
+    res = -3;
+    goto out;
+  }
+
+  memcpy(secret, record, length - SHAMIR_BATCH_TAG_SIZE);
+
+ out:
+  if (ys != NULL) {
+    utils_wipe(ys, (size_t)share_cnt * length);
+    free(ys);
+  }
+  if (record != NULL) {
+    utils_wipe(record, length);
+    free(record);
+  }
+  utils_wipe(tag, sizeof(tag));
+  return res;
+}
@@ -0,0 +1,69 @@
+#ifndef __shamir_h
+#define __shamir_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define SHAMIR_MAX_SHARES 255
+
+/**
+ * Shamir secret sharing over GF(2^8) with the AES polynomial, each byte
+ * of the secret is the constant term of its own random polynomial of
+ * degree threshold - 1 and share i holds the polynomials evaluated at
+ * x = i + 1.
+ *
+ * Polynomial evaluation and interpolation multiply whole byte vectors
+ * by a constant, using PSHUFB nibble tables on CPUs with SSSE3 and
+ * 256 byte product tables otherwise.
+ *
+ * Every byte is shared independently, a batch of secrets is split in one
+ * call by passing them concatenated, share i of the secret at offset o
+ * is then found at shares + i * size + o.
+ *
+ * Shares carry no integrity, combining wrong or corrupt shares silently
+ * yields a wrong secret. Batch shares add the threshold and a tag of the
+ * secret that is checked on recovery.
+ */
+
+/**
+ * Split size bytes of secret into share_cnt shares of size bytes each,
+ * share i is written to shares + i * size and evaluated at x = i + 1.
+ */
+int shamir_split(const uint8_t *secret, size_t size, uint8_t share_cnt, uint8_t threshold,
+                 uint8_t *shares);
+/**
+ * Recover size bytes of secret from share_cnt shares, share i at
+ * shares + i * size evaluated at xs[i]. All shares given are used, at
+ * least threshold of them are needed for the right secret.
+ */
+int shamir_combine(const uint8_t *xs, const uint8_t *shares, size_t size, uint8_t share_cnt,
+                   uint8_t *secret);
+
+/** truncated sha256 of a batch secret, split along with it */
+#define SHAMIR_BATCH_TAG_SIZE 16
+/** bytes a batch share holds besides the share of the secret, x-coordinate, threshold and tag */
+#define SHAMIR_BATCH_OVERHEAD (2 + SHAMIR_BATCH_TAG_SIZE)
+
+/**
+ * Split count secrets in one shamir_split call into self-contained batch
+ * shares, secret i is the bytes of secrets from offsets[i] to
+ * offsets[i + 1]. A share holds its x-coordinate, the threshold and the
+ * share of the secret followed by its tag. The share_cnt shares of secret
+ * i follow each other from shares + (offsets[i] + i * SHAMIR_BATCH_OVERHEAD)
+ * * share_cnt, each offsets[i + 1] - offsets[i] + SHAMIR_BATCH_OVERHEAD bytes.
+ */
+int shamir_batch_split(const uint8_t *secrets, const size_t *offsets, size_t count,
+                       uint8_t share_cnt, uint8_t threshold, uint8_t *shares);
+/**
+ * Recover the secret of share_cnt batch shares of size bytes each, share
+ * i at shares + i * size, into size - SHAMIR_BATCH_OVERHEAD bytes of
+ * secret. Returns -2 if fewer shares than their threshold are given and
+ * -3 if the tag does not match, a share is corrupt or of another secret.
+ */
+int shamir_batch_combine(const uint8_t *shares, size_t size, uint8_t share_cnt, uint8_t *secret);
+
+/** select SIMD or scalar vector arithmetic, fails if SIMD is not supported */
+int shamir_use_simd(bool enable);
+
+#endif
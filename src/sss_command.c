@@ -1,14 +1,60 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <ctype.h>
 #include <inttypes.h>
 #include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
 
 #include "command.h"
 #include "bip32.h"
 #include "sss.h"
+#include "sss_stream.h"
+#include "shamir.h"
+#include "utils.h"
 
 #include "../external/libbase58/libbase58.h"
 
+/** secrets split per call in batch mode and the largest secret of a line */
+#define SSS_BATCH_SECRETS 1024
+#define SSS_BATCH_SECRET_SIZE 256
+
+#define SSS_MAX_THREADS 256
+/** subsets tried by --diagnose at most, C(24, 12) fits */
+#define SSS_DIAGNOSE_MAX_SUBSETS (1ull << 24)
+
+typedef struct _sss_diagnose_t {
+  const sss_Share *shares;
+  uint8_t share_cnt;
+  uint8_t threshold;
+  /** binomial[n * (threshold + 1) + k] = C(n, k) */
+  uint64_t *binomial;
+  uint64_t subset_cnt;
+  _Atomic uint64_t next;
+  atomic_int found;
+  uint8_t subset[255];
+  uint8_t secret[sss_MLEN];
+} _sss_diagnose_t;
+
+/** decode length hex digits into out, returns bytes decoded or -1 */
+static int
+_hex_decode(const char *hex, size_t length, uint8_t *out)
+{
+  if (length % 2 != 0)
+    return -1;
+
+  for (size_t i = 0; i < length; i += 2) {
+    if (sscanf(hex + i, "%2hhx", out + i / 2) != 1
+        || !isxdigit((unsigned char)hex[i]) || !isxdigit((unsigned char)hex[i + 1]))
+      return -1;
+  }
+
+  return length / 2;
+}
+
 static int
 _sss_create(uint8_t share_cnt, uint8_t threshold)
 {
@@ -17,36 +63,213 @@ _sss_create(uint8_t share_cnt, uint8_t threshold)
   uint8_t tmp;
   size_t bytes=0;
   uint8_t data[sss_MLEN]={0};
-  sss_Share shares[200];
+  sss_Share *shares;
+
+  if (share_cnt == 0 || threshold == 0 || threshold > share_cnt) {
+    fprintf(stderr, "sss.create: invalid threshold %d of %d shares\n", threshold, share_cnt);
+    return EXIT_FAILURE;
+  }
 
   fprintf(stderr, "sss.create: creating %d share from secret with a recovery threshold of %d\n", share_cnt, threshold);
 
   // Read secret from stdin
   freopen(NULL, "rb", stdin);
   bytes = fread(data, 1, sss_MLEN, stdin);
-  if (bytes == 64 && fread(&tmp, 1, 1, stdin) == 1) {
+  if (bytes == sss_MLEN && fread(&tmp, 1, 1, stdin) == 1) {
     fprintf(stderr, "sss.create: the secret length is more than %ld bytes, aborting...\n", sss_MLEN);
+    utils_wipe(data, sizeof(data));
     return EXIT_FAILURE;
   }
 
   fprintf(stderr, "sss.create: read %ld bytes (%ld bits) of secret from stdin\n", bytes, bytes*8);
 
-  // create shares
-  memset(shares, 0, sizeof(shares));
-  sss_create_shares(shares, data, 200, threshold);
+  // create only the requested shares, evaluated at distinct x = 1..share_cnt
+  shares = calloc(share_cnt, sizeof(sss_Share));
+  if (shares == NULL) {
+    utils_wipe(data, sizeof(data));
+    return EXIT_FAILURE;
+  }
+  sss_create_shares(shares, data, share_cnt, threshold);
+  utils_wipe(data, sizeof(data));
 
   // dump shares to stdout
   fprintf(stderr, "sss.create: dumping %d shares to stdout in base58\n", share_cnt);
 
   for (size_t s=0; s < share_cnt; s++) {
     size = sizeof(buf);
-    b58enc(buf, &size, shares[rand() % 200], sizeof(sss_Share));
+    b58enc(buf, &size, shares[s], sizeof(sss_Share));
     fprintf(stdout, "%s\n", buf);
   }
 
+  utils_wipe(shares, share_cnt * sizeof(sss_Share));
+  utils_wipe(buf, sizeof(buf));
+  free(shares);
   return EXIT_SUCCESS;
 }
 
+static int
+_sss_create_stream(uint8_t share_cnt, uint8_t threshold, const char *output, size_t chunk_size)
+{
+  char filename[2048];
+  FILE *out[255] = { NULL };
+  bool created[255] = { false };
+  int res = EXIT_SUCCESS;
+
+  if (output == NULL) {
+    fputs("sss.create: --stream requires --output <prefix> for the share files\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  if (share_cnt == 0 || threshold == 0 || threshold > share_cnt) {
+    fprintf(stderr, "sss.create: invalid threshold %d of %d shares\n", threshold, share_cnt);
+    return EXIT_FAILURE;
+  }
+
+  for (int s = 0; s < share_cnt; s++) {
+    snprintf(filename, sizeof(filename), "%s.%d", output, s + 1);
+    // never clobber existing share files
+    int fd = open(filename, O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd != -1)
+      created[s] = true;
+    if (fd == -1 || (out[s] = fdopen(fd, "wb")) == NULL) {
+      fprintf(stderr, "sss.create: failed to create share file '%s'\n", filename);
+      if (fd != -1)
+        close(fd);
+      res = EXIT_FAILURE;
+      goto out;
+    }
+  }
+
+  fprintf(stderr, "sss.create: streaming secret from stdin into %d share files %s.1..%d "
+          "with a recovery threshold of %d\n", share_cnt, output, share_cnt, threshold);
+
+  if (sss_stream_create(stdin, out, share_cnt, threshold, chunk_size) != 0) {
+    fputs("sss.create: failed to create share files\n", stderr);
+    res = EXIT_FAILURE;
+  }
+
+ out:
+  for (int s = 0; s < share_cnt; s++) {
+    if (out[s] != NULL && fclose(out[s]) != 0)
+      res = EXIT_FAILURE;
+  }
+
+  // do not leave partial share files behind, only remove the ones created here
+  if (res != EXIT_SUCCESS) {
+    for (int s = 0; s < share_cnt; s++) {
+      if (!created[s])
+        continue;
+      snprintf(filename, sizeof(filename), "%s.%d", output, s + 1);
+      unlink(filename);
+    }
+  }
+
+  return res;
+}
+
+/**
+ * Split each hex secret line of stdin and write a line of base58 batch
+ * shares for it, secrets are read and split SSS_BATCH_SECRETS at a time.
+ */
+static int
+_sss_create_batch(uint8_t share_cnt, uint8_t threshold)
+{
+  char line[SSS_BATCH_SECRET_SIZE * 2 + 2], encoded[(SSS_BATCH_SECRET_SIZE + SHAMIR_BATCH_OVERHEAD) * 2];
+  size_t offsets[SSS_BATCH_SECRETS + 1];
+  size_t lineno = 0, secret_cnt = 0;
+  uint8_t *secrets, *shares;
+  int res = EXIT_SUCCESS;
+  bool done = false;
+
+  if (share_cnt == 0 || threshold == 0 || threshold > share_cnt) {
+    fprintf(stderr, "sss.create: invalid threshold %d of %d shares\n", threshold, share_cnt);
+    return EXIT_FAILURE;
+  }
+
+  secrets = malloc(SSS_BATCH_SECRETS * SSS_BATCH_SECRET_SIZE);
+  shares = malloc((size_t)share_cnt * SSS_BATCH_SECRETS * (SSS_BATCH_SECRET_SIZE + SHAMIR_BATCH_OVERHEAD));
+  if (secrets == NULL || shares == NULL) {
+    res = EXIT_FAILURE;
+    goto out;
+  }
+
+  while (!done && res == EXIT_SUCCESS) {
+    size_t count = 0;
+
+    // concatenated secrets of this batch, secret i at offsets[i]
+    offsets[0] = 0;
+    while (count < SSS_BATCH_SECRETS) {
+      if (fgets(line, sizeof(line), stdin) == NULL) {
+        done = true;
+        break;
+      }
+      lineno++;
+
+      size_t length = strcspn(line, "\r\n");
+      if (line[length] == '\0' && !feof(stdin)) {
+        fprintf(stderr, "sss.create: line %ld: secret is longer than %d bytes\n",
+                lineno, SSS_BATCH_SECRET_SIZE);
+        res = EXIT_FAILURE;
+        break;
+      }
+
+      if (length == 0)
+        continue;
+
+      int bytes = _hex_decode(line, length, secrets + offsets[count]);
+      if (bytes <= 0) {
+        fprintf(stderr, "sss.create: line %ld: secret is not a hex string\n", lineno);
+        res = EXIT_FAILURE;
+        break;
+      }
+
+      offsets[count + 1] = offsets[count] + bytes;
+      count++;
+    }
+
+    if (res != EXIT_SUCCESS || count == 0)
+      break;
+
+    if (shamir_batch_split(secrets, offsets, count, share_cnt, threshold, shares) != 0) {
+      fputs("sss.create: failed to split secrets\n", stderr);
+      res = EXIT_FAILURE;
+      break;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      size_t length = offsets[i + 1] - offsets[i] + SHAMIR_BATCH_OVERHEAD;
+      const uint8_t *share = shares + (offsets[i] + i * SHAMIR_BATCH_OVERHEAD) * share_cnt;
+
+      for (int s = 0; s < share_cnt; s++) {
+        size_t size = sizeof(encoded);
+
+        b58enc(encoded, &size, share + (size_t)s * length, length);
+        fprintf(stdout, "%s%s", s != 0 ? " " : "", encoded);
+      }
+      fputs("\n", stdout);
+    }
+
+    secret_cnt += count;
+  }
+
+  if (res == EXIT_SUCCESS)
+    fprintf(stderr, "sss.create: split %ld secrets into %d shares with a recovery threshold of %d\n",
+            secret_cnt, share_cnt, threshold);
+
+ out:
+  if (secrets != NULL) {
+    utils_wipe(secrets, SSS_BATCH_SECRETS * SSS_BATCH_SECRET_SIZE);
+    free(secrets);
+  }
+  if (shares != NULL) {
+    utils_wipe(shares, (size_t)share_cnt * SSS_BATCH_SECRETS * (SSS_BATCH_SECRET_SIZE + SHAMIR_BATCH_OVERHEAD));
+    free(shares);
+  }
+  utils_wipe(line, sizeof(line));
+  utils_wipe(encoded, sizeof(encoded));
+  return res;
+}
+
 static void
 _sss_create_usage(void)
 {
@@ -56,6 +279,15 @@ _sss_create_usage(void)
         "                          default value is 3 shares.\n", stderr);
   fputs("  -t, --threshold=<cnt>   Specify the threshold of number of shares required for\n"
         "                          recover the secret, default value is 2 shares.\n",stderr);
+  fputs("  -S, --stream            Split a secret of any length, stdin is encrypted in chunks under\n"
+        "                          a random key and only the key is split. Share files are written\n"
+        "                          to <prefix>.1 .. <prefix>.<cnt>, each holding the encrypted data.\n", stderr);
+  fputs("  -o, --output=<prefix>   Prefix of the share files written with --stream, existing files\n"
+        "                          are never overwritten.\n", stderr);
+  fputs("  -c, --chunk-size=<size> Bytes per encrypted chunk with --stream, default is 65536.\n", stderr);
+  fputs("  -B, --batch             Split many secrets, one hex secret of up to 256 bytes per line of\n"
+        "                          stdin. A line of space separated shares is written per secret,\n"
+        "                          each share holds the threshold and a tag verified on recovery.\n", stderr);
   fputs("\n", stderr);
 
   fputs("examples:\n", stderr);
@@ -66,51 +298,410 @@ _sss_create_usage(void)
   fputs("        btct bip39.seed --passphrase=TREZOR | \\\n", stderr);
   fputs("        btct bip32.masterkey | btct sss.create --shares=5 --thresholds=3\n", stderr);
   fputs("\n", stderr);
+  fputs("  Split an encrypted backup archive into 5 share files with a threshold of 3.\n", stderr);
+  fputs("\n", stderr);
+  fputs("      btct sss.create --stream --shares=5 --thresholds=3 --output=backup.sss < backup.tar.gpg\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Split each key of a list into 5 shares with a threshold of 3.\n", stderr);
+  fputs("\n", stderr);
+  fputs("      btct sss.create --batch --shares=5 --thresholds=3 < keys.hex > shares.txt\n", stderr);
+  fputs("\n", stderr);
 }
 
+/** shares of the subset with lexicographic rank, in increasing order */
+static void
+_sss_diagnose_subset(const _sss_diagnose_t *job, uint64_t rank, uint8_t *subset)
+{
+  uint8_t share = 0;
+
+  for (int i = 0; i < job->threshold; i++) {
+    for (;;) {
+      // subsets with share at position i that follow share
+      int remaining = job->share_cnt - share - 1, left = job->threshold - i - 1;
+      uint64_t skip = job->binomial[remaining * (job->threshold + 1) + left];
+      if (rank < skip)
+        break;
+      rank -= skip;
+      share++;
+    }
+    subset[i] = share++;
+  }
+}
+
+static void *
+_sss_diagnose_worker(void *arg)
+{
+  _sss_diagnose_t *job = arg;
+  sss_Share shares[255];
+  uint8_t subset[255], out[sss_MLEN];
+
+  while (atomic_load_explicit(&job->found, memory_order_relaxed) == 0) {
+    uint64_t rank = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+    if (rank >= job->subset_cnt)
+      break;
+
+    _sss_diagnose_subset(job, rank, subset);
+    for (int i = 0; i < job->threshold; i++)
+      memcpy(shares[i], job->shares[subset[i]], sizeof(sss_Share));
+
+    // shares are authenticated, a subset either recovers the secret or fails
+    if (sss_combine_shares(out, (const sss_Share *)shares, job->threshold) != 0)
+      continue;
+
+    int expected = 0;
+    if (atomic_compare_exchange_strong(&job->found, &expected, 1)) {
+      memcpy(job->subset, subset, job->threshold);
+      memcpy(job->secret, out, sizeof(out));
+    }
+    break;
+  }
+
+  utils_wipe(shares, sizeof(shares));
+  utils_wipe(out, sizeof(out));
+  return NULL;
+}
+
+/**
+ * Search threshold sized subsets of shares in parallel until one
+ * recovers the secret, then test every other share against threshold - 1
+ * shares of that subset to report which shares are consistent.
+ */
 static int
-_sss_recover(void)
+_sss_diagnose(const sss_Share *shares, uint8_t share_cnt, uint8_t threshold, size_t threads,
+              uint8_t *secret)
 {
+  pthread_t workers[SSS_MAX_THREADS];
+  bool consistent[255] = { false };
+  sss_Share test[255];
   uint8_t out[sss_MLEN];
-  char *buf[256] = {NULL};
-  size_t length;
+  size_t started = 0, consistent_cnt = 0;
+  _sss_diagnose_t job = {
+    .shares = shares,
+    .share_cnt = share_cnt,
+    .threshold = threshold,
+    .next = 0,
+    .found = 0,
+  };
+
+  if (threshold == 0 || threshold > share_cnt) {
+    fprintf(stderr, "sss.recover: --diagnose needs a threshold of 1 to %d shares\n", share_cnt);
+    return -1;
+  }
+
+  job.binomial = calloc((size_t)(share_cnt + 1) * (threshold + 1), sizeof(uint64_t));
+  if (job.binomial == NULL)
+    return -1;
+
+  // pascal's triangle saturating at the subset limit
+  for (int n = 0; n <= share_cnt; n++) {
+    for (int k = 0; k <= threshold && k <= n; k++) {
+      uint64_t value = 1;
+      if (k != 0 && k != n) {
+        value = job.binomial[(n - 1) * (threshold + 1) + k - 1]
+          + job.binomial[(n - 1) * (threshold + 1) + k];
+        if (value > SSS_DIAGNOSE_MAX_SUBSETS)
+          value = SSS_DIAGNOSE_MAX_SUBSETS + 1;
+      }
+      job.binomial[n * (threshold + 1) + k] = value;
+    }
+  }
+
+  job.subset_cnt = job.binomial[share_cnt * (threshold + 1) + threshold];
+  if (job.subset_cnt > SSS_DIAGNOSE_MAX_SUBSETS) {
+    fprintf(stderr, "sss.recover: too many subsets of %d out of %d shares to search\n",
+            threshold, share_cnt);
+    free(job.binomial);
+    return -1;
+  }
+
+  fprintf(stderr, "sss.recover: searching %" PRIu64 " subsets of %d shares using %ld threads\n",
+          job.subset_cnt, threshold, threads);
+
+  if (threads > job.subset_cnt)
+    threads = job.subset_cnt;
+
+  for (; started < threads; started++) {
+    if (pthread_create(&workers[started], NULL, _sss_diagnose_worker, &job) != 0)
+      break;
+  }
+
+  // run on the calling thread if no worker could be started
+  if (started == 0)
+    _sss_diagnose_worker(&job);
+
+  for (size_t i = 0; i < started; i++)
+    pthread_join(workers[i], NULL);
+
+  free(job.binomial);
+
+  if (!job.found) {
+    fputs("sss.recover: no subset of shares recovers the secret, is the threshold right?\n", stderr);
+    return -1;
+  }
+
+  // the remaining shares are checked against threshold - 1 known good ones
+  for (int i = 0; i < threshold; i++)
+    consistent[job.subset[i]] = true;
+
+  for (int i = 0; i < threshold - 1; i++)
+    memcpy(test[i], shares[job.subset[i]], sizeof(sss_Share));
+
+  for (int s = 0; s < share_cnt; s++) {
+    if (consistent[s])
+      continue;
+    memcpy(test[threshold - 1], shares[s], sizeof(sss_Share));
+    consistent[s] = sss_combine_shares(out, (const sss_Share *)test, threshold) == 0;
+  }
+
+  for (int s = 0; s < share_cnt; s++) {
+    fprintf(stderr, "sss.recover: share #%d is %s\n", s + 1, consistent[s] ? "consistent" : "corrupt");
+    consistent_cnt += consistent[s];
+  }
+
+  fprintf(stderr, "sss.recover: %ld of %d shares are consistent%s\n", consistent_cnt, share_cnt,
+          consistent_cnt * 2 > share_cnt ? "" : ", no majority agrees on the secret");
+
+  memcpy(secret, job.secret, sizeof(job.secret));
+  utils_wipe(job.secret, sizeof(job.secret));
+  utils_wipe(test, sizeof(test));
+  utils_wipe(out, sizeof(out));
+  return 0;
+}
+
+/**
+ * Decode one base58 share line, trailing whitespace and newline are
+ * ignored. Fails unless the line decodes to exactly one share.
+ */
+static int
+_sss_decode_share(char *line, size_t length, sss_Share share)
+{
+  size_t size = sizeof(sss_Share);
+
+  while (length && isspace((unsigned char)line[length - 1]))
+    line[--length] = '\0';
+
+  if (!b58tobin(share, &size, line, length) || size != sizeof(sss_Share))
+    return -1;
+
+  return 0;
+}
+
+static int
+_sss_recover(bool diagnose, uint8_t threshold, size_t threads)
+{
+  uint8_t out[sss_MLEN];
+  sss_Share shares[255];
+  // shares indexed by their x coordinate, the first byte of a share
+  int16_t index[256];
+  char *line = NULL;
+  size_t line_size = 0, line_number = 0;
+  ssize_t length;
   uint8_t share_cnt = 0;
-  sss_Share *shares;
+  int res = EXIT_FAILURE;
+
+  for (int i = 0; i < 256; i++)
+    index[i] = -1;
+
+  // Read and decode shares as they arrive, enough distinct ones end input
+  while ((diagnose || threshold == 0 || share_cnt < threshold)
+         && (length = getline(&line, &line_size, stdin)) != -1)
+  {
+    uint8_t x;
+
+    line_number++;
+    if (strspn(line, " \t\r\n") == (size_t)length)
+      continue;
+
+    if (_sss_decode_share(line, length, shares[share_cnt]) != 0) {
+      fprintf(stderr, "sss.recover: failed to decode base58 encoded share on line %ld\n",
+              line_number);
+      goto out;
+    }
+
+    x = shares[share_cnt][0];
+    if (index[x] != -1) {
+      if (memcmp(shares[index[x]], shares[share_cnt], sizeof(sss_Share)) != 0) {
+        fprintf(stderr, "sss.recover: share on line %ld conflicts with share #%d\n",
+                line_number, index[x] + 1);
+        goto out;
+      }
+      fprintf(stderr, "sss.recover: skipping duplicate share on line %ld\n", line_number);
+      continue;
+    }
 
-  // Read share from stdin
-  while(getline(&buf[share_cnt], &length, stdin) != -1) {
-    share_cnt++;
     if (share_cnt == 255) {
-      fputs("To many shares read from stdin\n", stderr);
-      return EXIT_FAILURE;
+      fputs("sss.recover: too many shares read from stdin\n", stderr);
+      goto out;
     }
+
+    index[x] = share_cnt++;
+  }
+
+  if (ferror(stdin)) {
+    fputs("sss.recover: failed to read shares from stdin\n", stderr);
+    goto out;
   }
+
   fprintf(stderr, "sss.recover: %d shares read from stdin\n", share_cnt);
 
-  // Decode base58 shares into binary shares to recover from
-  shares = malloc(sizeof(sss_Share) * share_cnt);
-  for (int s = 0; s < share_cnt; s++) {
-    length = sizeof(sss_Share);
-    if (b58tobin((sss_Share *)shares[s], &length, buf[s], strlen(buf[s])-1) == false) {
-      fputs("sss.recover: Failed to decode base58 encoded share\n", stderr);
-      return EXIT_FAILURE;
-    }
+  if (share_cnt == 0 || share_cnt < threshold) {
+    fprintf(stderr, "sss.recover: not enough shares to recover secret, %d needed\n",
+            threshold ? threshold : 1);
+    goto out;
   }
 
   // Recover secret from shares
-  if (sss_combine_shares(out, (const sss_Share *)shares, share_cnt) != 0) {
-    fputs("sss.recover: failed to recover secret from shares\n", stderr);
-    return EXIT_FAILURE;
+  if (diagnose) {
+    if (_sss_diagnose((const sss_Share *)shares, share_cnt, threshold, threads, out) != 0)
+      goto out;
+  }
+  else if (sss_combine_shares(out, (const sss_Share *)shares, share_cnt) != 0) {
+    fputs("sss.recover: failed to recover secret from shares, use --diagnose --threshold=<cnt>\n"
+          "             to find corrupt shares\n", stderr);
+    goto out;
   }
 
   fwrite(out, sizeof(out), 1, stdout);
-  return EXIT_SUCCESS;
+  res = EXIT_SUCCESS;
+
+ out:
+  if (line != NULL) {
+    utils_wipe(line, line_size);
+    free(line);
+  }
+  utils_wipe(shares, sizeof(shares));
+  utils_wipe(out, sizeof(out));
+  return res;
+}
+
+static int
+_sss_recover_stream(char **files, size_t count)
+{
+  FILE *in[255] = { NULL };
+  int res = EXIT_SUCCESS;
+
+  if (count == 0 || count > 255) {
+    fputs("sss.recover: --stream requires 1 to 255 share files as arguments\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  for (size_t s = 0; s < count; s++) {
+    in[s] = fopen(files[s], "rb");
+    if (in[s] == NULL) {
+      fprintf(stderr, "sss.recover: failed to open share file '%s'\n", files[s]);
+      res = EXIT_FAILURE;
+      goto out;
+    }
+  }
+
+  fprintf(stderr, "sss.recover: recovering secret from %ld share files\n", count);
+
+  if (sss_stream_recover(in, count, stdout) != 0 || fflush(stdout) != 0) {
+    fputs("sss.recover: failed to recover secret from share files\n", stderr);
+    res = EXIT_FAILURE;
+  }
+
+ out:
+  for (size_t s = 0; s < count; s++) {
+    if (in[s] != NULL)
+      fclose(in[s]);
+  }
+  return res;
+}
+
+/**
+ * Recover one hex secret per line of stdin from the base58 batch shares
+ * of the line, a secret is only written once its tag is verified.
+ */
+static int
+_sss_recover_batch(void)
+{
+  uint8_t secret[SSS_BATCH_SECRET_SIZE];
+  uint8_t share[SSS_BATCH_SECRET_SIZE + SHAMIR_BATCH_OVERHEAD];
+  char hex[SSS_BATCH_SECRET_SIZE * 2 + 1];
+  char *line = NULL, *token, *saveptr;
+  size_t line_size = 0, lineno = 0;
+  uint8_t *shares;
+  int res = EXIT_SUCCESS;
+
+  shares = malloc(SHAMIR_MAX_SHARES * sizeof(share));
+  if (shares == NULL)
+    return EXIT_FAILURE;
+
+  while (res == EXIT_SUCCESS && getline(&line, &line_size, stdin) != -1) {
+    size_t length = 0, share_cnt = 0;
+    int combined;
+    lineno++;
+
+    for (token = strtok_r(line, " \t\r\n", &saveptr); token != NULL;
+         token = strtok_r(NULL, " \t\r\n", &saveptr))
+    {
+      size_t size = sizeof(share);
+
+      // decoded bytes are right aligned in share
+      if (share_cnt == SHAMIR_MAX_SHARES
+          || !b58tobin(share, &size, token, strlen(token)) || size <= SHAMIR_BATCH_OVERHEAD
+          || (share_cnt != 0 && size != length))
+      {
+        fprintf(stderr, "sss.recover: line %ld: invalid share\n", lineno);
+        res = EXIT_FAILURE;
+        break;
+      }
+
+      length = size;
+      memcpy(shares + share_cnt * length, share + sizeof(share) - length, length);
+      share_cnt++;
+    }
+
+    if (res != EXIT_SUCCESS || share_cnt == 0)
+      continue;
+
+    combined = shamir_batch_combine(shares, length, share_cnt, secret);
+    if (combined == -2)
+      fprintf(stderr, "sss.recover: line %ld: %ld shares given, %d are needed\n",
+              lineno, share_cnt, shares[1]);
+    else if (combined == -3)
+      fprintf(stderr, "sss.recover: line %ld: shares do not verify, a share is corrupt "
+              "or of another secret\n", lineno);
+    else if (combined != 0)
+      fprintf(stderr, "sss.recover: line %ld: failed to recover secret from shares\n", lineno);
+
+    if (combined != 0) {
+      res = EXIT_FAILURE;
+      break;
+    }
+
+    utils_to_hex_string(secret, length - SHAMIR_BATCH_OVERHEAD, hex);
+    fprintf(stdout, "%s\n", hex);
+  }
+
+  utils_wipe(shares, SHAMIR_MAX_SHARES * sizeof(share));
+  utils_wipe(secret, sizeof(secret));
+  utils_wipe(share, sizeof(share));
+  utils_wipe(hex, sizeof(hex));
+  if (line != NULL) {
+    utils_wipe(line, line_size);
+    free(line);
+  }
+  free(shares);
+  return res;
 }
 
 static void
 _sss_recover_usage(void)
 {
-  fputs("usage: btct sss.recover <args>\n", stderr);
+  fputs("usage: btct sss.recover <args> [<share file>...]\n", stderr);
+  fputs("\n", stderr);
+  fputs("  -S, --stream            Recover a secret split with `sss.create --stream` from the share\n"
+        "                          files given as arguments, written to stdout as it is decrypted.\n", stderr);
+  fputs("  -B, --batch             Recover secrets split with `sss.create --batch`, each line of stdin\n"
+        "                          holds shares of one secret, written as a hex line. A line with\n"
+        "                          too few, corrupt or mixed up shares fails.\n", stderr);
+  fputs("  -d, --diagnose          Search subsets of --threshold shares in parallel for one that\n"
+        "                          recovers the secret and report which shares are corrupt.\n", stderr);
+  fputs("  -t, --threshold=<cnt>   Recovery threshold of the shares, stdin is read until this many\n"
+        "                          distinct shares are decoded. Required by --diagnose.\n", stderr);
+  fputs("  -T, --threads=<cnt>     Worker threads of --diagnose, default is one per online cpu.\n", stderr);
   fputs("\n", stderr);
 
   fputs("examples:\n", stderr);
@@ -120,6 +711,14 @@ _sss_recover_usage(void)
   fputs("      echo 'legal winner thank year wave sausage worth useful legal winner thank yellow' | \\\n", stderr);
   fputs("        btct sss.create --shares=3 --thresholds=2\n", stderr);
   fputs("\n", stderr);
+  fputs("  Recover an archive from three of its share files: \n", stderr);
+  fputs("\n", stderr);
+  fputs("      btct sss.recover --stream backup.sss.1 backup.sss.3 backup.sss.4 > backup.tar.gpg\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Recover the keys from three shares of each line: \n", stderr);
+  fputs("\n", stderr);
+  fputs("      cut -d' ' -f1,3,5 shares.txt | btct sss.recover --batch\n", stderr);
+  fputs("\n", stderr);
 }
 
 
@@ -128,6 +727,9 @@ _sss_create_command(int argc, char **argv) {
   int c;
   uint8_t shares = 3;
   uint8_t threshold = 2;
+  bool stream = false, batch = false;
+  const char *output = NULL;
+  size_t chunk_size = SSS_STREAM_DEFAULT_CHUNK_SIZE;
 
   while (1)
     {
@@ -136,10 +738,14 @@ _sss_create_command(int argc, char **argv) {
         {"help",  no_argument, 0, 'h' },
         {"shares",  required_argument, 0, 's' },
         {"thresholds", required_argument, 0, 't' },
+        {"stream", no_argument, 0, 'S' },
+        {"output", required_argument, 0, 'o' },
+        {"chunk-size", required_argument, 0, 'c' },
+        {"batch", no_argument, 0, 'B' },
         {0, 0, 0, 0}
       };
 
-      c = getopt_long(argc, argv, "hst", long_options, &option_index);
+      c = getopt_long(argc, argv, "hs:t:So:c:B", long_options, &option_index);
       if (c == -1)
         break;
 
@@ -155,24 +761,59 @@ _sss_create_command(int argc, char **argv) {
       case 't':
         threshold = atoi(optarg);
         break;
+
+      case 'S':
+        stream = true;
+        break;
+
+      case 'o':
+        output = optarg;
+        break;
+
+      case 'c':
+        chunk_size = strtoul(optarg, NULL, 10);
+        if (chunk_size == 0 || chunk_size > SSS_STREAM_MAX_CHUNK_SIZE) {
+          fprintf(stderr, "sss.create: chunk size must be 1 to %d bytes\n", SSS_STREAM_MAX_CHUNK_SIZE);
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'B':
+        batch = true;
+        break;
       }
     }
 
+  if (stream)
+    return _sss_create_stream(shares, threshold, output, chunk_size);
+
+  if (batch)
+    return _sss_create_batch(shares, threshold);
+
   return _sss_create(shares, threshold);
 }
 
 static int
 _sss_recover_command(int argc, char **argv) {
   int c;
+  bool stream = false, batch = false, diagnose = false;
+  uint8_t threshold = 0;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+
   while (1)
     {
       int option_index = 0;
       static struct option long_options[] = {
         {"help",  no_argument, 0, 'h' },
+        {"stream", no_argument, 0, 'S' },
+        {"batch", no_argument, 0, 'B' },
+        {"diagnose", no_argument, 0, 'd' },
+        {"threshold", required_argument, 0, 't' },
+        {"threads", required_argument, 0, 'T' },
         {0, 0, 0, 0}
       };
 
-      c = getopt_long(argc, argv, "h", long_options, &option_index);
+      c = getopt_long(argc, argv, "hSBdt:T:", long_options, &option_index);
       if (c == -1)
         break;
 
@@ -180,10 +821,41 @@ _sss_recover_command(int argc, char **argv) {
       case 'h':
         _sss_recover_usage();
         return EXIT_FAILURE;
+
+      case 'S':
+        stream = true;
+        break;
+
+      case 'B':
+        batch = true;
+        break;
+
+      case 'd':
+        diagnose = true;
+        break;
+
+      case 't':
+        threshold = atoi(optarg);
+        break;
+
+      case 'T':
+        threads = atol(optarg);
+        break;
       }
     }
 
-  return _sss_recover();
+  if (threads < 1)
+    threads = 1;
+  if (threads > SSS_MAX_THREADS)
+    threads = SSS_MAX_THREADS;
+
+  if (stream)
+    return _sss_recover_stream(argv + optind, argc - optind);
+
+  if (batch)
+    return _sss_recover_batch();
+
+  return _sss_recover(diagnose, threshold, threads);
 }
 
 static void _sss_command_usage(void)
@@ -0,0 +1,269 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <nettle/gcm.h>
+
+#include "hazmat.h"
+
+#include "sss_stream.h"
+#include "utils.h"
+
+#define SSS_STREAM_MAGIC "BTCTSSS1"
+#define SSS_STREAM_VERSION 1
+#define SSS_STREAM_KEY_SIZE 32
+
+#define SSS_STREAM_HEADER_MAGIC 0
+#define SSS_STREAM_HEADER_VERSION 8
+#define SSS_STREAM_HEADER_THRESHOLD 10
+#define SSS_STREAM_HEADER_CHUNK_SIZE 12
+#define SSS_STREAM_HEADER_KEYSHARE 16
+
+/** chunk number and final flag, authenticated with each chunk */
+#define SSS_STREAM_AAD_SIZE 9
+
+static void
+_chunk_init(struct gcm_aes256_ctx *gcm, const uint8_t *key, uint64_t number, bool final)
+{
+  uint8_t nonce[GCM_IV_SIZE] = { 0 }, aad[SSS_STREAM_AAD_SIZE];
+
+  utils_out_u32_be(nonce + 4, (uint32_t)(number >> 32));
+  utils_out_u32_be(nonce + 8, (uint32_t)number);
+  memcpy(aad, nonce + 4, 8);
+  aad[8] = final ? 1 : 0;
+
+  gcm_aes256_set_key(gcm, key);
+  gcm_aes256_set_iv(gcm, sizeof(nonce), nonce);
+  gcm_aes256_update(gcm, sizeof(aad), aad);
+}
+
+/** read a full chunk, or what is left of in, final is set at end of input */
+static size_t
+_read_chunk(FILE *in, uint8_t *buf, size_t chunk_size, bool *final)
+{
+  size_t bytes = fread(buf, 1, chunk_size, in);
+  int c;
+
+  if (bytes < chunk_size) {
+    *final = true;
+    return bytes;
+  }
+
+  // peek one byte to know if this is the last full chunk
+  c = getc(in);
+  if (c == EOF)
+    *final = true;
+  else
+    ungetc(c, in);
+
+  return bytes;
+}
+
+int
+sss_stream_create(FILE *in, FILE **out, uint8_t share_cnt, uint8_t threshold,
+                  size_t chunk_size)
+{
+  uint8_t key[SSS_STREAM_KEY_SIZE], header[SSS_STREAM_HEADER_SIZE];
+  uint8_t length[4], tag[SSS_STREAM_TAG_SIZE];
+  sss_Keyshare keyshares[255];
+  struct gcm_aes256_ctx gcm;
+  uint64_t number = 0;
+  bool final = false;
+  uint8_t *buf;
+  int res = 0;
+
+  if (chunk_size == 0)
+    chunk_size = SSS_STREAM_DEFAULT_CHUNK_SIZE;
+
+  if (share_cnt == 0 || threshold == 0 || threshold > share_cnt
+      || chunk_size > SSS_STREAM_MAX_CHUNK_SIZE)
+    return -1;
+
+  buf = malloc(chunk_size);
+  if (buf == NULL)
+    return -2;
+
+  if (utils_fill_random(key, sizeof(key)) != 0) {
+    res = -3;
+    goto out;
+  }
+
+  sss_create_keyshares(keyshares, key, share_cnt, threshold);
+
+  memset(header, 0, sizeof(header));
+  memcpy(header + SSS_STREAM_HEADER_MAGIC, SSS_STREAM_MAGIC, 8);
+  utils_out_u16_be(header + SSS_STREAM_HEADER_VERSION, SSS_STREAM_VERSION);
+  header[SSS_STREAM_HEADER_THRESHOLD] = threshold;
+  utils_out_u32_be(header + SSS_STREAM_HEADER_CHUNK_SIZE, (uint32_t)chunk_size);
+
+  for (uint8_t s = 0; s < share_cnt; s++) {
+    memcpy(header + SSS_STREAM_HEADER_KEYSHARE, keyshares[s], sss_KEYSHARE_LEN);
+    if (fwrite(header, 1, sizeof(header), out[s]) != sizeof(header)) {
+      res = -4;
+      goto out;
+    }
+  }
+
+  // every share file gets the same ciphertext, one chunk in memory at a time
+  while (!final) {
+    size_t bytes = _read_chunk(in, buf, chunk_size, &final);
+    if (ferror(in)) {
+      res = -5;
+      goto out;
+    }
+
+    _chunk_init(&gcm, key, number++, final);
+    gcm_aes256_encrypt(&gcm, bytes, buf, buf);
+    gcm_aes256_digest(&gcm, sizeof(tag), tag);
+
+    utils_out_u32_be(length, (uint32_t)bytes);
+    for (uint8_t s = 0; s < share_cnt; s++) {
+      if (fwrite(length, 1, sizeof(length), out[s]) != sizeof(length)
+          || fwrite(buf, 1, bytes, out[s]) != bytes
+          || fwrite(tag, 1, sizeof(tag), out[s]) != sizeof(tag))
+      {
+        res = -4;
+        goto out;
+      }
+    }
+  }
+
+ out:
+  utils_wipe(key, sizeof(key));
+  utils_wipe(keyshares, sizeof(keyshares));
+  utils_wipe(&gcm, sizeof(gcm));
+  utils_wipe(buf, chunk_size);
+  free(buf);
+  return res;
+}
+
+static int
+_read_header(FILE *in, uint8_t *threshold, uint32_t *chunk_size, uint8_t *keyshare)
+{
+  uint8_t header[SSS_STREAM_HEADER_SIZE];
+
+  if (fread(header, 1, sizeof(header), in) != sizeof(header))
+    return -1;
+
+  if (memcmp(header + SSS_STREAM_HEADER_MAGIC, SSS_STREAM_MAGIC, 8) != 0
+      || utils_in_u16_be(header + SSS_STREAM_HEADER_VERSION) != SSS_STREAM_VERSION)
+    return -2;
+
+  *threshold = header[SSS_STREAM_HEADER_THRESHOLD];
+  *chunk_size = utils_in_u32_be(header + SSS_STREAM_HEADER_CHUNK_SIZE);
+  memcpy(keyshare, header + SSS_STREAM_HEADER_KEYSHARE, sss_KEYSHARE_LEN);
+  utils_wipe(header, sizeof(header));
+
+  if (*threshold == 0 || *chunk_size == 0 || *chunk_size > SSS_STREAM_MAX_CHUNK_SIZE)
+    return -3;
+
+  return 0;
+}
+
+int
+sss_stream_recover(FILE **in, uint8_t share_cnt, FILE *out)
+{
+  uint8_t key[SSS_STREAM_KEY_SIZE], length[4];
+  uint8_t tag[SSS_STREAM_TAG_SIZE], expected[SSS_STREAM_TAG_SIZE];
+  sss_Keyshare keyshares[255];
+  uint8_t threshold = 0, share_threshold;
+  uint32_t chunk_size = 0, share_chunk_size;
+  struct gcm_aes256_ctx gcm;
+  uint64_t number = 0;
+  bool final = false;
+  uint8_t *buf = NULL;
+  int res = 0;
+
+  if (share_cnt == 0)
+    return -1;
+
+  for (uint8_t s = 0; s < share_cnt; s++) {
+    if (_read_header(in[s], &share_threshold, &share_chunk_size, keyshares[s]) != 0) {
+      res = -2;
+      goto out;
+    }
+
+    if (s == 0) {
+      threshold = share_threshold;
+      chunk_size = share_chunk_size;
+    }
+    else if (share_threshold != threshold || share_chunk_size != chunk_size) {
+      res = -3;
+      goto out;
+    }
+
+    // the same share given twice does not count towards the threshold
+    for (uint8_t i = 0; i < s; i++) {
+      if (keyshares[i][0] == keyshares[s][0]) {
+        res = -3;
+        goto out;
+      }
+    }
+  }
+
+  if (share_cnt < threshold) {
+    res = -4;
+    goto out;
+  }
+
+  sss_combine_keyshares(key, (const sss_Keyshare *)keyshares, threshold);
+
+  buf = malloc(chunk_size);
+  if (buf == NULL) {
+    res = -5;
+    goto out;
+  }
+
+  while (!final) {
+    uint32_t bytes;
+    int c;
+
+    if (fread(length, 1, sizeof(length), in[0]) != sizeof(length)) {
+      // input ended before the final chunk
+      res = -6;
+      goto out;
+    }
+
+    bytes = utils_in_u32_be(length);
+    if (bytes > chunk_size
+        || fread(buf, 1, bytes, in[0]) != bytes
+        || fread(tag, 1, sizeof(tag), in[0]) != sizeof(tag))
+    {
+      res = -6;
+      goto out;
+    }
+
+    // only a short chunk or one at the end of the share is the final one
+    final = bytes < chunk_size;
+    if (!final) {
+      c = getc(in[0]);
+      if (c == EOF)
+        final = true;
+      else
+        ungetc(c, in[0]);
+    }
+
+    _chunk_init(&gcm, key, number++, final);
+    gcm_aes256_decrypt(&gcm, bytes, buf, buf);
+    gcm_aes256_digest(&gcm, sizeof(expected), expected);
+
+    if (memcmp(tag, expected, sizeof(tag)) != 0) {
+      res = -7;
+      goto out;
+    }
+
+    if (fwrite(buf, 1, bytes, out) != bytes) {
+      res = -8;
+      goto out;
+    }
+  }
+
+ out:
+  utils_wipe(key, sizeof(key));
+  utils_wipe(keyshares, sizeof(keyshares));
+  utils_wipe(&gcm, sizeof(gcm));
+  if (buf != NULL) {
+    utils_wipe(buf, chunk_size);
+    free(buf);
+  }
+  return res;
+}
@@ -0,0 +1,40 @@
+#ifndef __sss_stream_h__
+#define __sss_stream_h__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define SSS_STREAM_HEADER_SIZE 64
+#define SSS_STREAM_TAG_SIZE 16
+#define SSS_STREAM_DEFAULT_CHUNK_SIZE (64 * 1024)
+#define SSS_STREAM_MAX_CHUNK_SIZE (16 * 1024 * 1024)
+
+/**
+ * Secrets of any length are encrypted in chunks with AES-256-GCM under
+ * a random key of the secret, only the key is split into shamir
+ * keyshares. Each share file holds one keyshare followed by the
+ * encrypted chunks, all integers are big endian:
+ *
+ *   header  64 bytes, magic, version, threshold, chunk size, keyshare
+ *   chunks  u32 length, ciphertext and 16 byte tag, repeated
+ *
+ * Chunk nonce and associated data hold the chunk number and the final
+ * chunk is flagged, reordered or truncated streams fail to recover.
+ * Memory use is bounded by the chunk size.
+ */
+
+/**
+ * Encrypt in into share_cnt share files out, any threshold of them
+ * recovers the secret. chunk_size 0 uses SSS_STREAM_DEFAULT_CHUNK_SIZE.
+ */
+int sss_stream_create(FILE *in, FILE **out, uint8_t share_cnt, uint8_t threshold,
+                      size_t chunk_size);
+/**
+ * Combine keyshares of share files in and write the decrypted secret to
+ * out, chunks are read from the first share file and only written when
+ * authenticated.
+ */
+int sss_stream_recover(FILE **in, uint8_t share_cnt, FILE *out);
+
+#endif
@@ -0,0 +1,110 @@
+#include <inttypes.h>
+
+#include "stats.h"
+
+#ifdef BTCT_STATS
+
+bool stats_is_enabled = false;
+_Atomic uint64_t stats_counters[STATS_COUNTER_CNT];
+
+static _Atomic uint64_t _stage_calls[STATS_STAGE_CNT];
+static _Atomic uint64_t _stage_wall_ns[STATS_STAGE_CNT];
+static _Atomic uint64_t _stage_cpu_ns[STATS_STAGE_CNT];
+static struct timespec _start_wall;
+
+static const char *_counter_names[STATS_COUNTER_CNT] = {
+  [STATS_EC_MULTIPLICATIONS] = "EC multiplications",
+  [STATS_HMAC_SHA512] = "HMAC-SHA512 calls",
+  [STATS_HASH160] = "hash160 calls",
+  [STATS_BASE58_ENCODE] = "base58 encodes",
+  [STATS_PBKDF2_ITERATIONS] = "PBKDF2 iterations",
+  [STATS_CACHE_HITS] = "cache hits",
+};
+
+static const char *_stage_names[STATS_STAGE_CNT] = {
+  [STATS_STAGE_MASTERKEY] = "bip32 masterkey",
+  [STATS_STAGE_DERIVE] = "bip32 derive",
+  [STATS_STAGE_PUBKEY] = "bip32 pubkey",
+  [STATS_STAGE_ADDRESS] = "bip32 address",
+  [STATS_STAGE_PBKDF2] = "bip39 seed (pbkdf2)",
+  [STATS_STAGE_HASH160] = "hash160",
+  [STATS_STAGE_BASE58] = "base58 encode",
+};
+
+static inline uint64_t
+_elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) * 1000000000ll + (end->tv_nsec - start->tv_nsec);
+}
+
+void
+stats_enable(void)
+{
+  clock_gettime(CLOCK_MONOTONIC, &_start_wall);
+  stats_is_enabled = true;
+}
+
+stats_timer_t
+stats_stage_begin(stats_stage_t stage)
+{
+  stats_timer_t timer = { .active = false, .stage = stage };
+
+  if (!stats_is_enabled)
+    return timer;
+
+  timer.active = true;
+  clock_gettime(CLOCK_MONOTONIC, &timer.wall);
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &timer.cpu);
+  return timer;
+}
+
+void
+stats_stage_end(stats_timer_t *timer)
+{
+  struct timespec wall, cpu;
+
+  if (!timer->active)
+    return;
+
+  clock_gettime(CLOCK_MONOTONIC, &wall);
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+
+  atomic_fetch_add_explicit(&_stage_calls[timer->stage], 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&_stage_wall_ns[timer->stage], _elapsed_ns(&timer->wall, &wall), memory_order_relaxed);
+  atomic_fetch_add_explicit(&_stage_cpu_ns[timer->stage], _elapsed_ns(&timer->cpu, &cpu), memory_order_relaxed);
+}
+
+void
+stats_report(FILE *out)
+{
+  struct timespec wall, cpu, zero = { 0, 0 };
+
+  if (!stats_is_enabled)
+    return;
+
+  clock_gettime(CLOCK_MONOTONIC, &wall);
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+
+  fputs("\nbtct statistics:\n", out);
+  fputs("\n", out);
+  for (size_t i = 0; i < STATS_COUNTER_CNT; i++)
+    fprintf(out, "  %-24s %14" PRIu64 "\n", _counter_names[i],
+            atomic_load_explicit(&stats_counters[i], memory_order_relaxed));
+
+  fputs("\n", out);
+  fprintf(out, "  %-24s %14s %14s %14s\n", "stage (inclusive)", "calls", "wall ms", "cpu ms");
+  for (size_t i = 0; i < STATS_STAGE_CNT; i++) {
+    uint64_t calls = atomic_load_explicit(&_stage_calls[i], memory_order_relaxed);
+    if (calls == 0)
+      continue;
+
+    fprintf(out, "  %-24s %14" PRIu64 " %14.3f %14.3f\n", _stage_names[i], calls,
+            atomic_load_explicit(&_stage_wall_ns[i], memory_order_relaxed) / 1e6,
+            atomic_load_explicit(&_stage_cpu_ns[i], memory_order_relaxed) / 1e6);
+  }
+  fprintf(out, "  %-24s %14s %14.3f %14.3f\n", "total", "",
+          _elapsed_ns(&_start_wall, &wall) / 1e6, _elapsed_ns(&zero, &cpu) / 1e6);
+  fputs("\n", out);
+}
+
+#endif
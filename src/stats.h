@@ -0,0 +1,72 @@
+#ifndef __stats_h
+#define __stats_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <time.h>
+
+typedef enum stats_counter_t {
+  STATS_EC_MULTIPLICATIONS,
+  STATS_HMAC_SHA512,
+  STATS_HASH160,
+  STATS_BASE58_ENCODE,
+  STATS_PBKDF2_ITERATIONS,
+  STATS_CACHE_HITS,
+  STATS_COUNTER_CNT
+} stats_counter_t;
+
+typedef enum stats_stage_t {
+  STATS_STAGE_MASTERKEY,
+  STATS_STAGE_DERIVE,
+  STATS_STAGE_PUBKEY,
+  STATS_STAGE_ADDRESS,
+  STATS_STAGE_PBKDF2,
+  STATS_STAGE_HASH160,
+  STATS_STAGE_BASE58,
+  STATS_STAGE_CNT
+} stats_stage_t;
+
+typedef struct stats_timer_t {
+  bool active;
+  stats_stage_t stage;
+  struct timespec wall;
+  struct timespec cpu;
+} stats_timer_t;
+
+#ifdef BTCT_STATS
+
+extern bool stats_is_enabled;
+extern _Atomic uint64_t stats_counters[STATS_COUNTER_CNT];
+
+/** start collecting counters and stage timings */
+void stats_enable(void);
+/** write a summary of collected statistics */
+void stats_report(FILE *out);
+
+stats_timer_t stats_stage_begin(stats_stage_t stage);
+void stats_stage_end(stats_timer_t *timer);
+
+static inline void
+stats_add(stats_counter_t counter, uint64_t value)
+{
+  if (stats_is_enabled)
+    atomic_fetch_add_explicit(&stats_counters[counter], value, memory_order_relaxed);
+}
+
+#define STATS_ADD(counter, value) stats_add((counter), (value))
+#define STATS_INC(counter) stats_add((counter), 1)
+/** time the rest of the enclosing scope as stage */
+#define STATS_STAGE(stage) \
+  stats_timer_t __stats_timer __attribute__((cleanup(stats_stage_end))) = stats_stage_begin(stage)
+
+#else
+
+#define STATS_ADD(counter, value) do { } while (0)
+#define STATS_INC(counter) do { } while (0)
+#define STATS_STAGE(stage) do { } while (0)
+
+#endif
+
+#endif
@@ -4,34 +4,118 @@
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <nettle/aes.h>
+#include <nettle/gcm.h>
+#include <nettle/hmac.h>
+#include <nettle/memops.h>
 #include <nettle/pbkdf2.h>
+#include <nettle/sha2.h>
 
 #include "bip39_english.h"
 
 #include "store.h"
 #include "utils.h"
+#include "bip32.h"
+#include "bip39.h"
+#include "stats.h"
 
 #define KEY_SIZE 32
 
-static int
-_derive_key(const char *password, uint8_t *key) {
-  static size_t iterations = 4096;
-  static char *salt = "btct_store_password";
-  pbkdf2_hmac_sha512(strlen(password), password, iterations, strlen(salt), salt, KEY_SIZE, key);
+#define STORE_MAGIC "BTCTSTOR"
+#define STORE_VERSION 1
+#define STORE_KDF_PBKDF2_HMAC_SHA512 1
+#define STORE_DEFAULT_ITERATIONS 4096
+#define STORE_MIN_ITERATIONS 1024
+/** shortest accumulated time of calibration runs, in ns */
+#define STORE_CALIBRATE_NS 50000000ull
+#define STORE_SLOT_EMPTY 0xffffffff
+#define STORE_MIN_SLOTS 16
+#define STORE_MAX_WORDS 24
+/** largest decrypted record, all sections present */
+#define STORE_RECORD_SIZE 256
+
+#define STORE_HEADER_SIZE 128
+#define STORE_HEADER_MAGIC 0
+#define STORE_HEADER_VERSION 8
+#define STORE_HEADER_ENTRY_COUNT 12
+#define STORE_HEADER_SLOT_COUNT 16
+#define STORE_HEADER_KDF 20
+#define STORE_HEADER_ITERATIONS 24
+#define STORE_HEADER_SALT 32
+#define STORE_HEADER_CHECK 64
+
+#define STORE_ENTRY_SIZE 64
+#define STORE_ENTRY_LABEL 0
+#define STORE_ENTRY_FINGERPRINT 32
+#define STORE_ENTRY_SECTIONS 36
+/** label, fingerprint and sections are authenticated with the record */
+#define STORE_ENTRY_AAD_SIZE 40
+#define STORE_ENTRY_OFFSET 40
+#define STORE_ENTRY_SIZE_FIELD 44
+#define STORE_ENTRY_NONCE 48
+
+static void
+_derive_key(const char *password, const uint8_t *salt, size_t salt_size,
+            uint32_t iterations, uint8_t *key)
+{
+  STATS_ADD(STATS_PBKDF2_ITERATIONS, iterations);
+  pbkdf2_hmac_sha512(strlen(password), (const uint8_t *)password, iterations,
+                     salt_size, salt, KEY_SIZE, key);
+}
 
-  return 0;
+uint32_t
+store_calibrate_iterations(uint32_t target_ms)
+{
+  static const char *password = "btct store calibration";
+  uint8_t salt[STORE_SALT_SIZE] = { 0 }, key[KEY_SIZE];
+  uint64_t elapsed = 0, iterations = 0, result;
+  uint32_t probe = STORE_MIN_ITERATIONS;
+  struct timespec start, end;
+
+  // double the probe until the clock resolution does not matter
+  while (elapsed < STORE_CALIBRATE_NS) {
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pbkdf2_hmac_sha512(strlen(password), (const uint8_t *)password, probe,
+                       sizeof(salt), salt, KEY_SIZE, key);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    elapsed += (end.tv_sec - start.tv_sec) * 1000000000ull + end.tv_nsec - start.tv_nsec;
+    iterations += probe;
+    probe *= 2;
+  }
+
+  result = (uint64_t)target_ms * 1000000ull * iterations / elapsed;
+  if (result < STORE_MIN_ITERATIONS)
+    return STORE_MIN_ITERATIONS;
+  if (result > UINT32_MAX)
+    return UINT32_MAX;
+  return result;
+}
+
+static void
+_key_check(const uint8_t *key, uint8_t *check)
+{
+  static const char *label = "btct store key check";
+  struct hmac_sha256_ctx hmac;
+
+  hmac_sha256_set_key(&hmac, KEY_SIZE, key);
+  hmac_sha256_update(&hmac, strlen(label), (const uint8_t *)label);
+  hmac_sha256_digest(&hmac, SHA256_DIGEST_SIZE, check);
 }
 
 static uint16_t
 _lookup_mnemonic_index(const char *mnemonic)
 {
-  char *pend = mnemonic;
+  const char *pend = mnemonic;
   while (*pend != ' ' && *pend != '\0' && *pend != '\n')
     pend++;
 
-  for (size_t i = 0; i < 2047; i++) {
-    if (strncmp(bip39_english[i], mnemonic, pend - mnemonic) == 0)
+  size_t length = pend - mnemonic;
+  for (size_t i = 0; i < 2048; i++) {
+    if (strlen(bip39_english[i]) == length && strncmp(bip39_english[i], mnemonic, length) == 0)
       return i;
   }
   return 0xffff;
@@ -42,21 +126,24 @@ _mnemonics_to_data(const char *mnemonics, uint8_t *out)
 {
   uint16_t cnt = 0;
   uint8_t *pout = out;
-  char *ps = mnemonics;
+  const char *ps = mnemonics;
 
   while (1) {
+    if (cnt == STORE_MAX_WORDS)
+      return -1;
+
     uint16_t idx =  _lookup_mnemonic_index(ps);
-    utils_out_u16_be(pout, idx);
-    if ( pout[0] == 0xff && pout[1] == 0xff)
+    if (idx == 0xffff)
       return -1;
 
+    utils_out_u16_be(pout, idx);
     cnt++;
 
     // advance to start of next word
-    while(*ps != ' ' && *ps != '\0')
+    while(*ps != ' ' && *ps != '\0' && *ps != '\n')
       ps++;
 
-    if (*ps == '\0')
+    if (*ps != ' ')
       break;
 
     ps++;
@@ -66,120 +153,845 @@ _mnemonics_to_data(const char *mnemonics, uint8_t *out)
   return cnt;
 }
 
-int
-_write_store_file(const char *filename, const uint8_t *data, size_t size)
+static int
+_data_to_mnemonics(const uint8_t *data, size_t count, uint8_t *out, size_t *size)
+{
+  size_t length = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    uint16_t idx = utils_in_u16_be(data + i * 2) & 0x07ff;
+
+    // room for separator, word and null terminator
+    size_t word_length = strlen(bip39_english[idx]);
+    if (length + 1 + word_length + 1 > *size)
+      return -1;
+
+    if (i != 0)
+      out[length++] = ' ';
+
+    memcpy(out + length, bip39_english[idx], word_length);
+    length += word_length;
+  }
+
+  out[length] = '\0';
+  *size = length;
+  return 0;
+}
+
+static int
+_store_filename(const char *filename, char *file, size_t size)
 {
-  char file[2048] = {0};
   char *home_dir = getenv("HOME");
+  int res;
+
   if (filename == NULL)
-    snprintf(file, sizeof(file),  "%s/.btct.dat", home_dir != NULL ? home_dir : "./" );
+    res = snprintf(file, size, "%s/.btct.dat", home_dir != NULL ? home_dir : ".");
   else
-    realpath(file, filename);
+    res = snprintf(file, size, "%s", filename);
 
-  int out = open(file, O_CREAT | O_RDWR | O_TRUNC, S_IRWXU);
-  if (out == -1) {
-    perror("open failed with reason");
+  return res < (int)size ? 0 : -1;
+}
+
+static inline const uint8_t *
+_store_slots(const store_t *ctx, int table)
+{
+  return ctx->map + STORE_HEADER_SIZE + (size_t)table * ctx->slot_count * 4;
+}
+
+static inline const uint8_t *
+_store_entry(const store_t *ctx, uint32_t index)
+{
+  return _store_slots(ctx, 2) + (size_t)index * STORE_ENTRY_SIZE;
+}
+
+static uint32_t
+_label_hash(const char *label)
+{
+  // FNV-1a
+  uint32_t hash = 0x811c9dc5;
+  for (size_t i = 0; i < STORE_LABEL_SIZE && label[i] != '\0'; i++) {
+    hash ^= (uint8_t)label[i];
+    hash *= 0x01000193;
+  }
+  return hash;
+}
+
+static uint32_t
+_fingerprint_hash(const uint8_t *fingerprint)
+{
+  // fingerprints are hash output already
+  return utils_in_u32_be(fingerprint);
+}
+
+int
+store_open(store_t *ctx, const char *filename)
+{
+  char file[2048];
+  struct stat st;
+
+  memset(ctx, 0, sizeof(store_t));
+  ctx->fd = -1;
+
+  if (_store_filename(filename, file, sizeof(file)) != 0)
+    return -1;
+
+  ctx->fd = open(file, O_RDONLY | O_CLOEXEC);
+  if (ctx->fd == -1)
     return -1;
+
+  if (fstat(ctx->fd, &st) != 0 || st.st_size < STORE_HEADER_SIZE) {
+    store_close(ctx);
+    return -2;
   }
 
-  write(out, data, size);
-  close(out);
+  ctx->size = st.st_size;
+  ctx->map = mmap(NULL, ctx->size, PROT_READ, MAP_SHARED, ctx->fd, 0);
+  if (ctx->map == MAP_FAILED) {
+    ctx->map = NULL;
+    store_close(ctx);
+    return -3;
+  }
+
+  if (memcmp(ctx->map + STORE_HEADER_MAGIC, STORE_MAGIC, 8) != 0
+      || utils_in_u16_be(ctx->map + STORE_HEADER_VERSION) != STORE_VERSION
+      || ctx->map[STORE_HEADER_KDF] != STORE_KDF_PBKDF2_HMAC_SHA512)
+  {
+    store_close(ctx);
+    return -4;
+  }
+
+  ctx->entry_count = utils_in_u32_be(ctx->map + STORE_HEADER_ENTRY_COUNT);
+  ctx->slot_count = utils_in_u32_be(ctx->map + STORE_HEADER_SLOT_COUNT);
+  ctx->iterations = utils_in_u32_be(ctx->map + STORE_HEADER_ITERATIONS);
+  memcpy(ctx->salt, ctx->map + STORE_HEADER_SALT, STORE_SALT_SIZE);
+
+  // slot tables must be a power of two with at least one empty slot
+  if (ctx->slot_count == 0 || (ctx->slot_count & (ctx->slot_count - 1)) != 0
+      || ctx->entry_count >= ctx->slot_count
+      || STORE_HEADER_SIZE + (uint64_t)ctx->slot_count * 8
+         + (uint64_t)ctx->entry_count * STORE_ENTRY_SIZE > ctx->size)
+  {
+    store_close(ctx);
+    return -5;
+  }
 
   return 0;
 }
 
 int
-_read_store_file(const char *filename, uint8_t *data, size_t size) {
-  char file[2048] = {0};
-  char *home_dir = getenv("HOME");
-  if (filename == NULL)
-    snprintf(file, sizeof(file),  "%s/.btct.dat", home_dir != NULL ? home_dir : "./" );
+store_unlock(store_t *ctx, const char *password)
+{
+  uint8_t check[SHA256_DIGEST_SIZE];
+
+  _derive_key(password, ctx->salt, sizeof(ctx->salt), ctx->iterations, ctx->key);
+  _key_check(ctx->key, check);
+
+  if (memcmp(check, ctx->map + STORE_HEADER_CHECK, sizeof(check)) != 0) {
+    utils_wipe(ctx->key, sizeof(ctx->key));
+    return -1;
+  }
+
+  ctx->unlocked = true;
+  return 0;
+}
+
+void
+store_close(store_t *ctx)
+{
+  if (ctx->map != NULL)
+    munmap((void *)ctx->map, ctx->size);
+
+  if (ctx->fd != -1)
+    close(ctx->fd);
+
+  utils_wipe(ctx, sizeof(store_t));
+  ctx->fd = -1;
+}
+
+int
+store_entry(const store_t *ctx, uint32_t index, store_entry_t *entry)
+{
+  const uint8_t *pentry;
+
+  if (index >= ctx->entry_count)
+    return -1;
+
+  pentry = _store_entry(ctx, index);
+  memcpy(entry->label, pentry + STORE_ENTRY_LABEL, STORE_LABEL_SIZE);
+  entry->label[STORE_LABEL_SIZE - 1] = '\0';
+  memcpy(entry->fingerprint, pentry + STORE_ENTRY_FINGERPRINT, 4);
+  entry->sections = pentry[STORE_ENTRY_SECTIONS];
+  return 0;
+}
+
+int
+store_find_by_label(const store_t *ctx, const char *label)
+{
+  const uint8_t *slots = _store_slots(ctx, 0);
+  uint32_t mask = ctx->slot_count - 1;
+  uint32_t slot = _label_hash(label) & mask;
+
+  for (uint32_t i = 0; i < ctx->slot_count; i++, slot = (slot + 1) & mask) {
+    uint32_t index = utils_in_u32_be(slots + slot * 4);
+    if (index == STORE_SLOT_EMPTY || index >= ctx->entry_count)
+      return -1;
+
+    if (strncmp((const char *)_store_entry(ctx, index) + STORE_ENTRY_LABEL, label, STORE_LABEL_SIZE) == 0)
+      return index;
+  }
+
+  return -1;
+}
+
+int
+store_find_by_fingerprint(const store_t *ctx, const uint8_t *fingerprint)
+{
+  const uint8_t *slots = _store_slots(ctx, 1);
+  uint32_t mask = ctx->slot_count - 1;
+  uint32_t slot = _fingerprint_hash(fingerprint) & mask;
+
+  for (uint32_t i = 0; i < ctx->slot_count; i++, slot = (slot + 1) & mask) {
+    uint32_t index = utils_in_u32_be(slots + slot * 4);
+    if (index == STORE_SLOT_EMPTY || index >= ctx->entry_count)
+      return -1;
+
+    if (memcmp(_store_entry(ctx, index) + STORE_ENTRY_FINGERPRINT, fingerprint, 4) == 0)
+      return index;
+  }
+
+  return -1;
+}
+
+static void
+_encrypt_record(const uint8_t *key, const uint8_t *entry, const uint8_t *data,
+                size_t size, uint8_t *out)
+{
+  struct gcm_aes256_ctx gcm;
+
+  gcm_aes256_set_key(&gcm, key);
+  gcm_aes256_set_iv(&gcm, GCM_IV_SIZE, entry + STORE_ENTRY_NONCE);
+  gcm_aes256_update(&gcm, STORE_ENTRY_AAD_SIZE, entry);
+  gcm_aes256_encrypt(&gcm, size, out, data);
+  gcm_aes256_digest(&gcm, GCM_DIGEST_SIZE, out + size);
+  utils_wipe(&gcm, sizeof(gcm));
+}
+
+/** decrypt and authenticate record of entry into data */
+static int
+_decrypt_record(const store_t *ctx, uint32_t index, uint8_t *data, size_t *size)
+{
+  struct gcm_aes256_ctx gcm;
+  uint8_t tag[GCM_DIGEST_SIZE];
+  const uint8_t *entry;
+  uint32_t offset, length;
+
+  if (!ctx->unlocked || index >= ctx->entry_count)
+    return -1;
+
+  entry = _store_entry(ctx, index);
+  offset = utils_in_u32_be(entry + STORE_ENTRY_OFFSET);
+  length = utils_in_u32_be(entry + STORE_ENTRY_SIZE_FIELD);
+
+  if (length < GCM_DIGEST_SIZE || (uint64_t)offset + length > ctx->size
+      || length - GCM_DIGEST_SIZE > *size)
+    return -2;
+
+  length -= GCM_DIGEST_SIZE;
+
+  gcm_aes256_set_key(&gcm, ctx->key);
+  gcm_aes256_set_iv(&gcm, GCM_IV_SIZE, entry + STORE_ENTRY_NONCE);
+  gcm_aes256_update(&gcm, STORE_ENTRY_AAD_SIZE, entry);
+  gcm_aes256_decrypt(&gcm, length, data, ctx->map + offset);
+  gcm_aes256_digest(&gcm, sizeof(tag), tag);
+  utils_wipe(&gcm, sizeof(gcm));
+
+  if (!memeql_sec(tag, ctx->map + offset + length, sizeof(tag))) {
+    utils_wipe(data, length);
+    return -3;
+  }
+
+  *size = length;
+  return 0;
+}
+
+/** find section in decrypted record, records are a list of type, length, data */
+static const uint8_t *
+_record_section(const uint8_t *record, size_t size, uint8_t type, size_t *length)
+{
+  const uint8_t *p = record;
+
+  while (p + 2 <= record + size) {
+    if (p + 2 + p[1] > record + size)
+      return NULL;
+
+    if (p[0] == type) {
+      *length = p[1];
+      return p + 2;
+    }
+    p += 2 + p[1];
+  }
+
+  return NULL;
+}
+
+int
+store_words(const store_t *ctx, uint32_t index, uint16_t *words, size_t *count)
+{
+  uint8_t record[STORE_RECORD_SIZE];
+  size_t record_size = sizeof(record), length;
+  const uint8_t *section;
+  int res = 0;
+
+  if (_decrypt_record(ctx, index, record, &record_size) != 0)
+    return -1;
+
+  section = _record_section(record, record_size, STORE_SECTION_MNEMONIC, &length);
+  if (section == NULL)
+    res = -2;
+  else if (length / 2 > *count)
+    res = -3;
+  else {
+    *count = length / 2;
+    for (size_t i = 0; i < *count; i++)
+      words[i] = utils_in_u16_be(section + i * 2) & 0x07ff;
+  }
+
+  utils_wipe(record, sizeof(record));
+  return res;
+}
+
+int
+store_entropy(const store_t *ctx, uint32_t index, uint8_t *entropy, size_t *size)
+{
+  uint16_t words[STORE_MAX_WORDS];
+  uint8_t bits[STORE_MAX_WORDS * 11 / 8 + 1] = { 0 }, digest[SHA256_DIGEST_SIZE];
+  size_t count = STORE_MAX_WORDS, bytes, checksum_bits;
+  struct sha256_ctx sha256;
+  int res = 0;
+
+  if (store_words(ctx, index, words, &count) != 0)
+    return -1;
+
+  // 11 bits per word, the last word ends with entropy bits / 32 checksum bits
+  for (size_t i = 0; i < count * 11; i++) {
+    if (words[i / 11] & (0x400 >> (i % 11)))
+      bits[i / 8] |= 0x80 >> (i % 8);
+  }
+
+  bytes = count * 11 * 32 / 33 / 8;
+  checksum_bits = count * 11 - bytes * 8;
+  if (count == 0 || count % 3 != 0 || bytes > *size) {
+    res = -2;
+    goto out;
+  }
+
+  sha256_init(&sha256);
+  sha256_update(&sha256, bytes, bits);
+  sha256_digest(&sha256, sizeof(digest), digest);
+  if ((digest[0] ^ bits[bytes]) >> (8 - checksum_bits) != 0) {
+    res = -3;
+    goto out;
+  }
+
+  memcpy(entropy, bits, bytes);
+  *size = bytes;
+
+ out:
+  utils_wipe(words, sizeof(words));
+  utils_wipe(bits, sizeof(bits));
+  utils_wipe(digest, sizeof(digest));
+  return res;
+}
+
+int
+store_mnemonics(const store_t *ctx, uint32_t index, uint8_t *data, size_t *size)
+{
+  uint8_t record[STORE_RECORD_SIZE];
+  size_t record_size = sizeof(record), length;
+  const uint8_t *words;
+  int res;
+
+  if (_decrypt_record(ctx, index, record, &record_size) != 0)
+    return -1;
+
+  words = _record_section(record, record_size, STORE_SECTION_MNEMONIC, &length);
+  if (words == NULL) {
+    utils_wipe(record, sizeof(record));
+    return -2;
+  }
+
+  res = _data_to_mnemonics(words, length / 2, data, size);
+  utils_wipe(record, sizeof(record));
+  return res == 0 ? 0 : -3;
+}
+
+/**
+ * Write a new store file with the entries of current, if any, except
+ * the one with label, and a new entry for label holding record. The
+ * file is written aside and renamed into place. Existing records are
+ * encrypted again when key differs from the key of current.
+ */
+static int
+_store_write(const char *filename, const store_t *current,
+             uint32_t iterations, const uint8_t *salt, const uint8_t *key,
+             const char *label, const uint8_t *fingerprint, uint8_t sections,
+             const uint8_t *record, size_t record_size)
+{
+  char file[2048], tmpfile[2100];
+  uint32_t entry_count = 0, slot_count = STORE_MIN_SLOTS;
+  size_t size, offset;
+  uint8_t *buf, *entries, *entry;
+  uint8_t plain[STORE_RECORD_SIZE];
+  int replaced = -1, res = 0;
+  bool rekey = false;
+
+  if (_store_filename(filename, file, sizeof(file)) != 0)
+    return -1;
+
+  if (current != NULL) {
+    rekey = memcmp(current->key, key, KEY_SIZE) != 0;
+    entry_count = current->entry_count;
+    replaced = store_find_by_label(current, label);
+    if (replaced == -1)
+      entry_count++;
+  }
   else
-    realpath(file, filename);
+    entry_count = 1;
+
+  while (slot_count < entry_count * 2)
+    slot_count *= 2;
+
+  size = STORE_HEADER_SIZE + (size_t)slot_count * 8 + (size_t)entry_count * STORE_ENTRY_SIZE;
+  offset = size;
+  if (current != NULL) {
+    for (uint32_t i = 0; i < current->entry_count; i++) {
+      if ((int)i != replaced)
+        size += utils_in_u32_be(_store_entry(current, i) + STORE_ENTRY_SIZE_FIELD);
+    }
+  }
+  size += record_size + GCM_DIGEST_SIZE;
+
+  buf = calloc(1, size);
+  if (buf == NULL)
+    return -2;
+
+  // header
+  memcpy(buf + STORE_HEADER_MAGIC, STORE_MAGIC, 8);
+  utils_out_u16_be(buf + STORE_HEADER_VERSION, STORE_VERSION);
+  utils_out_u32_be(buf + STORE_HEADER_ENTRY_COUNT, entry_count);
+  utils_out_u32_be(buf + STORE_HEADER_SLOT_COUNT, slot_count);
+  buf[STORE_HEADER_KDF] = STORE_KDF_PBKDF2_HMAC_SHA512;
+  utils_out_u32_be(buf + STORE_HEADER_ITERATIONS, iterations);
+  memcpy(buf + STORE_HEADER_SALT, salt, STORE_SALT_SIZE);
+  _key_check(key, buf + STORE_HEADER_CHECK);
+
+  // entries, existing records are copied as is, they are bound to their
+  // entry and not to their location in the file
+  entries = buf + STORE_HEADER_SIZE + (size_t)slot_count * 8;
+  entry = entries;
+  if (current != NULL) {
+    for (uint32_t i = 0; i < current->entry_count; i++) {
+      const uint8_t *pentry = _store_entry(current, i);
+      uint32_t record_offset = utils_in_u32_be(pentry + STORE_ENTRY_OFFSET);
+      uint32_t length = utils_in_u32_be(pentry + STORE_ENTRY_SIZE_FIELD);
+
+      if ((int)i == replaced)
+        continue;
+
+      if ((uint64_t)record_offset + length > current->size) {
+        res = -4;
+        goto out;
+      }
+
+      memcpy(entry, pentry, STORE_ENTRY_SIZE);
+      utils_out_u32_be(entry + STORE_ENTRY_OFFSET, offset);
+
+      if (rekey) {
+        size_t plain_size = sizeof(plain);
+        if (_decrypt_record(current, i, plain, &plain_size) != 0
+            || utils_fill_random(entry + STORE_ENTRY_NONCE, GCM_IV_SIZE) != 0)
+        {
+          res = -4;
+          goto out;
+        }
+        _encrypt_record(key, entry, plain, plain_size, buf + offset);
+      }
+      else
+        memcpy(buf + offset, current->map + record_offset, length);
+
+      offset += length;
+      entry += STORE_ENTRY_SIZE;
+    }
+  }
+
+  strncpy((char *)entry + STORE_ENTRY_LABEL, label, STORE_LABEL_SIZE - 1);
+  memcpy(entry + STORE_ENTRY_FINGERPRINT, fingerprint, 4);
+  entry[STORE_ENTRY_SECTIONS] = sections;
+  utils_out_u32_be(entry + STORE_ENTRY_OFFSET, offset);
+  utils_out_u32_be(entry + STORE_ENTRY_SIZE_FIELD, record_size + GCM_DIGEST_SIZE);
+  if (utils_fill_random(entry + STORE_ENTRY_NONCE, GCM_IV_SIZE) != 0) {
+    res = -3;
+    goto out;
+  }
 
-  int out = open(file, O_RDONLY);
+  _encrypt_record(key, entry, record, record_size, buf + offset);
+
+  // label and fingerprint slot tables
+  memset(buf + STORE_HEADER_SIZE, 0xff, (size_t)slot_count * 8);
+  for (uint32_t i = 0; i < entry_count; i++) {
+    const uint8_t *pentry = entries + (size_t)i * STORE_ENTRY_SIZE;
+    uint32_t hashes[2] = {
+      _label_hash((const char *)pentry + STORE_ENTRY_LABEL),
+      _fingerprint_hash(pentry + STORE_ENTRY_FINGERPRINT),
+    };
+
+    for (int table = 0; table < 2; table++) {
+      uint8_t *slots = buf + STORE_HEADER_SIZE + (size_t)table * slot_count * 4;
+      uint32_t slot = hashes[table] & (slot_count - 1);
+      while (utils_in_u32_be(slots + slot * 4) != STORE_SLOT_EMPTY)
+        slot = (slot + 1) & (slot_count - 1);
+      utils_out_u32_be(slots + slot * 4, i);
+    }
+  }
+
+  snprintf(tmpfile, sizeof(tmpfile), "%s.tmp", file);
+  int out = open(tmpfile, O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
   if (out == -1) {
     perror("open failed with reason");
-    return -1;
+    res = -5;
+    goto out;
   }
 
-  read(out, data, size);
+  if (write(out, buf, size) != (ssize_t)size || fsync(out) != 0) {
+    close(out);
+    unlink(tmpfile);
+    res = -6;
+    goto out;
+  }
   close(out);
 
-  return 0;
+  if (rename(tmpfile, file) != 0) {
+    unlink(tmpfile);
+    res = -7;
+  }
+
+ out:
+  utils_wipe(plain, sizeof(plain));
+  free(buf);
+  return res;
 }
 
-int
-store_write_mnemonics(const char *filename, const char *password, const uint8_t *mnemonics)
+static int
+_wallet_seed(const uint8_t *words, size_t count, const char *passphrase, uint8_t *seed)
 {
-  uint8_t block[128] = {0};
-  uint8_t data[128] = {0};
+  uint8_t sentence[STORE_MAX_WORDS * 9];
+  size_t size = sizeof(sentence);
+  bip39_t bip39;
   int res;
+
+  if (_data_to_mnemonics(words, count, sentence, &size) != 0)
+    return -1;
+
+  bip39_init(&bip39);
+  res = bip39_to_seed(&bip39, sentence, size, 2048, (const uint8_t *)passphrase, seed);
+  utils_wipe(sentence, sizeof(sentence));
+  return res == 0 ? 0 : -2;
+}
+
+static uint8_t *
+_record_append(uint8_t *p, uint8_t type, const uint8_t *data, size_t size)
+{
+  p[0] = type;
+  p[1] = size;
+  memcpy(p + 2, data, size);
+  return p + 2 + size;
+}
+
+/** read single wallet store files written before the indexed format */
+static int
+_store_read_legacy(const char *filename, const char *password, uint8_t *data, size_t *size)
+{
+  static const char *salt = "btct_store_password";
+  uint8_t block[128], decrypted_block[128];
   uint8_t key[KEY_SIZE];
-  struct aes_ctx aes;
+  struct aes256_ctx aes;
+  char file[2048];
+  size_t count = 0;
+  int in, res;
+
+  if (_store_filename(filename, file, sizeof(file)) != 0)
+    return -1;
 
-  // derive key from password
-  _derive_key(password, &key);
+  in = open(file, O_RDONLY | O_CLOEXEC);
+  if (in == -1)
+    return -1;
 
-  // fill block with random data
-  if (utils_fill_random(block, sizeof(block)) != 0)
+  res = read(in, block, sizeof(block));
+  close(in);
+  if (res != sizeof(block))
     return -1;
 
-  // write mnemonics indicies to block
-  res = _mnemonics_to_data(mnemonics, block);
-  if (res == -1)
+  _derive_key(password, (const uint8_t *)salt, strlen(salt), 4096, key);
+  aes256_set_decrypt_key(&aes, key);
+  aes256_decrypt(&aes, sizeof(block), decrypted_block, block);
+  utils_wipe(key, sizeof(key));
+  utils_wipe(&aes, sizeof(aes));
+
+  while (count < STORE_MAX_WORDS && utils_in_u16_be(decrypted_block + count * 2) <= 0x07ff)
+    count++;
+
+  // the block is not authenticated, a wrong password shows as words out of range
+  if (count < 12 || count % 3 != 0 || utils_in_u16_be(decrypted_block + count * 2) != 0xffff)
+    res = -2;
+  else
+    res = _data_to_mnemonics(decrypted_block, count, data, size);
+  utils_wipe(decrypted_block, sizeof(decrypted_block));
+  return res;
+}
+
+/** add wallet to the store of filename, create ignores an existing file and writes a new store */
+static int
+_store_write_wallet(const char *filename, const char *password, const char *label,
+                    const uint8_t *mnemonics, const char *passphrase, uint8_t sections,
+                    uint32_t iterations, bool create)
+{
+  uint8_t record[STORE_RECORD_SIZE], *precord = record;
+  uint8_t words[STORE_MAX_WORDS * 2], seed[64], masterkey[64];
+  uint8_t fingerprint[4];
+  uint8_t salt[STORE_SALT_SIZE], key[KEY_SIZE];
+  bip32_key_identifier_t ident;
+  bip32_key_t master;
+  store_t store, *current = NULL;
+  int count, res = -3;
+
+  if (label == NULL)
+    label = STORE_DEFAULT_LABEL;
+
+  if (strlen(label) == 0 || strlen(label) >= STORE_LABEL_SIZE)
+    return -1;
+
+  count = _mnemonics_to_data((const char *)mnemonics, words);
+  if (count < 12)
     return -2;
 
-  // add marker for end of mnemonics
-  block[res*2] = 0xff;
-  block[1 + res*2] = 0xff;
+  // fingerprint of the masterkey the wallet is used with
+  if (_wallet_seed(words, count, passphrase, seed) == 0
+      && bip32_key_init_from_entropy(&master, seed, sizeof(seed)) == 0
+      && bip32_key_identifier_init_from_key(ident, &master) == 0
+      && bip32_key_identifier_fingerprint(ident, fingerprint) == 0)
+    res = 0;
+
+  sections |= STORE_SECTION_MNEMONIC;
+  precord = _record_append(precord, STORE_SECTION_MNEMONIC, words, count * 2);
+  if (sections & STORE_SECTION_SEED)
+    precord = _record_append(precord, STORE_SECTION_SEED, seed, sizeof(seed));
+  if (sections & STORE_SECTION_MASTERKEY) {
+    memcpy(masterkey, master.chain, 32);
+    memcpy(masterkey + 32, master.key.private, 32);
+    precord = _record_append(precord, STORE_SECTION_MASTERKEY, masterkey, sizeof(masterkey));
+  }
 
-  // encrypt block
-  aes_set_encrypt_key(&aes, KEY_SIZE, key);
-  aes_encrypt(&aes, sizeof(block), data, (uint8_t*)block);
+  utils_wipe(seed, sizeof(seed));
+  utils_wipe(masterkey, sizeof(masterkey));
+  utils_wipe(&master, sizeof(master));
+  if (res != 0)
+    goto out;
+
+  res = create ? -1 : store_open(&store, filename);
+  if (res == 0) {
+    if (store_unlock(&store, password) != 0) {
+      store_close(&store);
+      res = -4;
+      goto out;
+    }
+    current = &store;
+  }
+  else if (!create && !(res == -1 && errno == ENOENT)) {
+    res = -5;
+    goto out;
+  }
 
-  // write to file
-  _write_store_file(filename, data, sizeof(data));
-  return 0;
+  if (current != NULL && (iterations == 0 || iterations == store.iterations)) {
+    iterations = store.iterations;
+    memcpy(salt, store.salt, sizeof(salt));
+    memcpy(key, store.key, sizeof(key));
+  }
+  else {
+    // new store or new kdf cost, both get a fresh random salt
+    if (iterations == 0)
+      iterations = STORE_DEFAULT_ITERATIONS;
+    if (utils_fill_random(salt, sizeof(salt)) != 0) {
+      res = -5;
+      goto cleanup;
+    }
+    _derive_key(password, salt, sizeof(salt), iterations, key);
+  }
+
+  res = _store_write(filename, current, iterations, salt, key, label, fingerprint,
+                     sections, record, precord - record);
+  if (res != 0)
+    res = -6;
+
+ cleanup:
+  if (current != NULL)
+    store_close(current);
+
+ out:
+  utils_wipe(record, sizeof(record));
+  utils_wipe(words, sizeof(words));
+  utils_wipe(key, sizeof(key));
+  return res;
 }
 
-int store_read_mnemonics(const char *filename, const char *password,
-                         uint8_t *data, size_t *size)
+/** rewrite a single wallet store file of the old format as the default wallet of an indexed store */
+static int
+_store_migrate_legacy(const char *filename, const char *password, uint32_t iterations)
 {
-  uint8_t block[128];
-  uint8_t decrypted_block[128];
-  uint8_t key[KEY_SIZE];
-  struct aes_ctx aes;
+  uint8_t sentence[STORE_MAX_WORDS * 9];
+  size_t size = sizeof(sentence);
+  int res;
+
+  if (_store_read_legacy(filename, password, sentence, &size) != 0)
+    return -1;
 
-  // derive key from password
-  _derive_key(password, &key);
+  res = _store_write_wallet(filename, password, STORE_DEFAULT_LABEL, sentence, NULL,
+                            STORE_SECTION_MNEMONIC, iterations, true);
+  utils_wipe(sentence, sizeof(sentence));
+  return res;
+}
+
+int
+store_migrate(const char *filename, const char *password, uint32_t iterations)
+{
+  store_t store;
+  int res;
 
-  // read file from store
-  if (_read_store_file(filename, block, sizeof(block)) != 0)
+  res = store_open(&store, filename);
+  if (res == 0) {
+    store_close(&store);
+    return 0;
+  }
+  else if (res != -4)
     return -1;
 
-  // decrypt using aes
-  aes_set_decrypt_key(&aes, KEY_SIZE, key);
-  aes_decrypt(&aes, sizeof(block), decrypted_block, block);
+  return _store_migrate_legacy(filename, password, iterations) == 0 ? 0 : -2;
+}
 
-  // create mnemonics from data
-  uint8_t *pdata = decrypted_block;
-  uint8_t cnt = 1;
+int
+store_write_wallet(const char *filename, const char *password, const char *label,
+                   const uint8_t *mnemonics, const char *passphrase, uint8_t sections,
+                   uint32_t iterations)
+{
+  // an old single wallet store becomes the default wallet of the new one before adding to it
+  if (store_migrate(filename, password, iterations) == -2)
+    return -7;
 
-  while(cnt <= 24) {
-    uint16_t idx =  utils_in_u16_be(pdata);
-    if (idx == 0xffff)
-      break;
-    else if(pdata != decrypted_block)
-      fputs(" ", stdout);
+  return _store_write_wallet(filename, password, label, mnemonics, passphrase, sections,
+                             iterations, false);
+}
 
-    idx = idx & 0x07ff;
+int
+store_write_mnemonics(const char *filename, const char *password,
+                      const char *label, const uint8_t *mnemonics)
+{
+  return store_write_wallet(filename, password, label, mnemonics, NULL, STORE_SECTION_MNEMONIC, 0);
+}
 
-    fputs(bip39_english[idx], stdout);
+int
+store_seed(const store_t *ctx, uint32_t index, const char *passphrase, uint8_t *seed)
+{
+  uint8_t record[STORE_RECORD_SIZE];
+  size_t record_size = sizeof(record), length;
+  const uint8_t *section;
+  int res = -2;
 
-    pdata += 2;
-    cnt++;
+  if (_decrypt_record(ctx, index, record, &record_size) != 0)
+    return -1;
+
+  // a given passphrase may not be the one of the cache, derive the seed it asks for
+  if (passphrase == NULL
+      && (section = _record_section(record, record_size, STORE_SECTION_SEED, &length)) != NULL
+      && length == 64)
+  {
+    memcpy(seed, section, length);
+    res = 0;
   }
+  else if ((section = _record_section(record, record_size, STORE_SECTION_MNEMONIC, &length)) != NULL)
+    res = _wallet_seed(section, length / 2, passphrase, seed) == 0 ? 0 : -3;
 
-  return 0;
+  utils_wipe(record, sizeof(record));
+  return res;
+}
+
+int
+store_masterkey(const store_t *ctx, uint32_t index, const char *passphrase, bip32_key_t *key)
+{
+  uint8_t record[STORE_RECORD_SIZE], seed[64];
+  size_t record_size = sizeof(record), length;
+  const uint8_t *section;
+  int res = -2;
+
+  if (_decrypt_record(ctx, index, record, &record_size) != 0)
+    return -1;
+
+  // use the cheapest cached form, only mnemonics requires the bip39 kdf. The caches
+  // hold the wallet of the passphrase given at import, a given passphrase derives
+  // the wallet it asks for from mnemonics
+  if (passphrase == NULL
+      && (section = _record_section(record, record_size, STORE_SECTION_MASTERKEY, &length)) != NULL
+      && length == 64)
+  {
+    memset(key, 0, sizeof(bip32_key_t));
+    memcpy(key->chain, section, 32);
+    memcpy(key->key.private, section + 32, 32);
+    res = 0;
+  }
+  else if (passphrase == NULL
+           && (section = _record_section(record, record_size, STORE_SECTION_SEED, &length)) != NULL
+           && length == 64)
+  {
+    res = bip32_key_init_from_entropy(key, (uint8_t *)section, length) == 0 ? 0 : -3;
+  }
+  else if ((section = _record_section(record, record_size, STORE_SECTION_MNEMONIC, &length)) != NULL)
+  {
+    if (_wallet_seed(section, length / 2, passphrase, seed) == 0
+        && bip32_key_init_from_entropy(key, seed, sizeof(seed)) == 0)
+      res = 0;
+    else
+      res = -4;
+  }
+
+  utils_wipe(record, sizeof(record));
+  utils_wipe(seed, sizeof(seed));
+  return res;
+}
+
+int
+store_read_mnemonics(const char *filename, const char *password,
+                     const char *label, uint8_t *data, size_t *size)
+{
+  store_t store;
+  int index, res;
+
+  res = store_open(&store, filename);
+  if (res == -4 && (label == NULL || strcmp(label, STORE_DEFAULT_LABEL) == 0))
+    return _store_read_legacy(filename, password, data, size) == 0 ? 0 : -1;
+  if (res != 0)
+    return -1;
+
+  if (store_unlock(&store, password) != 0) {
+    store_close(&store);
+    return -2;
+  }
+
+  index = store_find_by_label(&store, label != NULL ? label : STORE_DEFAULT_LABEL);
+  if (index < 0) {
+    store_close(&store);
+    return -3;
+  }
+
+  res = store_mnemonics(&store, index, data, size);
+  store_close(&store);
+
+  return res == 0 ? 0 : -4;
 }
@@ -1,8 +1,114 @@
 #ifndef __store_h__
 #define __store_h__
 
-int store_write_mnemonics(const char *filename, const char *password, const uint8_t *mnemonics);
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "bip32.h"
+
+#define STORE_KEY_SIZE 32
+#define STORE_SALT_SIZE 32
+#define STORE_LABEL_SIZE 32
+#define STORE_DEFAULT_LABEL "default"
+
+/** sections held by the encrypted record of a wallet */
+#define STORE_SECTION_MNEMONIC 0x01
+#define STORE_SECTION_SEED 0x02
+#define STORE_SECTION_MASTERKEY 0x04
+
+/**
+ * Store file layout, all integers are big endian:
+ *
+ *   header      128 bytes, magic, version, counts and KDF parameters
+ *   label slots slot_count u32 entry numbers, open addressed by label hash
+ *   fp slots    slot_count u32 entry numbers, open addressed by fingerprint
+ *   entries     entry_count * 64 bytes, label, fingerprint, sections and
+ *               location and nonce of the encrypted record
+ *   records     AES-256-GCM encrypted records with 16 byte tag appended
+ *
+ * The file is mapped read only, finding a wallet by label or fingerprint
+ * touches one slot and one entry and only that record is decrypted.
+ */
+typedef struct store_t {
+  int fd;
+  const uint8_t *map;
+  size_t size;
+  uint32_t entry_count;
+  uint32_t slot_count;
+  uint32_t iterations;
+  uint8_t salt[STORE_SALT_SIZE];
+  uint8_t key[STORE_KEY_SIZE];
+  bool unlocked;
+} store_t;
+
+typedef struct store_entry_t {
+  char label[STORE_LABEL_SIZE];
+  uint8_t fingerprint[4];
+  uint8_t sections;
+} store_entry_t;
+
+/** map store file, default file ~/.btct.dat if filename is NULL */
+int store_open(store_t *ctx, const char *filename);
+/** derive store key from password, fails if password does not match */
+int store_unlock(store_t *ctx, const char *password);
+void store_close(store_t *ctx);
+
+int store_entry(const store_t *ctx, uint32_t index, store_entry_t *entry);
+/** index of entry with label or fingerprint, -1 if not found */
+int store_find_by_label(const store_t *ctx, const char *label);
+int store_find_by_fingerprint(const store_t *ctx, const uint8_t *fingerprint);
+/** decrypt bip39 word indices of entry, count is the capacity of words */
+int store_words(const store_t *ctx, uint32_t index, uint16_t *words, size_t *count);
+/** decrypt entropy of entry, the mnemonics with checksum verified and removed */
+int store_entropy(const store_t *ctx, uint32_t index, uint8_t *entropy, size_t *size);
+/** decrypt mnemonics of entry into data as a nul terminated sentence */
+int store_mnemonics(const store_t *ctx, uint32_t index, uint8_t *data, size_t *size);
+/**
+ * Decrypt the 64 byte bip39 seed of entry, from the cached seed if the
+ * wallet has one and passphrase is NULL. A passphrase always derives the
+ * seed from mnemonics, the cache holds the seed of the import passphrase.
+ */
+int store_seed(const store_t *ctx, uint32_t index, const char *passphrase, uint8_t *seed);
+/**
+ * Decrypt masterkey of entry, from the cached masterkey or seed if the
+ * wallet has one and passphrase is NULL. A passphrase always derives the
+ * masterkey from mnemonics.
+ */
+int store_masterkey(const store_t *ctx, uint32_t index, const char *passphrase, bip32_key_t *key);
+
+/**
+ * Number of PBKDF2-HMAC-SHA512 iterations that takes about target_ms
+ * to derive the store key on this host.
+ */
+uint32_t store_calibrate_iterations(uint32_t target_ms);
+
+/**
+ * Rewrite a store file of the old single wallet format as an indexed
+ * store holding its wallet as the default wallet, iterations sets the kdf
+ * cost of the new store, 0 for the default. A store of the current format
+ * is left as is. Returns -1 if the file could not be opened and -2 if the
+ * old store could not be read with password.
+ */
+int store_migrate(const char *filename, const char *password, uint32_t iterations);
+
+/**
+ * Add or replace wallet with label, the store is created if missing.
+ * Sections selects if the bip39 seed and masterkey, derived using
+ * passphrase, are cached next to the mnemonics. Iterations sets the
+ * kdf cost, the store is rekeyed with a new salt when it differs from
+ * the current cost, 0 keeps the cost of an existing store.
+ *
+ * A store file of the old single wallet format is first migrated, its
+ * wallet becomes the default wallet. This needs the password of the old
+ * store and returns -7 if it could not be read.
+ */
+int store_write_wallet(const char *filename, const char *password, const char *label,
+                       const uint8_t *mnemonics, const char *passphrase, uint8_t sections,
+                       uint32_t iterations);
+int store_write_mnemonics(const char *filename, const char *password,
+                          const char *label, const uint8_t *mnemonics);
 int store_read_mnemonics(const char *filename, const char *password,
-                         uint8_t *data, size_t *size);
+                         const char *label, uint8_t *data, size_t *size);
 
 #endif
@@ -2,6 +2,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 #include <termios.h>
 #include <limits.h>
 #include <inttypes.h>
@@ -10,6 +11,9 @@
 #include "command.h"
 #include "bip32.h"
 #include "bip39.h"
+#include "utils.h"
+#include "store.h"
+#include "agent.h"
 
 static
 int _input(const char *prompt, bool echo, char *result, size_t size)
@@ -23,7 +27,6 @@ int _input(const char *prompt, bool echo, char *result, size_t size)
     tcsetattr(fileno(stdin), 0, &term); 
   }
 
-  freopen(NULL, "rt", stdin);
   fprintf(stderr, "%s: ", prompt);
   res = fgets(result, size, stdin);
 
@@ -39,11 +42,57 @@ int _input(const char *prompt, bool echo, char *result, size_t size)
   return 0;
 }
 
+/** parse unlock target as milliseconds, "250", "250ms" or "2s" */
+static int
+_parse_unlock_target(const char *arg, uint32_t *target_ms)
+{
+  char *end;
+  unsigned long value = strtoul(arg, &end, 10);
+
+  if (end == arg)
+    return -1;
+
+  if (strcmp(end, "s") == 0)
+    value *= 1000;
+  else if (*end != '\0' && strcmp(end, "ms") != 0)
+    return -1;
+
+  if (value == 0 || value > 600000)
+    return -1;
+
+  *target_ms = value;
+  return 0;
+}
+
+/** benchmark the kdf and report the iterations picked for target */
+static uint32_t
+_calibrate(const char *command, uint32_t target_ms)
+{
+  uint32_t iterations = store_calibrate_iterations(target_ms);
+  fprintf(stderr, "%s: using %" PRIu32 " PBKDF2 iterations for %" PRIu32 "ms unlock\n",
+          command, iterations, target_ms);
+  return iterations;
+}
+
+/** report a failed store_write_wallet, an old format store needs its own password */
+static void
+_store_write_error(const char *command, const char *filename, int res)
+{
+  const char *file = filename != NULL ? filename : "~/.btct.dat";
+
+  if (res == -7)
+    fprintf(stderr, "%s: %s is an old single wallet store and could not be migrated, "
+            "enter the password of that store to keep its wallet as '%s'\n",
+            command, file, STORE_DEFAULT_LABEL);
+  else
+    fprintf(stderr, "%s: failed to store into file %s\n", command, file);
+}
 
 #define PROPOSE_CNT 5
 
 static int
-_store_init(const char *filename, uint32_t bits)
+_store_init(const char *filename, const char *label, uint32_t bits,
+            const char *passphrase, uint8_t sections, uint32_t iterations)
 {
   bip32_key_t key;
   bip39_t bip39;
@@ -52,20 +101,23 @@ _store_init(const char *filename, uint32_t bits)
   char password[512] = {0};
   char **mnemonics;
   size_t mnemonics_cnt;
+  int res;
 
   if (bits != 128 && bits != 256) {
     fprintf(stderr, "store.init: Unsupported bit count %d, use 128 or 256bit\n", bits);
     return EXIT_FAILURE;
   }
 
-  int h = open("/dev/urandom", O_RDONLY);
-  for (size_t i = 0; i < PROPOSE_CNT; i++)
-    read(h, seed[i], (bits/8));
-  close(h);
+  for (size_t i = 0; i < PROPOSE_CNT; i++) {
+    if (utils_fill_random(seed[i], bits/8) != 0) {
+      fputs("store.init: failed to generate random seed\n", stderr);
+      return EXIT_FAILURE;
+    }
+  }
 
   bip39_init(&bip39);
 
-  fputs("Here follows a list of 10 seeds from /dev/urandom, choose any of them by the number\n"
+  fputs("Here follows a list of randomly generated seeds, choose any of them by the number\n"
         "when prompt to be stored and used.\n"
         "\n"
         , stdout);
@@ -110,9 +162,11 @@ _store_init(const char *filename, uint32_t bits)
       strcat(buf, " ");
   }
 
-  if (store_write_mnemonics(filename, password, buf, strlen(buf)) != 0)
+  res = store_write_wallet(filename, password, label, (uint8_t *)buf, passphrase, sections,
+                           iterations);
+  if (res != 0)
   {
-    fprintf(stderr, "failed to store into file %s\n", filename);
+    _store_write_error("store.init", filename, res);
     return EXIT_FAILURE;
   }
   
@@ -128,6 +182,17 @@ _store_init_command_usage(void)
     fputs("                          is 128bits entropy, which creates a 12 word mnemoninc seed phrase.\n", stderr);
     fputs("  -f, --file <filename>   Specify a file for the encrypted store with generated wallets.\n", stderr);
     fputs("                          Default store file is ~/btct_store.dat.\n", stderr);
+    fputs("  -l, --label <name>      Label of the wallet in the store, an existing wallet with\n", stderr);
+    fputs("                          the same label is replaced. Default label is '" STORE_DEFAULT_LABEL "'.\n", stderr);
+    fputs("  -p, --passphrase <text> Passphrase of the bip39 seed, used for the fingerprint of the\n", stderr);
+    fputs("                          wallet and applied to the cached seed and masterkey.\n", stderr);
+    fputs("  -s, --cache-seed        Also store the bip39 seed, unlocking skips the bip39 kdf.\n", stderr);
+    fputs("  -m, --cache-masterkey   Also store the masterkey, unlocking skips the bip39 kdf.\n", stderr);
+    fputs("  -u, --unlock-target <time>\n", stderr);
+    fputs("                          Benchmark this host and pick the PBKDF2 iteration count that\n", stderr);
+    fputs("                          unlocks the store in about time, eg. 250ms or 2s. An existing\n", stderr);
+    fputs("                          store is rekeyed with a new salt. Default keeps the cost of an\n", stderr);
+    fputs("                          existing store and uses 4096 iterations for a new one.\n", stderr);
     fputs("\n", stderr);
     fputs("examples:\n", stderr);
     fputs("\n", stderr);
@@ -145,18 +210,27 @@ _store_init_command(int argc, char **argv)
     int c;
     uint32_t bits = 128;
     const char *filename = NULL;
+    const char *label = STORE_DEFAULT_LABEL;
+    const char *passphrase = NULL;
+    uint8_t sections = STORE_SECTION_MNEMONIC;
+    uint32_t unlock_target = 0, iterations = 0;
 
     while (1)
     {
         int option_index = 0;
         static struct option long_options[] = {
             {"help",  no_argument, 0, 'h' },
-            {"bits",  no_argument, 0, 'b' },
-            {"filename",  no_argument, 0, 'f' },
+            {"bits",  required_argument, 0, 'b' },
+            {"filename",  required_argument, 0, 'f' },
+            {"label",  required_argument, 0, 'l' },
+            {"passphrase",  required_argument, 0, 'p' },
+            {"cache-seed",  no_argument, 0, 's' },
+            {"cache-masterkey",  no_argument, 0, 'm' },
+            {"unlock-target",  required_argument, 0, 'u' },
             {0, 0, 0, 0}
         };
 
-        c = getopt_long(argc, argv, "hf:b:", long_options, &option_index);
+        c = getopt_long(argc, argv, "hf:b:l:p:smu:", long_options, &option_index);
         if (c == -1)
             break;
 
@@ -172,24 +246,113 @@ _store_init_command(int argc, char **argv)
             case 'b':
               bits = atoi(optarg);
               break;
+
+            case 'l':
+                label = optarg;
+                break;
+
+            case 'p':
+                passphrase = optarg;
+                break;
+
+            case 's':
+                sections |= STORE_SECTION_SEED;
+                break;
+
+            case 'm':
+                sections |= STORE_SECTION_MASTERKEY;
+                break;
+
+            case 'u':
+                if (_parse_unlock_target(optarg, &unlock_target) != 0) {
+                    fprintf(stderr, "store.init: invalid unlock target '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
         }
     }
 
-    return _store_init(filename, bits);
+    if (unlock_target != 0)
+        iterations = _calibrate("store.init", unlock_target);
+
+    return _store_init(filename, label, bits, passphrase, sections, iterations);
 }
 
+/**
+ * Open store and find wallet by fingerprint if given, otherwise by label,
+ * returns -4 for a store of the old single wallet format.
+ */
 static int
-_store_read(const char *filename)
+_store_open_wallet(store_t *store, const char *filename, const char *label, const char *fingerprint)
+{
+  uint8_t fp[4];
+  int index, res;
+
+  // an old single wallet store is reported as such, it has to be migrated first
+  res = store_open(store, filename);
+  if (res == -4)
+    return -4;
+  else if (res != 0)
+    return -1;
+
+  if (fingerprint != NULL) {
+    if (strlen(fingerprint) != 8
+        || sscanf(fingerprint, "%2hhx%2hhx%2hhx%2hhx", fp, fp + 1, fp + 2, fp + 3) != 4)
+    {
+      store_close(store);
+      return -2;
+    }
+    index = store_find_by_fingerprint(store, fp);
+  }
+  else
+    index = store_find_by_label(store, label);
+
+  if (index < 0) {
+    store_close(store);
+    return -3;
+  }
+
+  return index;
+}
+
+static int
+_store_read_by_fingerprint(const char *filename, const char *password, const char *fingerprint,
+                           uint8_t *mnemonics, size_t *size)
+{
+  store_t store;
+  int index, res = -1;
+
+  index = _store_open_wallet(&store, filename, NULL, fingerprint);
+  if (index < 0)
+    return -1;
+
+  if (store_unlock(&store, password) == 0)
+    res = store_mnemonics(&store, index, mnemonics, size);
+
+  store_close(&store);
+  return res;
+}
+
+static int
+_store_read(const char *filename, const char *label, const char *fingerprint)
 {
   char mnemonics[2048] = {0};
   size_t size = sizeof(mnemonics);
   char password[256]={0};
+  int res;
 
   // prompt for password
   _input("Enter password for store", false, password, sizeof(password));
 
-  if (store_read_mnemonics(filename, password, mnemonics, &size) != 0)
+  if (fingerprint != NULL)
+    res = _store_read_by_fingerprint(filename, password, fingerprint, (uint8_t *)mnemonics, &size);
+  else
+    res = store_read_mnemonics(filename, password, label, (uint8_t *)mnemonics, &size);
+
+  if (res != 0) {
+    fputs("store.read: failed to read wallet from store\n", stderr);
     return EXIT_FAILURE;
+  }
 
   fputs(mnemonics, stdout);
 
@@ -203,6 +366,8 @@ _store_read_command_usage(void)
     fputs("\n", stderr);
     fputs("  -f, --file <filename>   Specify a file for the encrypted store to read from.\n", stderr);
     fputs("                          Default store file is ~/.btct.dat.\n", stderr);
+    fputs("  -l, --label <name>      Label of the wallet to read, default is '" STORE_DEFAULT_LABEL "'.\n", stderr);
+    fputs("  -F, --fingerprint <hex> Read the wallet with masterkey fingerprint instead of label.\n", stderr);
     fputs("\n", stderr);
     fputs("examples:\n", stderr);
     fputs("\n", stderr);
@@ -218,17 +383,21 @@ _store_read_command(int argc, char **argv)
 {
     int c;
     const char *filename = NULL;
+    const char *label = STORE_DEFAULT_LABEL;
+    const char *fingerprint = NULL;
 
     while (1)
     {
         int option_index = 0;
         static struct option long_options[] = {
             {"help",  no_argument, 0, 'h' },
-            {"filename",  no_argument, 0, 'f' },
+            {"filename",  required_argument, 0, 'f' },
+            {"label",  required_argument, 0, 'l' },
+            {"fingerprint",  required_argument, 0, 'F' },
             {0, 0, 0, 0}
         };
 
-        c = getopt_long(argc, argv, "hf:", long_options, &option_index);
+        c = getopt_long(argc, argv, "hf:l:F:", long_options, &option_index);
         if (c == -1)
             break;
 
@@ -240,17 +409,27 @@ _store_read_command(int argc, char **argv)
             case 'f':
                 filename = optarg;
                 break;
+
+            case 'l':
+                label = optarg;
+                break;
+
+            case 'F':
+                fingerprint = optarg;
+                break;
         }
     }
 
-    return _store_read(filename);
+    return _store_read(filename, label, fingerprint);
 }
 
 static int
-_store_import(const char *filename)
+_store_import(const char *filename, const char *label, const char *passphrase, uint8_t sections,
+              uint32_t iterations)
 {
   char password[256]={0};
   uint8_t mnemonics[4096] = {0};
+  int res;
 
   // prompt for mnemonics
   _input("Enter mnemonics seed phrase", true, mnemonics, sizeof(mnemonics));
@@ -259,9 +438,11 @@ _store_import(const char *filename)
   _input("Enter password for store", false, password, sizeof(password));
 
   // write seed to store
-  if (store_write_mnemonics(filename, password, mnemonics, strlen(mnemonics)) != 0)
+  res = store_write_wallet(filename, password, label, mnemonics, passphrase, sections,
+                           iterations);
+  if (res != 0)
   {
-    fprintf(stderr, "failed to store into file %s\n", filename);
+    _store_write_error("store.import", filename, res);
     return EXIT_FAILURE;
   }
 
@@ -279,6 +460,17 @@ _store_import_command_usage(void)
     fputs("\n", stderr);
     fputs("  -f, --file <filename>   Specify a file for the encrypted store to read from.\n", stderr);
     fputs("                          Default store file is ~/.btct.dat.\n", stderr);
+    fputs("  -l, --label <name>      Label of the wallet in the store, an existing wallet with\n", stderr);
+    fputs("                          the same label is replaced. Default label is '" STORE_DEFAULT_LABEL "'.\n", stderr);
+    fputs("  -p, --passphrase <text> Passphrase of the bip39 seed, used for the fingerprint of the\n", stderr);
+    fputs("                          wallet and applied to the cached seed and masterkey.\n", stderr);
+    fputs("  -s, --cache-seed        Also store the bip39 seed, unlocking skips the bip39 kdf.\n", stderr);
+    fputs("  -m, --cache-masterkey   Also store the masterkey, unlocking skips the bip39 kdf.\n", stderr);
+    fputs("  -u, --unlock-target <time>\n", stderr);
+    fputs("                          Benchmark this host and pick the PBKDF2 iteration count that\n", stderr);
+    fputs("                          unlocks the store in about time, eg. 250ms or 2s. An existing\n", stderr);
+    fputs("                          store is rekeyed with a new salt. Default keeps the cost of an\n", stderr);
+    fputs("                          existing store and uses 4096 iterations for a new one.\n", stderr);
     fputs("\n", stderr);
 }
 
@@ -287,17 +479,26 @@ _store_import_command(int argc, char **argv)
 {
     int c;
     const char *filename = NULL;
+    const char *label = STORE_DEFAULT_LABEL;
+    const char *passphrase = NULL;
+    uint8_t sections = STORE_SECTION_MNEMONIC;
+    uint32_t unlock_target = 0, iterations = 0;
 
     while (1)
     {
         int option_index = 0;
         static struct option long_options[] = {
             {"help",  no_argument, 0, 'h' },
-            {"filename",  no_argument, 0, 'f' },
+            {"filename",  required_argument, 0, 'f' },
+            {"label",  required_argument, 0, 'l' },
+            {"passphrase",  required_argument, 0, 'p' },
+            {"cache-seed",  no_argument, 0, 's' },
+            {"cache-masterkey",  no_argument, 0, 'm' },
+            {"unlock-target",  required_argument, 0, 'u' },
             {0, 0, 0, 0}
         };
 
-        c = getopt_long(argc, argv, "hf:", long_options, &option_index);
+        c = getopt_long(argc, argv, "hf:l:p:smu:", long_options, &option_index);
         if (c == -1)
             break;
 
@@ -309,10 +510,759 @@ _store_import_command(int argc, char **argv)
             case 'f':
                 filename = optarg;
                 break;
+
+            case 'l':
+                label = optarg;
+                break;
+
+            case 'p':
+                passphrase = optarg;
+                break;
+
+            case 's':
+                sections |= STORE_SECTION_SEED;
+                break;
+
+            case 'm':
+                sections |= STORE_SECTION_MASTERKEY;
+                break;
+
+            case 'u':
+                if (_parse_unlock_target(optarg, &unlock_target) != 0) {
+                    fprintf(stderr, "store.import: invalid unlock target '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+        }
+    }
+
+    if (unlock_target != 0)
+        iterations = _calibrate("store.import", unlock_target);
+
+    return _store_import(filename, label, passphrase, sections, iterations);
+}
+
+/**
+ * Open store, find wallet and unlock it with password prompted for,
+ * returns index of the wallet with store left open or -1 on failure.
+ * A store of the old single wallet format is migrated first, its wallet
+ * becomes the default wallet.
+ */
+static int
+_store_unlock_wallet(const char *command, store_t *store, const char *filename,
+                     const char *label, const char *fingerprint)
+{
+  char password[256] = {0};
+  int index, res;
+
+  index = _store_open_wallet(store, filename, label, fingerprint);
+  if (index == -4) {
+    _input("Enter password for store", false, password, sizeof(password));
+
+    if (store_migrate(filename, password, 0) != 0) {
+      memset(password, 0, sizeof(password));
+      fprintf(stderr, "%s: %s is an old single wallet store and could not be migrated, "
+              "enter the password of that store to keep its wallet as '%s'\n",
+              command, filename != NULL ? filename : "~/.btct.dat", STORE_DEFAULT_LABEL);
+      return -1;
+    }
+
+    fprintf(stderr, "%s: migrated old single wallet store, its wallet is now '%s'\n",
+            command, STORE_DEFAULT_LABEL);
+    index = _store_open_wallet(store, filename, label, fingerprint);
+  }
+  else if (index >= 0) {
+    // prompt for password
+    _input("Enter password for store", false, password, sizeof(password));
+  }
+
+  if (index < 0) {
+    memset(password, 0, sizeof(password));
+    fprintf(stderr, "%s: wallet not found in store\n", command);
+    return -1;
+  }
+
+  res = store_unlock(store, password);
+  memset(password, 0, sizeof(password));
+  if (res != 0) {
+    fprintf(stderr, "%s: failed to unlock store\n", command);
+    store_close(store);
+    return -1;
+  }
+
+  return index;
+}
+
+static int
+_store_masterkey(const char *filename, const char *label, const char *fingerprint,
+                 const char *passphrase)
+{
+  uint8_t encoded[128];
+  size_t encoded_size = sizeof(encoded);
+  bip32_key_t master;
+  store_t store;
+  int index, res = -1;
+
+  index = _store_unlock_wallet("store.masterkey", &store, filename, label, fingerprint);
+  if (index < 0)
+    return EXIT_FAILURE;
+
+  if (store_masterkey(&store, index, passphrase, &master) == 0
+      && bip32_key_serialize(&master, true, encoded, &encoded_size) == 0)
+    res = 0;
+
+  memset(&master, 0, sizeof(master));
+  store_close(&store);
+
+  if (res != 0) {
+    fputs("store.masterkey: failed to read masterkey from store\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  fprintf(stdout, "%s\n", encoded);
+  memset(encoded, 0, sizeof(encoded));
+  return EXIT_SUCCESS;
+}
+
+static void
+_store_masterkey_command_usage(void)
+{
+    fputs("usage: btct store.masterkey <args>\n", stderr);
+    fputs("\n", stderr);
+    fputs("Write the encoded masterkey of a wallet, using the cached masterkey or seed when the\n", stderr);
+    fputs("wallet was stored with one and no passphrase is given, otherwise derived from the\n", stderr);
+    fputs("mnemonics.\n", stderr);
+    fputs("\n", stderr);
+    fputs("  -f, --file <filename>   Specify a file for the encrypted store to read from.\n", stderr);
+    fputs("                          Default store file is ~/.btct.dat.\n", stderr);
+    fputs("  -l, --label <name>      Label of the wallet to read, default is '" STORE_DEFAULT_LABEL "'.\n", stderr);
+    fputs("  -F, --fingerprint <hex> Read the wallet with masterkey fingerprint instead of label.\n", stderr);
+    fputs("  -p, --passphrase <text> Passphrase of the bip39 seed, bypasses the cache.\n", stderr);
+    fputs("\n", stderr);
+    fputs("examples:\n", stderr);
+    fputs("\n", stderr);
+    fputs("  Create bip44 account #0 for BTC of the default wallet\n", stderr);
+    fputs("\n", stderr);
+    fputs("      btct store.masterkey | btct bip44.account\n", stderr);
+    fputs("\n", stderr);
+}
+
+static int
+_store_masterkey_command(int argc, char **argv)
+{
+    int c;
+    const char *filename = NULL;
+    const char *label = STORE_DEFAULT_LABEL;
+    const char *fingerprint = NULL;
+    const char *passphrase = NULL;
+
+    while (1)
+    {
+        int option_index = 0;
+        static struct option long_options[] = {
+            {"help",  no_argument, 0, 'h' },
+            {"filename",  required_argument, 0, 'f' },
+            {"label",  required_argument, 0, 'l' },
+            {"fingerprint",  required_argument, 0, 'F' },
+            {"passphrase",  required_argument, 0, 'p' },
+            {0, 0, 0, 0}
+        };
+
+        c = getopt_long(argc, argv, "hf:l:F:p:", long_options, &option_index);
+        if (c == -1)
+            break;
+
+        switch (c) {
+            case 'h':
+                _store_masterkey_command_usage();
+                return EXIT_FAILURE;
+
+            case 'f':
+                filename = optarg;
+                break;
+
+            case 'l':
+                label = optarg;
+                break;
+
+            case 'F':
+                fingerprint = optarg;
+                break;
+
+            case 'p':
+                passphrase = optarg;
+                break;
+        }
+    }
+
+    return _store_masterkey(filename, label, fingerprint, passphrase);
+}
+
+static int
+_store_seed(const char *filename, const char *label, const char *fingerprint,
+            const char *passphrase)
+{
+  uint8_t seed[64];
+  store_t store;
+  int index, res;
+
+  index = _store_unlock_wallet("store.seed", &store, filename, label, fingerprint);
+  if (index < 0)
+    return EXIT_FAILURE;
+
+  res = store_seed(&store, index, passphrase, seed);
+  store_close(&store);
+
+  if (res != 0) {
+    fputs("store.seed: failed to read seed from store\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  // raw seed as written by bip39.seed
+  fwrite(seed, 1, sizeof(seed), stdout);
+  memset(seed, 0, sizeof(seed));
+  return EXIT_SUCCESS;
+}
+
+static void
+_store_seed_command_usage(void)
+{
+    fputs("usage: btct store.seed <args>\n", stderr);
+    fputs("\n", stderr);
+    fputs("Write the 64 byte bip39 seed of a wallet, using the cached seed when the wallet was\n", stderr);
+    fputs("stored with one and no passphrase is given, otherwise derived from the mnemonics\n", stderr);
+    fputs("without leaving the process.\n", stderr);
+    fputs("\n", stderr);
+    fputs("  -f, --file <filename>   Specify a file for the encrypted store to read from.\n", stderr);
+    fputs("                          Default store file is ~/.btct.dat.\n", stderr);
+    fputs("  -l, --label <name>      Label of the wallet to read, default is '" STORE_DEFAULT_LABEL "'.\n", stderr);
+    fputs("  -F, --fingerprint <hex> Read the wallet with masterkey fingerprint instead of label.\n", stderr);
+    fputs("  -p, --passphrase <text> Passphrase of the bip39 seed, bypasses the cache.\n", stderr);
+    fputs("\n", stderr);
+    fputs("examples:\n", stderr);
+    fputs("\n", stderr);
+    fputs("  Show the seed of the default wallet\n", stderr);
+    fputs("\n", stderr);
+    fputs("      btct store.seed | hexdump -C\n", stderr);
+    fputs("\n", stderr);
+}
+
+static int
+_store_seed_command(int argc, char **argv)
+{
+    int c;
+    const char *filename = NULL;
+    const char *label = STORE_DEFAULT_LABEL;
+    const char *fingerprint = NULL;
+    const char *passphrase = NULL;
+
+    while (1)
+    {
+        int option_index = 0;
+        static struct option long_options[] = {
+            {"help",  no_argument, 0, 'h' },
+            {"filename",  required_argument, 0, 'f' },
+            {"label",  required_argument, 0, 'l' },
+            {"fingerprint",  required_argument, 0, 'F' },
+            {"passphrase",  required_argument, 0, 'p' },
+            {0, 0, 0, 0}
+        };
+
+        c = getopt_long(argc, argv, "hf:l:F:p:", long_options, &option_index);
+        if (c == -1)
+            break;
+
+        switch (c) {
+            case 'h':
+                _store_seed_command_usage();
+                return EXIT_FAILURE;
+
+            case 'f':
+                filename = optarg;
+                break;
+
+            case 'l':
+                label = optarg;
+                break;
+
+            case 'F':
+                fingerprint = optarg;
+                break;
+
+            case 'p':
+                passphrase = optarg;
+                break;
+        }
+    }
+
+    return _store_seed(filename, label, fingerprint, passphrase);
+}
+
+static int
+_store_xprv(const char *filename, const char *label, const char *fingerprint,
+            const char *passphrase, bool public, char **paths, size_t count)
+{
+  uint8_t encoded[128];
+  size_t encoded_size;
+  bip32_key_t master, child, public_key;
+  char *root = "m";
+  store_t store;
+  int index, res = EXIT_SUCCESS;
+
+  index = _store_unlock_wallet("store.xprv", &store, filename, label, fingerprint);
+  if (index < 0)
+    return EXIT_FAILURE;
+
+  res = store_masterkey(&store, index, passphrase, &master);
+  store_close(&store);
+  if (res != 0) {
+    fputs("store.xprv: failed to read masterkey from store\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  if (count == 0) {
+    paths = &root;
+    count = 1;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    bip32_key_t *key = &child;
+
+    if (bip32_key_derive_child_by_path(&master, paths[i], &child) != 0) {
+      fprintf(stderr, "store.xprv: failed to derive '%s'\n", paths[i]);
+      res = EXIT_FAILURE;
+      break;
+    }
+
+    if (public) {
+      if (bip32_key_init_public_from_private_key(&public_key, &child) != 0) {
+        fprintf(stderr, "store.xprv: failed to create public key of '%s'\n", paths[i]);
+        res = EXIT_FAILURE;
+        break;
+      }
+      key = &public_key;
+    }
+
+    encoded_size = sizeof(encoded);
+    if (bip32_key_serialize(key, true, encoded, &encoded_size) != 0) {
+      fprintf(stderr, "store.xprv: failed to serialize key of '%s'\n", paths[i]);
+      res = EXIT_FAILURE;
+      break;
+    }
+
+    fprintf(stdout, "%s\n", encoded);
+  }
+
+  memset(&master, 0, sizeof(master));
+  memset(&child, 0, sizeof(child));
+  memset(encoded, 0, sizeof(encoded));
+  return res;
+}
+
+static void
+_store_xprv_command_usage(void)
+{
+    fputs("usage: btct store.xprv <args> [<path>...]\n", stderr);
+    fputs("\n", stderr);
+    fputs("Unlock a wallet and write the encoded key of each path, one key per line, going from\n", stderr);
+    fputs("the decrypted record to seed, masterkey and derived keys in one process. Default path\n", stderr);
+    fputs("is m, the masterkey.\n", stderr);
+    fputs("\n", stderr);
+    fputs("  -f, --file <filename>   Specify a file for the encrypted store to read from.\n", stderr);
+    fputs("                          Default store file is ~/.btct.dat.\n", stderr);
+    fputs("  -l, --label <name>      Label of the wallet to read, default is '" STORE_DEFAULT_LABEL "'.\n", stderr);
+    fputs("  -F, --fingerprint <hex> Read the wallet with masterkey fingerprint instead of label.\n", stderr);
+    fputs("  -p, --passphrase <text> Passphrase of the bip39 seed, bypasses the cache.\n", stderr);
+    fputs("  -P, --public            Output public keys instead of private keys.\n", stderr);
+    fputs("\n", stderr);
+    fputs("examples:\n", stderr);
+    fputs("\n", stderr);
+    fputs("  Write the xpub of bip44 account #0 and #1 for BTC\n", stderr);
+    fputs("\n", stderr);
+    fputs("      btct store.xprv --public \"m/44'/0'/0'\" \"m/44'/0'/1'\"\n", stderr);
+    fputs("\n", stderr);
+}
+
+static int
+_store_xprv_command(int argc, char **argv)
+{
+    int c;
+    const char *filename = NULL;
+    const char *label = STORE_DEFAULT_LABEL;
+    const char *fingerprint = NULL;
+    const char *passphrase = NULL;
+    bool public = false;
+
+    while (1)
+    {
+        int option_index = 0;
+        static struct option long_options[] = {
+            {"help",  no_argument, 0, 'h' },
+            {"filename",  required_argument, 0, 'f' },
+            {"label",  required_argument, 0, 'l' },
+            {"fingerprint",  required_argument, 0, 'F' },
+            {"passphrase",  required_argument, 0, 'p' },
+            {"public",  no_argument, 0, 'P' },
+            {0, 0, 0, 0}
+        };
+
+        c = getopt_long(argc, argv, "hf:l:F:p:P", long_options, &option_index);
+        if (c == -1)
+            break;
+
+        switch (c) {
+            case 'h':
+                _store_xprv_command_usage();
+                return EXIT_FAILURE;
+
+            case 'f':
+                filename = optarg;
+                break;
+
+            case 'l':
+                label = optarg;
+                break;
+
+            case 'F':
+                fingerprint = optarg;
+                break;
+
+            case 'p':
+                passphrase = optarg;
+                break;
+
+            case 'P':
+                public = true;
+                break;
+        }
+    }
+
+    return _store_xprv(filename, label, fingerprint, passphrase, public, argv + optind, argc - optind);
+}
+
+static int
+_store_list(const char *filename)
+{
+  store_entry_t entry;
+  store_t store;
+
+  if (store_open(&store, filename) != 0) {
+    fputs("store.list: failed to open store\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  for (uint32_t i = 0; i < store.entry_count; i++) {
+    if (store_entry(&store, i, &entry) != 0)
+      break;
+
+    fprintf(stdout, "%02x%02x%02x%02x %-31s mnemonics%s%s\n",
+            entry.fingerprint[0], entry.fingerprint[1], entry.fingerprint[2], entry.fingerprint[3],
+            entry.label,
+            entry.sections & STORE_SECTION_SEED ? ",seed" : "",
+            entry.sections & STORE_SECTION_MASTERKEY ? ",masterkey" : "");
+  }
+
+  store_close(&store);
+  return EXIT_SUCCESS;
+}
+
+static void
+_store_list_command_usage(void)
+{
+    fputs("usage: btct store.list <args>\n", stderr);
+    fputs("\n", stderr);
+    fputs("List masterkey fingerprint, label and stored sections of each wallet in the store,\n", stderr);
+    fputs("no password is required as the index of the store is not encrypted.\n", stderr);
+    fputs("\n", stderr);
+    fputs("  -f, --file <filename>   Specify a file for the encrypted store to read from.\n", stderr);
+    fputs("                          Default store file is ~/.btct.dat.\n", stderr);
+    fputs("\n", stderr);
+}
+
+static int
+_store_list_command(int argc, char **argv)
+{
+    int c;
+    const char *filename = NULL;
+
+    while (1)
+    {
+        int option_index = 0;
+        static struct option long_options[] = {
+            {"help",  no_argument, 0, 'h' },
+            {"filename",  required_argument, 0, 'f' },
+            {0, 0, 0, 0}
+        };
+
+        c = getopt_long(argc, argv, "hf:", long_options, &option_index);
+        if (c == -1)
+            break;
+
+        switch (c) {
+            case 'h':
+                _store_list_command_usage();
+                return EXIT_FAILURE;
+
+            case 'f':
+                filename = optarg;
+                break;
+        }
+    }
+
+    return _store_list(filename);
+}
+
+static int
+_store_agent(const char *filename, const char *label, const char *socket, const char *passphrase,
+             uint32_t ttl, bool foreground)
+{
+  bip32_key_t master;
+  store_t store;
+  agent_t agent;
+  pid_t pid;
+  int index, res = -1;
+
+  index = _store_unlock_wallet("store.agent", &store, filename, label, NULL);
+  if (index < 0)
+    return EXIT_FAILURE;
+
+  res = store_masterkey(&store, index, passphrase, &master);
+  store_close(&store);
+  if (res != 0) {
+    fputs("store.agent: failed to unlock masterkey from store\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  res = agent_init(&agent, &master, ttl);
+  memset(&master, 0, sizeof(master));
+  if (res != 0) {
+    fputs("store.agent: failed to allocate locked memory for key\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  if (agent_listen(&agent, socket) != 0) {
+    fprintf(stderr, "store.agent: failed to listen on socket '%s'\n", agent.path);
+    agent_clear(&agent);
+    return EXIT_FAILURE;
+  }
+
+  if (!foreground) {
+    fflush(stdout);
+    pid = agent_daemonize(&agent);
+    if (pid == -1) {
+      fputs("store.agent: failed to fork agent\n", stderr);
+      agent_clear(&agent);
+      return EXIT_FAILURE;
+    }
+
+    if (pid > 0) {
+      fprintf(stdout, "%s=%s; export %s;\n", AGENT_SOCKET_ENV, agent.path, AGENT_SOCKET_ENV);
+      fprintf(stdout, "echo Agent pid %d;\n", pid);
+      return EXIT_SUCCESS;
+    }
+  }
+  else {
+    fprintf(stdout, "%s=%s; export %s;\n", AGENT_SOCKET_ENV, agent.path, AGENT_SOCKET_ENV);
+    fflush(stdout);
+  }
+
+  res = agent_serve(&agent);
+  agent_clear(&agent);
+
+  return (res == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static void
+_store_agent_command_usage(void)
+{
+    fputs("usage: btct store.agent <args>\n", stderr);
+    fputs("\n", stderr);
+    fputs("Unlock the store once and keep the masterkey in locked memory of a background agent,\n", stderr);
+    fputs("serving key derivations to `store.derive` on a local socket. The socket path is\n", stderr);
+    fputs("written as a shell command setting " AGENT_SOCKET_ENV " on stdout.\n", stderr);
+    fputs("\n", stderr);
+    fputs("  -f, --file <filename>       Specify a file for the encrypted store to read from.\n", stderr);
+    fputs("                              Default store file is ~/.btct.dat.\n", stderr);
+    fputs("  -l, --label <name>          Label of the wallet to unlock, default is '" STORE_DEFAULT_LABEL "'.\n", stderr);
+    fputs("  -p, --passphrase <text>     Passphrase used for the bip39 seed.\n", stderr);
+    fputs("  -S, --socket <path>         Listen on socket path instead of a new private directory.\n", stderr);
+    fputs("  -t, --ttl <seconds>         Wipe the key and exit after seconds, 0 keeps the agent\n", stderr);
+    fputs("                              running until locked, default is 900 seconds.\n", stderr);
+    fputs("  -F, --foreground            Do not fork into background.\n", stderr);
+    fputs("\n", stderr);
+    fputs("examples:\n", stderr);
+    fputs("\n", stderr);
+    fputs("  Start agent for one hour and derive account keys from it\n", stderr);
+    fputs("\n", stderr);
+    fputs("      eval $(btct store.agent --ttl 3600)\n", stderr);
+    fputs("      btct store.derive \"m/44'/0'/0'\" \"m/44'/0'/1'\"\n", stderr);
+    fputs("\n", stderr);
+}
+
+static int
+_store_agent_command(int argc, char **argv)
+{
+    int c;
+    const char *filename = NULL;
+    const char *label = STORE_DEFAULT_LABEL;
+    const char *socket = NULL;
+    const char *passphrase = NULL;
+    uint32_t ttl = 900;
+    bool foreground = false;
+
+    while (1)
+    {
+        int option_index = 0;
+        static struct option long_options[] = {
+            {"help",  no_argument, 0, 'h' },
+            {"filename",  required_argument, 0, 'f' },
+            {"label",  required_argument, 0, 'l' },
+            {"passphrase",  required_argument, 0, 'p' },
+            {"socket",  required_argument, 0, 'S' },
+            {"ttl",  required_argument, 0, 't' },
+            {"foreground",  no_argument, 0, 'F' },
+            {0, 0, 0, 0}
+        };
+
+        c = getopt_long(argc, argv, "hf:l:p:S:t:F", long_options, &option_index);
+        if (c == -1)
+            break;
+
+        switch (c) {
+            case 'h':
+                _store_agent_command_usage();
+                return EXIT_FAILURE;
+
+            case 'f':
+                filename = optarg;
+                break;
+
+            case 'l':
+                label = optarg;
+                break;
+
+            case 'p':
+                passphrase = optarg;
+                break;
+
+            case 'S':
+                socket = optarg;
+                break;
+
+            case 't':
+                ttl = strtoul(optarg, NULL, 10);
+                break;
+
+            case 'F':
+                foreground = true;
+                break;
+        }
+    }
+
+    return _store_agent(filename, label, socket, passphrase, ttl, foreground);
+}
+
+static int
+_store_derive(const char *socket, bool public, bool lock, char **paths, size_t count)
+{
+  char request[AGENT_LINE_SIZE], response[AGENT_LINE_SIZE];
+  char *root = "m";
+  int fd, res = EXIT_SUCCESS;
+
+  fd = agent_connect(socket);
+  if (fd < 0) {
+    fputs("store.derive: failed to connect to agent, is " AGENT_SOCKET_ENV " set?\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  if (count == 0 && !lock) {
+    paths = &root;
+    count = 1;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    snprintf(request, sizeof(request), "%s %s", public ? "PUBLIC" : "DERIVE", paths[i]);
+    if (agent_request(fd, request, response, sizeof(response)) != 0) {
+      fprintf(stderr, "store.derive: agent failed to derive '%s': %s\n", paths[i], response);
+      res = EXIT_FAILURE;
+      break;
+    }
+    fprintf(stdout, "%s\n", response + 3);
+  }
+
+  if (lock && res == EXIT_SUCCESS && agent_request(fd, "LOCK", response, sizeof(response)) != 0) {
+    fputs("store.derive: failed to lock agent\n", stderr);
+    res = EXIT_FAILURE;
+  }
+
+  memset(response, 0, sizeof(response));
+  close(fd);
+  return res;
+}
+
+static void
+_store_derive_command_usage(void)
+{
+    fputs("usage: btct store.derive <args> [<path>...]\n", stderr);
+    fputs("\n", stderr);
+    fputs("Request encoded keys for each path from a running `store.agent`, one key per line.\n", stderr);
+    fputs("Default path is m, the masterkey.\n", stderr);
+    fputs("\n", stderr);
+    fputs("  -S, --socket <path>         Agent socket, default is taken from " AGENT_SOCKET_ENV ".\n", stderr);
+    fputs("  -P, --public                Output public keys instead of private keys.\n", stderr);
+    fputs("  -l, --lock                  Wipe the key and stop the agent when done.\n", stderr);
+    fputs("\n", stderr);
+    fputs("examples:\n", stderr);
+    fputs("\n", stderr);
+    fputs("  Describe first receive key of bip44 account #0\n", stderr);
+    fputs("\n", stderr);
+    fputs("      btct store.derive \"m/44'/0'/0'/0/0\" | btct bip32.describe\n", stderr);
+    fputs("\n", stderr);
+}
+
+static int
+_store_derive_command(int argc, char **argv)
+{
+    int c;
+    const char *socket = NULL;
+    bool public = false;
+    bool lock = false;
+
+    while (1)
+    {
+        int option_index = 0;
+        static struct option long_options[] = {
+            {"help",  no_argument, 0, 'h' },
+            {"socket",  required_argument, 0, 'S' },
+            {"public",  no_argument, 0, 'P' },
+            {"lock",  no_argument, 0, 'l' },
+            {0, 0, 0, 0}
+        };
+
+        c = getopt_long(argc, argv, "hS:Pl", long_options, &option_index);
+        if (c == -1)
+            break;
+
+        switch (c) {
+            case 'h':
+                _store_derive_command_usage();
+                return EXIT_FAILURE;
+
+            case 'S':
+                socket = optarg;
+                break;
+
+            case 'P':
+                public = true;
+                break;
+
+            case 'l':
+                lock = true;
+                break;
         }
     }
 
-    return _store_import(filename);
+    return _store_derive(socket, public, lock, argv + optind, argc - optind);
 }
 
 
@@ -323,6 +1273,12 @@ static void _store_command_usage(void)
     fputs("  init            Initialize store with new generated mnemonics seed phrase.\n", stderr);
     fputs("  import          Import an existing seed phrase into store.\n", stderr);
     fputs("  read            Read mnemonics sede phrase from store.\n", stderr);
+    fputs("  list            List wallets in store.\n", stderr);
+    fputs("  masterkey       Write encoded masterkey of a wallet in store.\n", stderr);
+    fputs("  seed            Write bip39 seed of a wallet in store.\n", stderr);
+    fputs("  xprv            Write encoded keys derived from a wallet in store.\n", stderr);
+    fputs("  agent           Unlock store once and serve key derivations from a background agent.\n", stderr);
+    fputs("  derive          Request derived keys from a running agent.\n", stderr);
     fputs("\n",stderr);
     fputs("examples:\n", stderr);
     fputs("\n",stderr);
@@ -340,6 +1296,12 @@ int store_command(int argc, char **argv)
         { "store.init", _store_init_command },
         { "store.read", _store_read_command },
         { "store.import", _store_import_command },
+        { "store.list", _store_list_command },
+        { "store.masterkey", _store_masterkey_command },
+        { "store.seed", _store_seed_command },
+        { "store.xprv", _store_xprv_command },
+        { "store.agent", _store_agent_command },
+        { "store.derive", _store_derive_command },
         { NULL, NULL, }
     };
 
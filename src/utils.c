@@ -1,9 +1,10 @@
 #include <ctype.h>
-#include <fcntl.h>
 #include <nettle/sha2.h>
 #include <nettle/ripemd160.h>
 
 #include "utils.h"
+#include "stats.h"
+#include "random.h"
 
 void
 utils_hexdump(uint8_t *data, size_t size, FILE *out) {
@@ -32,6 +33,14 @@ utils_hexdump(uint8_t *data, size_t size, FILE *out) {
     fprintf(out, "%8.8lx\n", byte_offset + 16);
 }
 
+void
+utils_wipe(void *data, size_t size)
+{
+  volatile uint8_t *p = data;
+  while (size--)
+    *p++ = 0;
+}
+
 int
 utils_to_hex_string(const uint8_t *data, size_t size, char *result)
 {
@@ -92,11 +101,7 @@ utils_base85_encode(const uint8_t *data, size_t size, char *result)
 int
 utils_fill_random(uint8_t *out, size_t size)
 {
-  int h = open("/dev/urandom", O_RDONLY);
-  if (read(h, out, size) < size)
-    return -1;
-  close(h);
-  return 0;
+  return random_fill(out, size) == 0 ? 0 : -1;
 }
 
 int
@@ -114,6 +119,21 @@ utils_sha256_checksum(const uint8_t *data, size_t size, uint8_t *checksum)
   return 0;
 }
 
+int
+utils_sha256_batch(const uint8_t *data, size_t size, size_t count, uint8_t *digests)
+{
+  struct sha256_ctx sha256;
+
+  sha256_init(&sha256);
+  for (size_t i = 0; i < count; i++) {
+    // digest leaves the context initialized for the next message
+    sha256_update(&sha256, size, data + i * size);
+    sha256_digest(&sha256, SHA256_DIGEST_SIZE, digests + i * SHA256_DIGEST_SIZE);
+  }
+
+  return 0;
+}
+
 int
 utils_hash160(const uint8_t *data, size_t size, uint8_t *out)
 {
@@ -121,6 +141,9 @@ utils_hash160(const uint8_t *data, size_t size, uint8_t *out)
   struct ripemd160_ctx ripemd160;
   uint8_t hashed[SHA256_DIGEST_SIZE] = {0};
 
+  STATS_STAGE(STATS_STAGE_HASH160);
+  STATS_INC(STATS_HASH160);
+
   sha256_init(&sha256);
   sha256_update(&sha256, size, data);
   sha256_digest(&sha256, SHA256_DIGEST_SIZE, hashed);
@@ -131,3 +154,41 @@ utils_hash160(const uint8_t *data, size_t size, uint8_t *out)
 
   return 0;
 }
+
+static int
+_parse_u32(const char *str, const char **end, uint32_t *value)
+{
+  uint64_t v = 0;
+
+  if (!isdigit((unsigned char)*str))
+    return -1;
+
+  for (; isdigit((unsigned char)*str); str++) {
+    v = v * 10 + (*str - '0');
+    if (v > UINT32_MAX)
+      return -1;
+  }
+
+  *end = str;
+  *value = v;
+  return 0;
+}
+
+int
+utils_parse_range(const char *str, uint32_t *first, uint32_t *last)
+{
+  const char *end;
+
+  if (_parse_u32(str, &end, first) != 0)
+    return -1;
+
+  if (*end == '\0') {
+    *last = *first;
+    return 0;
+  }
+
+  if (*end != '-' || _parse_u32(end + 1, &end, last) != 0 || *end != '\0' || *last < *first)
+    return -1;
+
+  return 0;
+}
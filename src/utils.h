@@ -34,6 +34,8 @@
 #endif
 
 void utils_hexdump(uint8_t *data, size_t size, FILE *out);
+/** zero secrets, the volatile stores are kept when data is not read again */
+void utils_wipe(void *data, size_t size);
 
 int utils_fill_random(uint8_t *out, size_t size);
 
@@ -41,7 +43,15 @@ int utils_base85_encode(const uint8_t *data, size_t size, char *result);
 int utils_to_hex_string(const uint8_t *data, size_t size, char *result);
 
 /** SHA256(SHA256(x))[0:3] */
-int utils_sha256_sha256_checksum(const uint8_t *data, size_t size, uint8_t *checksum);
+int utils_sha256_checksum(const uint8_t *data, size_t size, uint8_t *checksum);
+/**
+ * SHA256 of count messages of size bytes each, message i at data + i * size
+ * and its digest at digests + i * 32. One context is reused for all.
+ */
+int utils_sha256_batch(const uint8_t *data, size_t size, size_t count, uint8_t *digests);
 /** RIPEMD160(SHA256(x)) */
 int utils_hash160(const uint8_t *data, size_t size, uint8_t *out);
+
+/** parse decimal "N" or "N-M" into an inclusive range, fails if M < N */
+int utils_parse_range(const char *str, uint32_t *first, uint32_t *last);
 #endif
@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "command.h"
+#include "utils.h"
+#include "bip32.h"
+#include "bip39.h"
+#include "bip44.h"
+
+#define WALLET_MAX_THREADS 256
+
+typedef struct _wallet_generate_t {
+  size_t count;
+  size_t bits;
+  const char *passphrase;
+  const bip44_coin_t *coin;
+  _Atomic size_t next;
+  atomic_int failed;
+} _wallet_generate_t;
+
+/**
+ * Generate one random wallet and format it as a JSON object on one
+ * line: mnemonic, master key fingerprint, account xpub and the first
+ * receive address of the account.
+ */
+static int
+_wallet_generate_one(const _wallet_generate_t *job, char *line, size_t size)
+{
+  uint8_t entropy[32], seed[64];
+  char sentence[24 * 9] = {0};
+  uint8_t xpub[128], address[64];
+  size_t xpub_size = sizeof(xpub), address_size = sizeof(address);
+  bip32_key_t master, account, account_public, change, receive;
+  bip32_key_identifier_t ident;
+  uint8_t fingerprint[4];
+  char **words = NULL;
+  size_t word_count = 0;
+  bip39_t bip39;
+  int res = -1;
+
+  if (utils_fill_random(entropy, job->bits / 8) != 0)
+    return -1;
+
+  bip39_init(&bip39);
+  if (bip39_to_mnemonics(&bip39, entropy, job->bits, &words, &word_count) != 0)
+    goto out;
+
+  for (size_t w = 0; w < word_count; w++) {
+    if (w > 0)
+      strcat(sentence, " ");
+    strcat(sentence, words[w]);
+  }
+  free(words);
+
+  if (bip39_to_seed(&bip39, (uint8_t *)sentence, strlen(sentence), 2048,
+                    (const uint8_t *)job->passphrase, seed) != 0)
+    goto out;
+
+  if (bip32_key_init_from_entropy(&master, seed, sizeof(seed)) != 0
+      || bip32_key_identifier_init_from_key(ident, &master) != 0
+      || bip32_key_identifier_fingerprint(ident, fingerprint) != 0)
+    goto out;
+
+  // m/44'/coin'/0' exported as xpub, first receive address at m/44'/coin'/0'/0/0
+  if (bip44_create_account(&master, job->coin, 0, &account) != 0
+      || bip32_key_init_public_from_private_key(&account_public, &account) != 0
+      || bip32_key_serialize(&account_public, true, xpub, &xpub_size) != 0
+      || bip32_key_derive_child_key(&account, 0, &change) != 0
+      || bip32_key_derive_child_key(&change, 0, &receive) != 0
+      || bip44_p2pkh_address_from_key(&receive, job->coin, address, &address_size) != 0)
+    goto out;
+
+  if (snprintf(line, size,
+               "{\"mnemonic\":\"%s\",\"fingerprint\":\"%02x%02x%02x%02x\","
+               "\"xpub\":\"%s\",\"address\":\"%s\"}\n",
+               sentence, fingerprint[0], fingerprint[1], fingerprint[2], fingerprint[3],
+               xpub, address) >= (int)size)
+    goto out;
+
+  res = 0;
+
+ out:
+  memset(entropy, 0, sizeof(entropy));
+  memset(seed, 0, sizeof(seed));
+  memset(sentence, 0, sizeof(sentence));
+  memset(&master, 0, sizeof(master));
+  memset(&account, 0, sizeof(account));
+  memset(&change, 0, sizeof(change));
+  memset(&receive, 0, sizeof(receive));
+  return res;
+}
+
+static void *
+_wallet_generate_worker(void *arg)
+{
+  _wallet_generate_t *job = arg;
+  char line[1024];
+
+  while (atomic_load_explicit(&job->failed, memory_order_relaxed) == 0) {
+    size_t index = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+    if (index >= job->count)
+      break;
+
+    if (_wallet_generate_one(job, line, sizeof(line)) != 0) {
+      atomic_store(&job->failed, 1);
+      break;
+    }
+
+    // one wallet per line, lines from different workers never interleave
+    flockfile(stdout);
+    fputs(line, stdout);
+    funlockfile(stdout);
+    memset(line, 0, sizeof(line));
+  }
+
+  return NULL;
+}
+
+static int
+_wallet_generate(size_t count, size_t threads, size_t bits, const char *passphrase)
+{
+  pthread_t workers[WALLET_MAX_THREADS];
+  size_t started = 0;
+  _wallet_generate_t job = {
+    .count = count,
+    .bits = bits,
+    .passphrase = passphrase,
+    .coin = bip44_coin_by_symbol("BTC"),
+    .next = 0,
+    .failed = 0,
+  };
+
+  if (threads > count)
+    threads = count;
+
+  for (; started < threads; started++) {
+    if (pthread_create(&workers[started], NULL, _wallet_generate_worker, &job) != 0)
+      break;
+  }
+
+  // run on the calling thread if no worker could be started
+  if (started == 0)
+    _wallet_generate_worker(&job);
+
+  for (size_t i = 0; i < started; i++)
+    pthread_join(workers[i], NULL);
+
+  fflush(stdout);
+
+  if (job.failed) {
+    fputs("wallet.generate: failed to generate wallet\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+static void
+_wallet_generate_command_usage(void)
+{
+  fputs("usage: btct wallet.generate <args>\n", stderr);
+  fputs("\n", stderr);
+  fputs("  -c, --count <count>       Number of wallets to generate, default is 1.\n", stderr);
+  fputs("  -t, --threads <count>     Number of worker threads, default is one per online cpu.\n", stderr);
+  fputs("  -w, --words <count>       Number of mnemonic words 12, 15, 18, 21 or 24, default is 24.\n", stderr);
+  fputs("  -p, --passphrase <text>   Passphrase used for all generated bip39 seeds.\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Each wallet is written as one JSON object per line holding the mnemonic, master key\n", stderr);
+  fputs("  fingerprint, xpub of bip44 BTC account #0 and its first receive address. Lines are\n", stderr);
+  fputs("  written as soon as a wallet is ready and are not ordered.\n", stderr);
+  fputs("\n", stderr);
+  fputs("examples:\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Generate 1000 wallets using 8 threads\n", stderr);
+  fputs("\n", stderr);
+  fputs("      btct wallet.generate --count 1000 --threads 8 > wallets.jsonl\n", stderr);
+  fputs("\n", stderr);
+}
+
+static int
+_wallet_generate_command(int argc, char **argv)
+{
+  int c;
+  long count = 1;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  long words = 24;
+  const char *passphrase = NULL;
+
+  while (1)
+    {
+      int option_index = 0;
+      static struct option long_options[] = {
+        {"help",  no_argument, 0, 'h' },
+        {"count",  required_argument, 0, 'c' },
+        {"threads",  required_argument, 0, 't' },
+        {"words",  required_argument, 0, 'w' },
+        {"passphrase",  required_argument, 0, 'p' },
+        {0, 0, 0, 0}
+      };
+
+      c = getopt_long(argc, argv, "hc:t:w:p:", long_options, &option_index);
+      if (c == -1)
+        break;
+
+      switch (c) {
+      case 'h':
+        _wallet_generate_command_usage();
+        return EXIT_FAILURE;
+
+      case 'c':
+        count = atol(optarg);
+        break;
+
+      case 't':
+        threads = atol(optarg);
+        break;
+
+      case 'w':
+        words = atol(optarg);
+        break;
+
+      case 'p':
+        passphrase = optarg;
+        break;
+      }
+    }
+
+  if (count < 1) {
+    fputs("wallet.generate: count must be at least 1\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  if (threads < 1)
+    threads = 1;
+  if (threads > WALLET_MAX_THREADS)
+    threads = WALLET_MAX_THREADS;
+
+  if (words < 12 || words > 24 || words % 3 != 0) {
+    fputs("wallet.generate: words must be one of 12, 15, 18, 21 or 24\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  // each 3 words encodes 32 bits of entropy and 1 bit of checksum
+  return _wallet_generate(count, threads, words / 3 * 32, passphrase);
+}
+
+static void _wallet_command_usage(void)
+{
+  fputs("usage: btct wallet.<command> <args>\n", stderr);
+  fputs("\n", stderr);
+  fputs("  generate        Generate random wallets in bulk, written as JSON lines on stdout.\n", stderr);
+  fputs("\n", stderr);
+  fputs("examples:\n", stderr);
+  fputs("\n", stderr);
+  fputs("  Generate 10 wallets with 12 word mnemonics:\n", stderr);
+  fputs("\n", stderr);
+  fputs("      btct wallet.generate --count 10 --words 12\n", stderr);
+  fputs("\n", stderr);
+}
+
+int wallet_command(int argc, char **argv)
+{
+  int res;
+
+  struct command_t commands[] = {
+    { "wallet.generate", _wallet_generate_command },
+    { NULL, NULL, }
+  };
+
+  res = command_dispatch(commands, argv[0], false, argc, argv);
+  if (res == -1)
+    _wallet_command_usage();
+
+  return (res != EXIT_SUCCESS ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,291 @@
+#include "./bdd-for-c.h"
+#include "../src/address.h"
+#include "../src/bech32.h"
+#include "../src/bip44.h"
+
+#define check_str(got, expected) check(strcmp(got, expected) == 0, "expected string '%s' got '%s'", expected, got)
+#define check_number(got, expected) check(got == expected, "expected '%d' got '%d'", expected, got)
+
+// abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon about
+static const char *masterkey =
+  "xprv9s21ZrQH143K3GJpoapnV8SFfukcVBSfeCficPSGfubmSFDxo1kuHnLisriDvSnRRuL2Qrg5ggqHKNVpxR86QEC8w35uxmGoggxtQTPvfUu";
+
+/** first receive address of account #0 of BTC for address type */
+static int
+_first_address(address_type_t type, char *address)
+{
+  bip32_key_t master, chain;
+  char path[64];
+  size_t size = ADDRESS_MAX_SIZE;
+
+  snprintf(path, sizeof(path), "m/%u'/0'/0'/0/0", address_type_purpose(type));
+  if (bip32_key_deserialize(&master, masterkey) != 0
+      || bip32_key_derive_child_by_path(&master, path, &chain) != 0)
+    return -1;
+
+  return address_from_key(&chain, bip44_coin_by_symbol("BTC"), type, address, &size);
+}
+
+spec("address") {
+
+  context("bech32 encoding") {
+    describe("when encoding a witness v0 key hash (bip173)") {
+      static const uint8_t program[] = {
+        0x75, 0x1e, 0x76, 0xe8, 0x19, 0x91, 0x96, 0xd4, 0x54, 0x94,
+        0x1c, 0x45, 0xd1, 0xb3, 0xa3, 0x23, 0xf1, 0x43, 0x3b, 0xd6
+      };
+      static char address[BECH32_ADDRESS_MAX_SIZE];
+      static size_t size = sizeof(address);
+      static int result = -1;
+
+      before() {
+        result = bech32_segwit_address_encode("bc", 0, program, sizeof(program), address, &size);
+      }
+
+      it("should not return error")
+        check_number(result, 0);
+      it("should return the bech32 address")
+        check_str(address, "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4");
+      it("should return the size including the terminating zero")
+        check_number((int)size, 43);
+    }
+
+    describe("when encoding a witness v1 program (bip350)") {
+      static const uint8_t program[] = {
+        0x79, 0xbe, 0x66, 0x7e, 0xf9, 0xdc, 0xbb, 0xac, 0x55, 0xa0, 0x62, 0x95, 0xce, 0x87, 0x0b, 0x07,
+        0x02, 0x9b, 0xfc, 0xdb, 0x2d, 0xce, 0x28, 0xd9, 0x59, 0xf2, 0x81, 0x5b, 0x16, 0xf8, 0x17, 0x98
+      };
+
+      it("should return the bech32m address") {
+        char address[BECH32_ADDRESS_MAX_SIZE];
+        size_t size = sizeof(address);
+        bech32_segwit_address_encode("bc", 1, program, sizeof(program), address, &size);
+        check_str(address, "bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqzk5jj0");
+      }
+    }
+
+    describe("when encoding invalid programs") {
+      static const uint8_t program[40] = { 0 };
+
+      it("should return error") {
+        char address[BECH32_ADDRESS_MAX_SIZE];
+        size_t size = sizeof(address);
+        check(bech32_segwit_address_encode("bc", 0, program, 21, address, &size) != 0);
+        check(bech32_segwit_address_encode("bc", 17, program, 20, address, &size) != 0);
+        check(bech32_segwit_address_encode("BC", 0, program, 20, address, &size) != 0);
+        size = 10;
+        check(bech32_segwit_address_encode("bc", 0, program, 20, address, &size) != 0);
+      }
+    }
+  }
+
+  context("given the bip49, bip84 and bip86 test vector masterkey") {
+    static char address[ADDRESS_MAX_SIZE];
+
+    describe("when creating the first p2sh-p2wpkh receive address") {
+      it("should return the bip49 address") {
+        check_number(_first_address(ADDRESS_P2SH_P2WPKH, address), 0);
+        check_str(address, "37VucYSaXLCAsxYyAPfbSi9eh4iEcbShgf");
+      }
+    }
+
+    describe("when creating the first p2wpkh receive address") {
+      it("should return the bip84 address") {
+        check_number(_first_address(ADDRESS_P2WPKH, address), 0);
+        check_str(address, "bc1qcr8te4kr609gcawutmrza0j4xv80jy8z306fyu");
+      }
+    }
+
+    describe("when creating the first p2tr receive address") {
+      it("should return the bip86 address") {
+        check_number(_first_address(ADDRESS_P2TR, address), 0);
+        check_str(address, "bc1p5cyxnuxmeuwuvkwfem96lqzszd02n6xdcjrs20cac6yqjjwudpxqkedrcr");
+      }
+    }
+
+    describe("when creating p2pkh addresses") {
+      it("should return the bip44 address") {
+        check_number(_first_address(ADDRESS_P2PKH, address), 0);
+        check_str(address, "1LqBGSKuX5yYUonjxT5qGfpUsXKYYWeabA");
+      }
+    }
+
+    describe("when creating the scripthash of the first bip84 address") {
+      it("should return the reversed sha256 of its scriptPubKey") {
+        bip32_key_t master, key;
+        char scripthash[ADDRESS_SCRIPTHASH_SIZE];
+        bip32_key_deserialize(&master, masterkey);
+        bip32_key_derive_child_by_path(&master, "m/84'/0'/0'/0/0", &key);
+        check_number(address_scripthash_from_key(&key, bip44_coin_by_symbol("BTC"), ADDRESS_P2WPKH,
+                                                 scripthash), 0);
+        check_str(scripthash, "6e4f16236139f15046b38f399a683fb2aa8edf5fd128b3e5db017fb0ac74078a");
+      }
+    }
+
+    describe("when creating the scripthash of the first bip44 address") {
+      it("should return the reversed sha256 of its scriptPubKey") {
+        bip32_key_t master, key;
+        char scripthash[ADDRESS_SCRIPTHASH_SIZE];
+        bip32_key_deserialize(&master, masterkey);
+        bip32_key_derive_child_by_path(&master, "m/44'/0'/0'/0/0", &key);
+        check_number(address_scripthash_from_key(&key, bip44_coin_by_symbol("BTC"), ADDRESS_P2PKH,
+                                                 scripthash), 0);
+        check_str(scripthash, "1e8750b8a4c0912d8b84f7eb53472cbdcb57f9e0cde263b2e51ecbe30853cd68");
+      }
+    }
+
+    describe("when creating segwit addresses for a coin without segwit") {
+      it("should return error") {
+        bip32_key_t master;
+        size_t size = sizeof(address);
+        bip32_key_deserialize(&master, masterkey);
+        check(address_from_key(&master, bip44_coin_by_symbol("DOGE"), ADDRESS_P2WPKH, address, &size) != 0);
+      }
+    }
+
+    describe("when creating addresses for a coin without address parameters") {
+      it("should return error") {
+        bip32_key_t master;
+        address_format_t format = { ADDRESS_P2PKH, ADDRESS_ENCODING_ADDRESS };
+        size_t size = sizeof(address);
+        bip32_key_deserialize(&master, masterkey);
+        check(address_from_key(&master, bip44_coin_by_symbol("ETH"), ADDRESS_P2PKH, address, &size) != 0);
+        check(address_set_from_key(&master, bip44_coin_by_symbol("ETH"), &format, 1, address,
+                                   ADDRESS_MAX_SIZE) != 0);
+      }
+    }
+  }
+
+  context("given a chain key") {
+    static bip32_key_t chain;
+
+    before() {
+      bip32_key_t master;
+      bip32_key_deserialize(&master, masterkey);
+      bip32_key_derive_child_by_path(&master, "m/86'/0'/0'/0", &chain);
+    }
+
+    describe("when creating a range of addresses") {
+      static char addresses[100 * ADDRESS_MAX_SIZE];
+      static int result = -1;
+
+      before() {
+        result = address_range_from_key(&chain, bip44_coin_by_symbol("BTC"), ADDRESS_P2TR, 5, 100,
+                                        addresses, ADDRESS_MAX_SIZE);
+      }
+
+      it("should not return error")
+        check_number(result, 0);
+
+      it("should return the addresses of each child") {
+        for (int i = 0; i < 100; i += 33) {
+          bip32_key_t child;
+          char address[ADDRESS_MAX_SIZE];
+          size_t size = sizeof(address);
+
+          bip32_key_derive_child_key(&chain, 5 + i, &child);
+          address_from_key(&child, bip44_coin_by_symbol("BTC"), ADDRESS_P2TR, address, &size);
+          check_str(addresses + i * ADDRESS_MAX_SIZE, address);
+        }
+      }
+    }
+
+    describe("when creating a range of address sets") {
+      static const address_format_t formats[] = {
+        { ADDRESS_P2TR, ADDRESS_ENCODING_ADDRESS },
+        { ADDRESS_P2PKH, ADDRESS_ENCODING_ADDRESS },
+        { ADDRESS_P2WPKH, ADDRESS_ENCODING_ADDRESS },
+      };
+      static char addresses[10 * 3 * ADDRESS_MAX_SIZE];
+      static int result = -1;
+
+      before() {
+        result = address_set_range_from_key(&chain, bip44_coin_by_symbol("BTC"), formats, 3, 1, 10,
+                                            addresses, ADDRESS_MAX_SIZE);
+      }
+
+      it("should not return error")
+        check_number(result, 0);
+
+      it("should return the address of each type of each child") {
+        for (int i = 0; i < 10; i += 3) {
+          for (int t = 0; t < 3; t++) {
+            bip32_key_t child;
+            char address[ADDRESS_MAX_SIZE];
+            size_t size = sizeof(address);
+
+            bip32_key_derive_child_key(&chain, 1 + i, &child);
+            address_from_key(&child, bip44_coin_by_symbol("BTC"), formats[t].type, address, &size);
+            check_str(addresses + (i * 3 + t) * ADDRESS_MAX_SIZE, address);
+          }
+        }
+      }
+    }
+
+    describe("when parsing a list of address formats") {
+      it("should return the formats in order") {
+        char names[] = "p2wpkh,p2pkh:scripthash,p2tr";
+        address_format_t formats[ADDRESS_FORMAT_MAX];
+        size_t count = 0;
+        check_number(address_formats_from_names(names, formats, &count), 0);
+        check_number((int)count, 3);
+        check(formats[0].type == ADDRESS_P2WPKH && formats[0].encoding == ADDRESS_ENCODING_ADDRESS);
+        check(formats[1].type == ADDRESS_P2PKH && formats[1].encoding == ADDRESS_ENCODING_SCRIPTHASH);
+        check(formats[2].type == ADDRESS_P2TR && formats[2].encoding == ADDRESS_ENCODING_ADDRESS);
+      }
+
+      it("should return error for a format given twice") {
+        char names[] = "p2pkh,p2wpkh,p2pkh";
+        address_format_t formats[ADDRESS_FORMAT_MAX];
+        size_t count = 0;
+        check(address_formats_from_names(names, formats, &count) != 0);
+      }
+
+      it("should return error for an unknown encoding") {
+        char names[] = "p2pkh:hash";
+        address_format_t formats[ADDRESS_FORMAT_MAX];
+        size_t count = 0;
+        check(address_formats_from_names(names, formats, &count) != 0);
+      }
+    }
+
+    describe("when creating a range of scripthashes") {
+      static const address_format_t formats[] = {
+        { ADDRESS_P2SH_P2WPKH, ADDRESS_ENCODING_SCRIPTHASH },
+        { ADDRESS_P2TR, ADDRESS_ENCODING_SCRIPTHASH },
+      };
+      static char scripthashes[70 * 2 * ADDRESS_SCRIPTHASH_SIZE];
+      static int result = -1;
+
+      before() {
+        result = address_set_range_from_key(&chain, bip44_coin_by_symbol("BTC"), formats, 2, 0, 70,
+                                            scripthashes, ADDRESS_SCRIPTHASH_SIZE);
+      }
+
+      it("should not return error")
+        check_number(result, 0);
+
+      it("should return the scripthash of each child") {
+        for (int i = 0; i < 70; i += 23) {
+          for (int f = 0; f < 2; f++) {
+            bip32_key_t child;
+            char scripthash[ADDRESS_SCRIPTHASH_SIZE];
+
+            bip32_key_derive_child_key(&chain, i, &child);
+            address_scripthash_from_key(&child, bip44_coin_by_symbol("BTC"), formats[f].type, scripthash);
+            check_str(scripthashes + (i * 2 + f) * ADDRESS_SCRIPTHASH_SIZE, scripthash);
+          }
+        }
+      }
+    }
+
+    describe("when creating a range from index 1") {
+      it("should return the second bip86 receive address first") {
+        char addresses[2 * ADDRESS_MAX_SIZE];
+        address_range_from_key(&chain, bip44_coin_by_symbol("BTC"), ADDRESS_P2TR, 1, 2,
+                               addresses, ADDRESS_MAX_SIZE);
+        check_str(addresses, "bc1p4qhjn9zdvkux4e44uhx8tc55attvtyu358kutcqkudyccelu0was9fqzwh");
+      }
+    }
+  }
+}
@@ -0,0 +1,270 @@
+#include "./bdd-for-c.h"
+#include "../src/bip44.h"
+
+#define check_str(got, expected) check(strcmp(got, expected) == 0, "expected string '%s' got '%s'", expected, got)
+#define check_number(got, expected) check(got == expected, "expected '%u' got '%u'", expected, got)
+
+// legal winner thank year wave sausage worth useful legal winner thank yellow, TREZOR
+static const char *masterkey =
+  "xprv9s21ZrQH143K2gA81bYFHqU68xz1cX2APaSq5tt6MFSLeXnCKV1RVUJt9FWNTbrrryem4ZckN8k4Ls1H6nwdvDTvnV7zEXs2HgPezuVccsq";
+
+/**
+ * Used addresses of the trezor masterkey, base58 and hash160 lines:
+ * m/44'/0'/0'/0/4, m/44'/0'/0'/0/25 past a gap of 20, m/44'/0'/0'/1/1,
+ * m/44'/0'/2'/1/0 on the internal chain only and m/44'/0'/1'/0/2
+ */
+static const char *used_lines =
+  "1FbHhBPHRV525SrG6CYyBz3NLEQJWqYMAL\n"
+  "73ebc6bd935ba44e82fbc4454786a476e587254b\n"
+  "\n"
+  "4504969b3b67626413ffbc703f3ad09228d34c7c\n"
+  "7fea2cfa0ee8661da2977c96c13ab1a0d82b3a23\n"
+  "1FLgsFqWCg52NYUAAfWGm9txiRkh5XKTSf\n";
+
+static bip44_discovered_t discovered[8];
+static size_t discovered_cnt;
+
+static int
+_collect(const bip44_discovered_t *account, void *arg)
+{
+  (void)arg;
+  if (discovered_cnt == sizeof(discovered) / sizeof(discovered[0]))
+    return -1;
+  discovered[discovered_cnt++] = *account;
+  return 0;
+}
+
+/** read the used addresses of text into used */
+static int
+_read_used(bip44_used_t *used, const char *text, size_t *line_number)
+{
+  FILE *in = fmemopen((void *)text, strlen(text), "r");
+  int res = bip44_used_read(used, in, line_number);
+  fclose(in);
+  return res;
+}
+
+spec("bip44") {
+
+  context("coin registry") {
+
+    describe("when looking up symbol 'BTC'") {
+      static const bip44_coin_t *coin;
+      before() {
+        coin = bip44_coin_by_symbol("BTC");
+      }
+      it("should return bitcoin") {
+        check(coin != NULL);
+        check_number(coin->type, 0u);
+        check_str(coin->coin, "Bitcoin");
+      }
+      it("should carry the bitcoin address parameters") {
+        check_number(coin->p2pkh, 0x00u);
+        check_number(coin->p2sh, 0x05u);
+        check_number(coin->wif, 0x80u);
+        check_str(coin->hrp, "bc");
+        check_number(coin->xpub, 0x0488b21eu);
+      }
+    }
+
+    describe("when looking up symbol 'ltc'") {
+      it("should ignore case and return litecoin") {
+        const bip44_coin_t *coin = bip44_coin_by_symbol("ltc");
+        check(coin != NULL);
+        check_number(coin->type, 2u);
+        check_number(coin->p2pkh, 0x30u);
+      }
+    }
+
+    describe("when looking up a coin without address parameters") {
+      it("should not carry the bitcoin ones") {
+        const bip44_coin_t *coin = bip44_coin_by_symbol("RDD");
+        check(coin != NULL);
+        check(!bip44_coin_has_addresses(coin));
+        check(coin->hrp == NULL);
+        check(bip44_coin_has_addresses(bip44_coin_by_symbol("BTC")));
+      }
+    }
+
+    describe("when looking up symbols not registered") {
+      it("should return NULL") {
+        check(bip44_coin_by_symbol("") == NULL);
+        check(bip44_coin_by_symbol("NOPE") == NULL);
+        check(bip44_coin_by_symbol("BT") == NULL);
+        check(bip44_coin_by_symbol("BTCBTCBTCBTCBTCBTCBTCBTCBTCBTCBTCBTCBTCBTCBTCBTCBTCBTCBTCBTCBTCBTCBTC") == NULL);
+      }
+    }
+
+    describe("when looking up coin types") {
+      it("should return the registered coin") {
+        check(bip44_coin_by_type(145) == bip44_coin_by_symbol("BCH"));
+        check(bip44_coin_by_type(1) != NULL);
+        check_number(bip44_coin_by_type(1)->p2pkh, 0x6fu);
+        check(bip44_coin_by_type(1179993461) == bip44_coin_by_symbol("HXC"));
+      }
+      it("should return NULL for types not registered")
+        check(bip44_coin_by_type(0x7fffffff) == NULL);
+    }
+  }
+
+  context("given the masterkey of the trezor test vector") {
+    static bip32_key_t master;
+
+    before() {
+      bip32_key_deserialize(&master, masterkey);
+    }
+
+    describe("when creating the first receive address of litecoin account #0") {
+      static char address[64];
+      static int result = -1;
+
+      before() {
+        bip32_key_t account, change, receive;
+        size_t size = sizeof(address);
+        const bip44_coin_t *coin = bip44_coin_by_symbol("LTC");
+
+        if (bip44_create_account(&master, coin, 0, &account) == 0
+            && bip32_key_derive_child_key(&account, 0, &change) == 0
+            && bip32_key_derive_child_key(&change, 0, &receive) == 0)
+          result = bip44_p2pkh_address_from_key(&receive, coin, (uint8_t *)address, &size);
+      }
+
+      it("should not return error")
+        check_number(result, 0);
+
+      it("should return a litecoin address")
+        check_str(address, "LdUqVDMF5LJqyUpkkKNfEQnFSmTq8qagu1");
+    }
+
+    describe("when creating an address of a coin without address parameters") {
+      it("should return error") {
+        char address[64];
+        size_t size = sizeof(address);
+        check(bip44_p2pkh_address_from_key(&master, bip44_coin_by_symbol("ETH"), (uint8_t *)address,
+                                           &size) != 0);
+      }
+    }
+
+    describe("when reading used addresses") {
+      static bip44_used_t used;
+      static size_t line_number;
+      static int result = -1;
+
+      before() {
+        result = _read_used(&used, used_lines, &line_number);
+      }
+
+      after() {
+        bip44_used_free(&used);
+      }
+
+      it("should not return error")
+        check_number(result, 0);
+
+      it("should skip blank lines")
+        check_number(used.count, (size_t)5);
+
+      it("should hold the hash160 of a base58 line") {
+        static const uint8_t hash160[20] = {
+          0xa0, 0x0d, 0xd6, 0x8b, 0xf4, 0x61, 0x19, 0xe3, 0x84, 0x20,
+          0xf9, 0x72, 0xa8, 0x2d, 0x27, 0xcf, 0xd7, 0xeb, 0x9d, 0x0d
+        };
+        check(bip44_used_contains(&used, hash160));
+      }
+
+      it("should hold the hash160 of a hex line") {
+        static const uint8_t hash160[20] = {
+          0x45, 0x04, 0x96, 0x9b, 0x3b, 0x67, 0x62, 0x64, 0x13, 0xff,
+          0xbc, 0x70, 0x3f, 0x3a, 0xd0, 0x92, 0x28, 0xd3, 0x4c, 0x7c
+        };
+        check(bip44_used_contains(&used, hash160));
+      }
+
+      it("should not hold other hash160") {
+        static const uint8_t hash160[20] = { 0 };
+        check(!bip44_used_contains(&used, hash160));
+      }
+    }
+
+    describe("when reading used addresses with an invalid line") {
+      it("should return error with the line number") {
+        bip44_used_t used;
+        size_t line_number = 0;
+        check_number(_read_used(&used, "73ebc6bd935ba44e82fbc4454786a476e587254b\n\n1FbHhBPHRV525SrG6CYyBz3NLEQJWqYMAM\n",
+                                &line_number), -2);
+        check_number(line_number, (size_t)3);
+        check(used.hash160 == NULL);
+      }
+    }
+
+    describe("when discovering bitcoin accounts with a gap limit of 20") {
+      static bip44_used_t used;
+      static int result = -1;
+
+      before() {
+        bip32_key_t purpose, coin;
+        size_t line_number;
+
+        _read_used(&used, used_lines, &line_number);
+        bip44_create_purpose(&master, &purpose);
+        bip44_create_coin(&purpose, bip44_coin_by_symbol("BTC"), &coin);
+        discovered_cnt = 0;
+        result = bip44_discover(&coin, &used, 20, 1, _collect, NULL);
+      }
+
+      after() {
+        bip44_used_free(&used);
+      }
+
+      it("should not return error")
+        check_number(result, 0);
+
+      it("should stop at the first account without used external addresses")
+        check_number(discovered_cnt, (size_t)2);
+
+      it("should report the next indices of account #0, ignoring the address past the gap") {
+        check_number(discovered[0].account, 0u);
+        check_number(discovered[0].external_next, 5u);
+        check_number(discovered[0].internal_next, 2u);
+      }
+
+      it("should report the next indices of account #1") {
+        check_number(discovered[1].account, 1u);
+        check_number(discovered[1].external_next, 3u);
+        check_number(discovered[1].internal_next, 0u);
+      }
+    }
+
+    describe("when discovering with a gap limit of 21 on several threads") {
+      static bip44_used_t used;
+      static int result = -1;
+
+      before() {
+        bip32_key_t purpose, coin;
+        size_t line_number;
+
+        _read_used(&used, used_lines, &line_number);
+        bip44_create_purpose(&master, &purpose);
+        bip44_create_coin(&purpose, bip44_coin_by_symbol("BTC"), &coin);
+        discovered_cnt = 0;
+        result = bip44_discover(&coin, &used, 21, 6, _collect, NULL);
+      }
+
+      after() {
+        bip44_used_free(&used);
+      }
+
+      it("should not return error")
+        check_number(result, 0);
+
+      it("should report the same accounts across windows of several accounts") {
+        check_number(discovered_cnt, (size_t)2);
+        check_number(discovered[1].account, 1u);
+        check_number(discovered[1].external_next, 3u);
+      }
+
+      it("should reach the address after a gap of 20")
+        check_number(discovered[0].external_next, 26u);
+    }
+  }
+}
@@ -1,6 +1,7 @@
 #include "./bdd-for-c.h"
 #include "./test_vectors.h"
 #include "../src/bip85.h"
+#include "../src/utils.h"
 
 #define check_str(got, expected) check(strcmp(got, expected) == 0, "expected string '%s' got '%s'", expected, got)
 #define check_number(got, expected) check(got == expected, "expected '%d' got '%d'", expected, got)
@@ -130,6 +131,47 @@ spec("bip85") {
       }
     }
 
+    context("cached application node") {
+      static bip85_t bip85;
+      static int result = -1;
+      before() {
+        result = bip85_bip39_init(&bip85, &key, 0, 12);
+      }
+
+      it("then should not return error")
+        check_number(result, 0);
+
+      describe("when generating 12 english words of index 0") {
+        static const char *words[BIP85_BIP39_MAX_WORDS];
+        static size_t word_cnt;
+        before() {
+          bip85_bip39_from_index(&bip85, 0, words, &word_cnt);
+        }
+
+        it("then it should generate the mnemonic of the application") {
+          check_number(word_cnt, 12);
+          check_str(words[0], "girl");
+          check_str(words[11], "nose");
+        }
+      }
+
+      describe("when deriving entropy of index 7") {
+        it("then should return the entropy of the full path") {
+          uint8_t entropy[64], expected[64];
+          bip85_entropy_from_key(&key, "39'/0'/12'/7'", expected);
+          check_number(bip85_entropy_from_index(&bip85, 7, entropy), 0);
+          check(memcmp(entropy, expected, 64) == 0);
+        }
+      }
+
+      describe("when initializing with an unsupported word count") {
+        it("then should return error") {
+          bip85_t invalid;
+          check(bip85_bip39_init(&invalid, &key, 0, 13) != 0);
+        }
+      }
+    }
+
     context("application pwd_base85") {
       describe("when generating password with length 12 using index 0") {
         static char password[64] = {0};
@@ -157,6 +199,111 @@ spec("bip85") {
         it("then generated password should be expected string")
           check_str(password, "W%v4tL`%");
       }
+
+      describe("when generating passwords of a cached node into a used buffer") {
+        static bip85_t bip85;
+        static char password[BIP85_PWD_BASE85_MAX + 1];
+        before () {
+          memset(password, 'x', sizeof(password));
+          bip85_pwd_base85_init(&bip85, &key, 12);
+          bip85_pwd_base85_from_index(&bip85, 0, password);
+        }
+
+        it("then generated password should be terminated after its length")
+          check_str(password, "_s`{TW89)i4`");
+
+        it("then a length above 80 should return error") {
+          bip85_t invalid;
+          check(bip85_pwd_base85_init(&invalid, &key, 81) != 0);
+        }
+      }
+    }
+
+    context("application XPRV") {
+      describe("when generating the child master key of index 0") {
+        static bip32_key_t child;
+        static int result = -1;
+        before() {
+          result = bip85_application_xprv(&key, 0, &child);
+        }
+
+        it("then should not return error")
+          check_number(result, 0);
+
+        it("then derived key should be expected xprv") {
+          char xprv[256];
+          size_t size = sizeof(xprv);
+          bip32_key_serialize(&child, true, (uint8_t *)xprv, &size);
+          check_str(xprv, "xprv9s21ZrQH143K2srSbCSg4m4kLvPMzcWydgmKEnMmoZUurYuBuYG46c6P71UGXMzmriLzCCBvKQWBUv3vPB3m1SATMhp3uEjXHJ42jFg7myX");
+        }
+      }
+    }
+
+    context("application HEX") {
+      describe("when generating 64 bytes using index 0") {
+        static uint8_t entropy[64];
+        static int result = -1;
+        before() {
+          result = bip85_application_hex(&key, 64, 0, entropy);
+        }
+
+        it("then should not return error")
+          check_number(result, 0);
+
+        it("then should return expected entropy") {
+          char hex[129];
+          utils_to_hex_string(entropy, sizeof(entropy), hex);
+          check_str(hex, "492db4698cf3b73a5a24998aa3e9d7fa96275d85724a91e71aa2d645442f878555d078fd1f1f67e368976f04137b1f7a0d19232136ca50c44614af72b5582a5c");
+        }
+      }
+
+      describe("when generating 8 bytes") {
+        it("then should return error") {
+          uint8_t entropy[64];
+          check(bip85_application_hex(&key, 8, 0, entropy) != 0);
+        }
+      }
+    }
+
+    context("application DRNG") {
+      describe("when reading 80 bytes using index 0") {
+        static uint8_t output[80];
+        static int result = -1;
+        before() {
+          bip85_drng_t drng;
+          result = bip85_drng_init(&drng, &key, 0);
+          bip85_drng_read(&drng, output, sizeof(output));
+        }
+
+        it("then should not return error")
+          check_number(result, 0);
+
+        it("then should return expected stream") {
+          char hex[161];
+          utils_to_hex_string(output, sizeof(output), hex);
+          check_str(hex, "b78b1ee6b345eae6836c2d53d33c64cdaf9a696487be81b03e822dc84b3f1cd883d7559e53d175f243e4c349e822a957bbff9224bc5dde9492ef54e8a439f6bc8c7355b87a925a37ee405a7502991111");
+        }
+      }
+
+      describe("when reading in pieces across blocks") {
+        it("then should return the same stream as one read") {
+          static uint8_t whole[1000], pieces[1000];
+          bip85_drng_t drng;
+          size_t offset = 0, size = 1;
+
+          bip85_drng_init(&drng, &key, 3);
+          bip85_drng_read(&drng, whole, sizeof(whole));
+
+          bip85_drng_init(&drng, &key, 3);
+          for (; offset < sizeof(pieces); offset += size, size = size * 3 + 1) {
+            if (size > sizeof(pieces) - offset)
+              size = sizeof(pieces) - offset;
+            bip85_drng_read(&drng, pieces + offset, size);
+          }
+
+          check(memcmp(whole, pieces, sizeof(whole)) == 0);
+        }
+      }
     }
 
     context("application HD-Seed WIF") {
@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "./bdd-for-c.h"
+#include "../src/random.h"
+
+#define check_number(got, expected) check(got == expected, "expected '%d' got '%d'", expected, got)
+
+spec("random") {
+
+  context("given drbg seeded with zero key") {
+    static random_drbg_t drbg;
+    static uint8_t seed[32] = {0};
+
+    describe("when generating bytes") {
+      // RFC 8439 A.1 ChaCha20 block function test vectors #1 and #2, the
+      // first 32 bytes of keystream are consumed as the next key
+      static uint8_t expected[] = {
+        0xda, 0x41, 0x59, 0x7c, 0x51, 0x57, 0x48, 0x8d, 0x77, 0x24, 0xe0, 0x3f, 0xb8, 0xd8, 0x4a, 0x37,
+        0x6a, 0x43, 0xb8, 0xf4, 0x15, 0x18, 0xa1, 0x1c, 0xc3, 0x87, 0xb6, 0x69, 0xb2, 0xee, 0x65, 0x86,
+        0x9f, 0x07, 0xe7, 0xbe, 0x55, 0x51, 0x38, 0x7a, 0x98, 0xba, 0x97, 0x7c, 0x73, 0x2d, 0x08, 0x0d,
+        0xcb, 0x0f, 0x29, 0xa0, 0x48, 0xe3, 0x65, 0x69, 0x12, 0xc6, 0x53, 0x3e, 0x32, 0xee, 0x7a, 0xed
+      };
+      static uint8_t first[32], second[32];
+      static int result = -1;
+
+      before() {
+        random_drbg_init(&drbg, seed);
+        result = random_drbg_generate(&drbg, first, sizeof(first));
+        random_drbg_generate(&drbg, second, sizeof(second));
+      }
+
+      it("then should not return error")
+        check_number(result, 0);
+
+      it("then first request should return known keystream")
+        check(memcmp(first, expected, 32) == 0);
+
+      it("then second request should continue the keystream")
+        check(memcmp(second, expected + 32, 32) == 0);
+
+      it("then the key should have been replaced")
+        check(memcmp(drbg.key, seed, sizeof(seed)) != 0);
+    }
+
+    describe("when generating across buffer refills") {
+      static uint8_t bulk[3 * RANDOM_BUFFER_SIZE];
+      static uint8_t chunked[3 * RANDOM_BUFFER_SIZE];
+
+      before() {
+        random_drbg_init(&drbg, seed);
+        random_drbg_generate(&drbg, bulk, sizeof(bulk));
+
+        random_drbg_init(&drbg, seed);
+        for (size_t i = 0; i < sizeof(chunked); i += 7)
+          random_drbg_generate(&drbg, chunked + i, sizeof(chunked) - i < 7 ? sizeof(chunked) - i : 7);
+      }
+
+      it("then output should not depend on request sizes")
+        check(memcmp(bulk, chunked, sizeof(bulk)) == 0);
+    }
+
+    describe("when reseeding") {
+      static uint8_t a[32], b[32];
+
+      before() {
+        random_drbg_init(&drbg, seed);
+        random_drbg_generate(&drbg, a, sizeof(a));
+
+        random_drbg_init(&drbg, seed);
+        random_drbg_reseed(&drbg, (uint8_t *)"additional input", 16);
+        random_drbg_generate(&drbg, b, sizeof(b));
+      }
+
+      it("then output should differ from unseeded stream")
+        check(memcmp(a, b, sizeof(a)) != 0);
+    }
+  }
+
+  context("given the per-thread generator") {
+    describe("when filling two buffers") {
+      static uint8_t a[32], b[32];
+      static int result = -1;
+
+      before() {
+        result = random_fill(a, sizeof(a));
+        random_fill(b, sizeof(b));
+      }
+
+      it("then should not return error")
+        check_number(result, 0);
+
+      it("then buffers should differ")
+        check(memcmp(a, b, sizeof(a)) != 0);
+    }
+
+    describe("when filling more than the reseed budget at once") {
+      static uint8_t *bulk;
+      static int result = -1;
+
+      before() {
+        bulk = calloc(1, 2 * RANDOM_RESEED_BYTES + 1);
+        result = random_fill(bulk, 2 * RANDOM_RESEED_BYTES + 1);
+      }
+
+      after() {
+        free(bulk);
+      }
+
+      it("then should not return error")
+        check_number(result, 0);
+
+      it("then the budgets should not repeat each other")
+        check(memcmp(bulk, bulk + RANDOM_RESEED_BYTES, 32) != 0);
+    }
+
+    describe("when forking") {
+      static uint8_t parent[32], child[32];
+
+      before() {
+        int fds[2];
+        pid_t pid;
+
+        random_fill(parent, sizeof(parent));
+        pipe(fds);
+        pid = fork();
+        if (pid == 0) {
+          random_fill(child, sizeof(child));
+          write(fds[1], child, sizeof(child));
+          _exit(0);
+        }
+        random_fill(parent, sizeof(parent));
+        read(fds[0], child, sizeof(child));
+        waitpid(pid, NULL, 0);
+        close(fds[0]);
+        close(fds[1]);
+      }
+
+      it("then child should not repeat the parents output")
+        check(memcmp(parent, child, sizeof(parent)) != 0);
+    }
+  }
+}
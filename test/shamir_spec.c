@@ -0,0 +1,170 @@
+#include <stdlib.h>
+
+#include "./bdd-for-c.h"
+#include "../src/shamir.h"
+#include "../src/random.h"
+
+#define check_number(got, expected) check(got == expected, "expected '%d' got '%d'", expected, got)
+
+// longer than one coefficient block and not a multiple of the vector width
+#define SECRET_SIZE 10007
+
+spec("shamir") {
+
+  context("given shares of a known polynomial") {
+    // f(x) = 0x53 + 0xca * x, f(1) = 0x99, f(2) = 0x53 ^ 0x8f
+    static const uint8_t xs[] = { 1, 2 };
+    static const uint8_t shares[] = { 0x99, 0xdc };
+
+    describe("when combining") {
+      static uint8_t secret;
+      static int result = -1;
+
+      before() {
+        result = shamir_combine(xs, shares, 1, 2, &secret);
+      }
+
+      it("then should not return error")
+        check_number(result, 0);
+
+      it("then should return the constant term")
+        check_number(secret, 0x53);
+    }
+  }
+
+  context("given a secret split into 5 shares with a threshold of 3") {
+    static uint8_t secret[SECRET_SIZE];
+    static uint8_t shares[5 * SECRET_SIZE];
+    static int result = -1;
+
+    before() {
+      random_fill(secret, sizeof(secret));
+      result = shamir_split(secret, sizeof(secret), 5, 3, shares);
+    }
+
+    it("then splitting should not return error")
+      check_number(result, 0);
+
+    describe("when combining three of them") {
+      static const uint8_t xs[] = { 5, 2, 3 };
+      static uint8_t subset[3 * SECRET_SIZE], recovered[SECRET_SIZE];
+      static int res = -1;
+
+      before() {
+        for (int i = 0; i < 3; i++)
+          memcpy(subset + i * SECRET_SIZE, shares + (xs[i] - 1) * SECRET_SIZE, SECRET_SIZE);
+        res = shamir_combine(xs, subset, SECRET_SIZE, 3, recovered);
+      }
+
+      it("then should not return error")
+        check_number(res, 0);
+
+      it("then should return the secret")
+        check(memcmp(recovered, secret, sizeof(secret)) == 0);
+
+      it("then scalar arithmetic should return the same secret") {
+        uint8_t scalar[SECRET_SIZE];
+        shamir_use_simd(false);
+        shamir_combine(xs, subset, SECRET_SIZE, 3, scalar);
+        shamir_use_simd(true);
+        check(memcmp(scalar, secret, sizeof(secret)) == 0);
+      }
+    }
+
+    describe("when combining all of them") {
+      static const uint8_t xs[] = { 1, 2, 3, 4, 5 };
+      static uint8_t recovered[SECRET_SIZE];
+
+      it("then should return the secret") {
+        shamir_combine(xs, shares, SECRET_SIZE, 5, recovered);
+        check(memcmp(recovered, secret, sizeof(secret)) == 0);
+      }
+    }
+
+    describe("when combining two of them") {
+      static const uint8_t xs[] = { 1, 2 };
+      static uint8_t recovered[SECRET_SIZE];
+
+      it("then should not return the secret") {
+        shamir_combine(xs, shares, SECRET_SIZE, 2, recovered);
+        check(memcmp(recovered, secret, sizeof(secret)) != 0);
+      }
+    }
+
+    describe("when combining the same share twice") {
+      static const uint8_t xs[] = { 1, 1, 2 };
+      static uint8_t recovered[SECRET_SIZE];
+
+      it("then should return error")
+        check(shamir_combine(xs, shares, SECRET_SIZE, 3, recovered) != 0);
+    }
+  }
+
+  context("given a batch of secrets split into 5 batch shares with a threshold of 3") {
+    // two secrets of the same length and a shorter one
+    static const uint8_t secrets[] = "0123456789abcdef0123456789ABCDEFxyz";
+    static const size_t offsets[] = { 0, 16, 32, 35 };
+    static uint8_t shares[(35 + 3 * SHAMIR_BATCH_OVERHEAD) * 5];
+    static const size_t size = 16 + SHAMIR_BATCH_OVERHEAD;
+    static int result = -1;
+
+    before() {
+      result = shamir_batch_split(secrets, offsets, 3, 5, 3, shares);
+    }
+
+    it("then should not return error")
+      check_number(result, 0);
+
+    describe("when combining three shares of each secret") {
+      it("then should return each secret") {
+        uint8_t picked[3 * (16 + SHAMIR_BATCH_OVERHEAD)], recovered[16];
+
+        for (size_t i = 0; i < 3; i++) {
+          size_t length = offsets[i + 1] - offsets[i] + SHAMIR_BATCH_OVERHEAD;
+          const uint8_t *share = shares + (offsets[i] + i * SHAMIR_BATCH_OVERHEAD) * 5;
+
+          memcpy(picked, share + 4 * length, length);
+          memcpy(picked + length, share, length);
+          memcpy(picked + 2 * length, share + 2 * length, length);
+          check_number(shamir_batch_combine(picked, length, 3, recovered), 0);
+          check(memcmp(recovered, secrets + offsets[i], offsets[i + 1] - offsets[i]) == 0);
+        }
+      }
+    }
+
+    describe("when combining fewer shares than the threshold") {
+      it("then should return error") {
+        uint8_t recovered[16];
+        check_number(shamir_batch_combine(shares, size, 2, recovered), -2);
+      }
+    }
+
+    describe("when combining a tampered share") {
+      it("then should return error") {
+        uint8_t tampered[3 * (16 + SHAMIR_BATCH_OVERHEAD)], recovered[16];
+
+        memcpy(tampered, shares, sizeof(tampered));
+        tampered[size + 5] ^= 0x01;
+        check_number(shamir_batch_combine(tampered, size, 3, recovered), -3);
+      }
+    }
+
+    describe("when combining shares of two secrets") {
+      it("then should return error") {
+        uint8_t mixed[3 * (16 + SHAMIR_BATCH_OVERHEAD)], recovered[16];
+
+        // the first two shares of the first secret, the third of the second
+        memcpy(mixed, shares, 2 * size);
+        memcpy(mixed + 2 * size, shares + 5 * size + 2 * size, size);
+        check_number(shamir_batch_combine(mixed, size, 3, recovered), -3);
+      }
+    }
+  }
+
+  context("given a threshold above the share count") {
+    static uint8_t secret[16], shares[2 * 16];
+
+    it("then splitting should return error")
+      check(shamir_split(secret, sizeof(secret), 2, 3, shares) != 0);
+  }
+}
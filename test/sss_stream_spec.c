@@ -0,0 +1,129 @@
+#include <stdlib.h>
+
+#include "./bdd-for-c.h"
+#include "../src/sss_stream.h"
+
+#define check_number(got, expected) check(got == expected, "expected '%d' got '%d'", expected, got)
+
+#define SECRET_SIZE (3 * 4096 + 100)
+
+static uint8_t secret[SECRET_SIZE];
+
+static void
+_rewind(FILE **files, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+    rewind(files[i]);
+}
+
+static int
+_recover(FILE **files, size_t count, uint8_t *out, size_t *size)
+{
+  FILE *recovered = tmpfile();
+  int res;
+
+  _rewind(files, count);
+  res = sss_stream_recover(files, count, recovered);
+
+  rewind(recovered);
+  *size = fread(out, 1, SECRET_SIZE + 1, recovered);
+  fclose(recovered);
+  return res;
+}
+
+spec("sss_stream") {
+
+  static FILE *shares[5];
+  static int result = -1;
+
+  before() {
+    FILE *in = tmpfile();
+
+    for (size_t i = 0; i < sizeof(secret); i++)
+      secret[i] = i * 7 + (i >> 8);
+    fwrite(secret, 1, sizeof(secret), in);
+    rewind(in);
+
+    for (int i = 0; i < 5; i++)
+      shares[i] = tmpfile();
+
+    result = sss_stream_create(in, shares, 5, 3, 4096);
+    fclose(in);
+  }
+
+  after() {
+    for (int i = 0; i < 5; i++)
+      fclose(shares[i]);
+  }
+
+  context("given a secret split into 5 share files with a threshold of 3") {
+
+    it("then creating should not return error")
+      check_number(result, 0);
+
+    describe("when recovering from three share files") {
+      static uint8_t out[SECRET_SIZE + 1];
+      static size_t size;
+      static int res = -1;
+
+      before() {
+        FILE *files[3] = { shares[4], shares[0], shares[2] };
+        res = _recover(files, 3, out, &size);
+      }
+
+      it("then should not return error")
+        check_number(res, 0);
+
+      it("then should return the secret") {
+        check_number((int)size, SECRET_SIZE);
+        check(memcmp(out, secret, sizeof(secret)) == 0);
+      }
+    }
+
+    describe("when recovering from two share files") {
+      static uint8_t out[SECRET_SIZE + 1];
+      static size_t size;
+
+      it("then should return error") {
+        FILE *files[2] = { shares[1], shares[3] };
+        check(_recover(files, 2, out, &size) != 0);
+        check_number((int)size, 0);
+      }
+    }
+
+    describe("when recovering with the same share file twice") {
+      static uint8_t out[SECRET_SIZE + 1];
+      static size_t size;
+
+      it("then should return error") {
+        FILE *files[3] = { shares[1], shares[3], shares[1] };
+        check(_recover(files, 3, out, &size) != 0);
+      }
+    }
+
+    describe("when a chunk of the first share file is modified") {
+      static uint8_t out[SECRET_SIZE + 1];
+      static size_t size;
+      static int res = -1;
+
+      before() {
+        FILE *files[3] = { shares[0], shares[1], shares[2] };
+        int c;
+
+        // flip a byte of the second chunk
+        fseek(shares[0], SSS_STREAM_HEADER_SIZE + 4 + 4096 + SSS_STREAM_TAG_SIZE + 4 + 10, SEEK_SET);
+        c = getc(shares[0]);
+        fseek(shares[0], -1, SEEK_CUR);
+        putc(c ^ 0x01, shares[0]);
+
+        res = _recover(files, 3, out, &size);
+      }
+
+      it("then should return error")
+        check(res != 0);
+
+      it("then should only write the chunks before it")
+        check_number((int)size, 4096);
+    }
+  }
+}
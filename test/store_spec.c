@@ -0,0 +1,359 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include <nettle/aes.h>
+#include <nettle/pbkdf2.h>
+
+#include "./bdd-for-c.h"
+#include "../src/store.h"
+
+#define check_number(got, expected) check(got == expected, "expected '%d' got '%d'", expected, got)
+
+static const char *mnemonics_a = "legal winner thank year wave sausage worth useful legal winner thank yellow";
+static const char *mnemonics_b = "letter advice cage absurd amount doctor acoustic avoid letter advice cage above";
+
+/** write a store file of the old format, aes-256 of one block of word indices */
+static void
+_write_legacy(const char *file, const char *password)
+{
+  // word indices of mnemonics_a, the rest of the block is filler
+  static const uint16_t words[] = { 1019, 2015, 1790, 2039, 1983, 1533, 2031, 1919, 1019, 2015, 1790, 2040 };
+  uint8_t block[128], data[128], key[32];
+  struct aes256_ctx aes;
+  FILE *out;
+
+  memset(block, 0x5a, sizeof(block));
+  for (size_t i = 0; i < 12; i++) {
+    block[i * 2] = words[i] >> 8;
+    block[i * 2 + 1] = words[i];
+  }
+  block[24] = block[25] = 0xff;
+
+  pbkdf2_hmac_sha512(strlen(password), (const uint8_t *)password, 4096,
+                     strlen("btct_store_password"), (const uint8_t *)"btct_store_password",
+                     sizeof(key), key);
+  aes256_set_encrypt_key(&aes, key);
+  aes256_encrypt(&aes, sizeof(block), data, block);
+
+  out = fopen(file, "wb");
+  fwrite(data, 1, sizeof(data), out);
+  fclose(out);
+}
+
+spec("store") {
+
+  static char dir[] = "/tmp/btct_store_spec.XXXXXX";
+  static char file[64];
+
+  before() {
+    mkdtemp(dir);
+    snprintf(file, sizeof(file), "%s/store.dat", dir);
+  }
+
+  after() {
+    unlink(file);
+    rmdir(dir);
+  }
+
+  context("given a store with two wallets") {
+    static store_t store;
+    static int result_a = -1, result_b = -1;
+
+    before() {
+      unlink(file);
+      result_a = store_write_mnemonics(file, "password", "first", (const uint8_t *)mnemonics_a);
+      result_b = store_write_mnemonics(file, "password", "second", (const uint8_t *)mnemonics_b);
+      store_open(&store, file);
+    }
+
+    after() {
+      store_close(&store);
+    }
+
+    it("then writing should not return error") {
+      check_number(result_a, 0);
+      check_number(result_b, 0);
+    }
+
+    it("then store should hold two entries")
+      check_number(store.entry_count, 2);
+
+    describe("when looking up by label") {
+      it("then should find both wallets") {
+        check(store_find_by_label(&store, "first") >= 0);
+        check(store_find_by_label(&store, "second") >= 0);
+      }
+
+      it("then should not find unknown label")
+        check_number(store_find_by_label(&store, "third"), -1);
+    }
+
+    describe("when looking up by masterkey fingerprint") {
+      // fingerprint of masterkey for mnemonics_a without passphrase
+      static uint8_t fingerprint[4] = { 0xb8, 0x68, 0x8d, 0xf1 };
+
+      it("then should find the first wallet")
+        check_number(store_find_by_fingerprint(&store, fingerprint), store_find_by_label(&store, "first"));
+    }
+
+    describe("when unlocking with wrong password") {
+      it("then should return error")
+        check(store_unlock(&store, "wrong") != 0);
+    }
+
+    describe("when reading mnemonics") {
+      static uint8_t sentence[256];
+      static size_t size = sizeof(sentence);
+      static int result = -1;
+
+      before() {
+        result = store_read_mnemonics(file, "password", "second", sentence, &size);
+      }
+
+      it("then should not return error")
+        check_number(result, 0);
+
+      it("then should return the stored mnemonics")
+        check(strcmp((char *)sentence, mnemonics_b) == 0, "got '%s'", sentence);
+    }
+
+    describe("when reading word indices and entropy") {
+      static uint16_t words[24];
+      static size_t count = 24;
+      static uint8_t entropy[32];
+      static size_t size = sizeof(entropy);
+      static int result_words = -1, result_entropy = -1;
+
+      before() {
+        store_unlock(&store, "password");
+        result_words = store_words(&store, store_find_by_label(&store, "second"), words, &count);
+        result_entropy = store_entropy(&store, store_find_by_label(&store, "second"), entropy, &size);
+      }
+
+      it("then should not return error") {
+        check_number(result_words, 0);
+        check_number(result_entropy, 0);
+      }
+
+      it("then should return the word indices") {
+        check_number((int)count, 12);
+        check_number(words[0], 1028); // letter
+        check_number(words[11], 4);   // above
+      }
+
+      it("then should return the entropy without checksum") {
+        static const uint8_t expected[16] = {
+          0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+          0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+        };
+        check_number((int)size, 16);
+        check(memcmp(entropy, expected, sizeof(expected)) == 0);
+      }
+    }
+
+    describe("when reading the seed") {
+      static uint8_t seed[64];
+      static int result = -1;
+
+      before() {
+        store_unlock(&store, "password");
+        result = store_seed(&store, store_find_by_label(&store, "second"), "TREZOR", seed);
+      }
+
+      it("then should not return error")
+        check_number(result, 0);
+
+      it("then should return the bip39 seed of the passphrase") {
+        static const uint8_t expected[8] = { 0xd7, 0x1d, 0xe8, 0x56, 0xf8, 0x1a, 0x8a, 0xcc };
+        check(memcmp(seed, expected, sizeof(expected)) == 0);
+      }
+    }
+
+    describe("when replacing a wallet") {
+      static uint8_t sentence[256];
+      static size_t size = sizeof(sentence);
+      static store_t replaced;
+
+      before() {
+        store_write_mnemonics(file, "password", "first", (const uint8_t *)mnemonics_b);
+        store_open(&replaced, file);
+        store_read_mnemonics(file, "password", "first", sentence, &size);
+      }
+
+      after() {
+        store_close(&replaced);
+      }
+
+      it("then store should still hold two entries")
+        check_number(replaced.entry_count, 2);
+
+      it("then should return the new mnemonics")
+        check(strcmp((char *)sentence, mnemonics_b) == 0, "got '%s'", sentence);
+
+      it("then the file should not grow for a record of the same size")
+        check_number(replaced.size, store.size);
+    }
+
+    describe("when caching the masterkey") {
+      static bip32_key_t cached, derived;
+      static int result = -1;
+      static store_t cache;
+
+      before() {
+        store_write_wallet(file, "password", "cached", (const uint8_t *)mnemonics_b, NULL,
+                           STORE_SECTION_MASTERKEY, 0);
+        store_open(&cache, file);
+        store_unlock(&cache, "password");
+        result = store_masterkey(&cache, store_find_by_label(&cache, "cached"), NULL, &cached);
+        store_masterkey(&cache, store_find_by_label(&cache, "second"), NULL, &derived);
+      }
+
+      after() {
+        store_close(&cache);
+      }
+
+      it("then should not return error")
+        check_number(result, 0);
+
+      it("then should flag the cached section") {
+        store_entry_t entry;
+        store_entry(&cache, store_find_by_label(&cache, "cached"), &entry);
+        check(entry.sections == (STORE_SECTION_MNEMONIC | STORE_SECTION_MASTERKEY));
+      }
+
+      it("then should equal the masterkey derived from mnemonics")
+        check(memcmp(&cached, &derived, sizeof(bip32_key_t)) == 0);
+
+      it("then another passphrase should return the masterkey of that passphrase") {
+        bip32_key_t other, expected;
+        check_number(store_masterkey(&cache, store_find_by_label(&cache, "cached"), "TREZOR", &other), 0);
+        store_masterkey(&cache, store_find_by_label(&cache, "second"), "TREZOR", &expected);
+        check(memcmp(&other, &expected, sizeof(bip32_key_t)) == 0);
+        check(memcmp(&other, &cached, sizeof(bip32_key_t)) != 0);
+      }
+    }
+
+    describe("when adding with another kdf cost") {
+      static uint8_t sentence[256];
+      static size_t size = sizeof(sentence);
+      static store_t rekeyed;
+      static int result = -1;
+
+      before() {
+        store_write_wallet(file, "password", "third", (const uint8_t *)mnemonics_a, NULL,
+                           STORE_SECTION_MNEMONIC, 2048);
+        store_open(&rekeyed, file);
+        result = store_read_mnemonics(file, "password", "second", sentence, &size);
+      }
+
+      after() {
+        store_close(&rekeyed);
+      }
+
+      it("then should record the new cost")
+        check_number(rekeyed.iterations, 2048);
+
+      it("then should use a new salt")
+        check(memcmp(rekeyed.salt, store.salt, STORE_SALT_SIZE) != 0);
+
+      it("then should still read existing wallets") {
+        check_number(result, 0);
+        check(strcmp((char *)sentence, mnemonics_b) == 0, "got '%s'", sentence);
+      }
+    }
+
+    describe("when adding with another password") {
+      it("then should return error")
+        check(store_write_mnemonics(file, "other", "third", (const uint8_t *)mnemonics_a) != 0);
+    }
+  }
+
+  context("given a store file of the old single wallet format") {
+    before() {
+      unlink(file);
+      _write_legacy(file, "password");
+    }
+
+    describe("when adding a wallet with another password") {
+      static uint8_t sentence[256];
+      static size_t size = sizeof(sentence);
+      static int result = 0, result_read = -1;
+
+      before() {
+        result = store_write_mnemonics(file, "other", "second", (const uint8_t *)mnemonics_b);
+        result_read = store_read_mnemonics(file, "password", NULL, sentence, &size);
+      }
+
+      it("then should return error")
+        check_number(result, -7);
+
+      it("then should leave the old store in place") {
+        check_number(result_read, 0);
+        check(strcmp((char *)sentence, mnemonics_a) == 0, "got '%s'", sentence);
+      }
+    }
+
+    describe("when migrating with another password") {
+      it("then should return error")
+        check_number(store_migrate(file, "other", 0), -2);
+    }
+
+    describe("when migrating") {
+      static uint8_t sentence[256];
+      static size_t size = sizeof(sentence);
+      static store_t migrated;
+      static int result = -1, index = -1;
+
+      before() {
+        result = store_migrate(file, "password", 0);
+        store_open(&migrated, file);
+        store_unlock(&migrated, "password");
+        index = store_find_by_label(&migrated, STORE_DEFAULT_LABEL);
+        store_mnemonics(&migrated, index, sentence, &size);
+      }
+
+      after() {
+        store_close(&migrated);
+      }
+
+      it("then should not return error")
+        check_number(result, 0);
+
+      it("then store should hold the old wallet as the default wallet") {
+        check_number(migrated.entry_count, 1);
+        check_number(index, 0);
+        check(strcmp((char *)sentence, mnemonics_a) == 0, "got '%s'", sentence);
+      }
+
+      it("then migrating again should leave the store as is")
+        check_number(store_migrate(file, "password", 0), 0);
+    }
+
+    describe("when adding a wallet") {
+      static uint8_t sentence[256];
+      static size_t size = sizeof(sentence);
+      static store_t migrated;
+      static int result = -1, result_read = -1;
+
+      before() {
+        result = store_write_mnemonics(file, "password", "second", (const uint8_t *)mnemonics_b);
+        store_open(&migrated, file);
+        result_read = store_read_mnemonics(file, "password", NULL, sentence, &size);
+      }
+
+      after() {
+        store_close(&migrated);
+      }
+
+      it("then should not return error")
+        check_number(result, 0);
+
+      it("then store should hold the old wallet and the new one")
+        check_number(migrated.entry_count, 2);
+
+      it("then the old wallet should be the default wallet") {
+        check_number(result_read, 0);
+        check(strcmp((char *)sentence, mnemonics_a) == 0, "got '%s'", sentence);
+      }
+    }
+  }
+}
@@ -63,4 +63,59 @@ spec("bip32") {
         check_str(result, "Xk~0{Z+UNZ");
     }
   }
+
+  context("batched sha256") {
+    describe("when hashing 'abc' and 'abc' as a batch of 3 bytes") {
+      static const uint8_t data[] = { 'a', 'b', 'c', 'a', 'b', 'c' };
+      static uint8_t digests[2 * 32];
+      static int result = -1;
+      before() {
+        result = utils_sha256_batch(data, 3, 2, digests);
+      }
+      it("should not return error")
+        check_number(result, 0);
+      it("should return the sha256 of each message") {
+        static const uint8_t expected[] = { 0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea };
+        check(memcmp(digests, expected, sizeof(expected)) == 0);
+        check(memcmp(digests, digests + 32, 32) == 0);
+      }
+    }
+  }
+
+  context("range parsing") {
+    describe("when parsing '0-9'") {
+      static uint32_t first, last;
+      static int result;
+      before() {
+        result = utils_parse_range("0-9", &first, &last);
+      }
+      it("should not return error")
+        check_number(result, 0);
+      it("should return 0 to 9") {
+        check_number(first, 0u);
+        check_number(last, 9u);
+      }
+    }
+
+    describe("when parsing a single number") {
+      static uint32_t first, last;
+      before() {
+        utils_parse_range("2147483647", &first, &last);
+      }
+      it("should return a range of one")
+        check(first == 2147483647u && last == 2147483647u);
+    }
+
+    describe("when parsing invalid ranges") {
+      uint32_t first, last;
+      it("should return error") {
+        check(utils_parse_range("", &first, &last) != 0);
+        check(utils_parse_range("9-0", &first, &last) != 0);
+        check(utils_parse_range("1-", &first, &last) != 0);
+        check(utils_parse_range("-1", &first, &last) != 0);
+        check(utils_parse_range("1,2", &first, &last) != 0);
+        check(utils_parse_range("4294967296", &first, &last) != 0);
+      }
+    }
+  }
 }